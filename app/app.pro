@@ -105,18 +105,23 @@ HEADERS +=     activity.h \
     binpack.h \
     chooser.h \
     crypto.h \
+    damage_region.h \
     destination_folder_dialog.h \
     dir.h \
     display_driver.h \
+    document_writer.h \
     documentation.h \
     drag.h \
+    draw_batch.h \
     drawing.h \
+    drawing_arena.h \
     error_message_dialog.h \
     examples_menu.h \
     file_monitor.h \
     font.h \
     font_file_manager.h \
     frame.h \
+    frame_pacer.h \
     gc_thread.h \
     gl_keepers.h \
     glyph_cache.h \
@@ -125,6 +130,7 @@ HEADERS +=     activity.h \
     info_trash_can.h \
     init_cleanup.h \
     inspectordialog.h \
+    job_pool.h \
     justification.h \
     layout.h \
     license.h \
@@ -138,6 +144,7 @@ HEADERS +=     activity.h \
     nag_screen.h \
     normalize.h \
     page_layout.h \
+    page_thumbnails.h \
     path3d.h \
     preferences_dialog.h \
     preferences_pages.h \
@@ -156,6 +163,7 @@ HEADERS +=     activity.h \
     splash_screen.h \
     statistics.h \
     svg.h \
+    svg_shape.h \
     table.h \
     tao_main.h \
     tao_tree.h \
@@ -163,10 +171,13 @@ HEADERS +=     activity.h \
     html_converter.h \
     texture.h \
     texture_cache.h \
+    texture_store.h \
     tool_window.h \
     transforms.h \
     tree_cloning.h \
+    triangle_mesh.h \
     update_application.h \
+    view_replay.h \
     widget.h \
     widget_surface.h \
     window.h \
@@ -181,6 +192,7 @@ HEADERS +=     activity.h \
     include/tao/module_info.h \
     include/tao/tao_gl.h \
     include/tao/tao_info.h \
+    include/tao/tao_simd.h \
     include/tao/tao_utf8.h \
     include/tao/graphic_state.h
 
@@ -194,18 +206,23 @@ SOURCES += \
     attributes.cpp \
     binpack.cpp \
     chooser.cpp \
+    damage_region.cpp \
     destination_folder_dialog.cpp \
     dir.cpp \
     display_driver.cpp \
+    document_writer.cpp \
     documentation.cpp \
     drag.cpp \
+    draw_batch.cpp \
     drawing.cpp \
+    drawing_arena.cpp \
     error_message_dialog.cpp \
     examples_menu.cpp \
     file_monitor.cpp \
     font.cpp \
     font_file_manager.cpp \
     frame.cpp \
+    frame_pacer.cpp \
     gc_thread.cpp \
     gl_keepers.cpp \
     glyph_cache.cpp \
@@ -214,6 +231,7 @@ SOURCES += \
     info_trash_can.cpp \
     init_cleanup.cpp \
     inspectordialog.cpp \
+    job_pool.cpp \
     layout.cpp \
     license_dialog.cpp \
     lighting.cpp \
@@ -226,6 +244,7 @@ SOURCES += \
     nag_screen.cpp \
     normalize.cpp \
     page_layout.cpp \
+    page_thumbnails.cpp \
     path3d.cpp \
     preferences_dialog.cpp \
     preferences_pages.cpp \
@@ -244,17 +263,21 @@ SOURCES += \
     splash_screen.cpp \
     statistics.cpp \
     svg.cpp \
+    svg_shape.cpp \
     table.cpp \
     tao_main.cpp \
     text_drawing.cpp \
     html_converter.cpp \
     texture.cpp \
     texture_cache.cpp \
+    texture_store.cpp \
     tool_window.cpp \
     transforms.cpp \
     tree_cloning.cpp \
+    triangle_mesh.cpp \
     update_application.cpp \
     version.cpp \
+    view_replay.cpp \
     widget.cpp \
     widget_surface.cpp \
     window.cpp
@@ -644,5 +667,6 @@ qttranslations.files = $$[QT_INSTALL_TRANSLATIONS]/qt_fr.qm $$[QT_INSTALL_TRANSL
 INSTALLS += qttranslations
 
 shaders.path = $$APPINST
-shaders.files = lighting.vs lighting.fs
+shaders.files = lighting.vs lighting.fs distance_field.vs distance_field.fs \
+                svg_fade.vs svg_fade.fs
 INSTALLS += shaders
@@ -56,6 +56,7 @@
 #include "traces.h"
 #include "display_driver.h"
 #include "gc_thread.h"
+#include "job_pool.h"
 #include "text_drawing.h"
 #include "license.h"
 #include "preferences_pages.h"
@@ -126,7 +127,8 @@ Application::Application(int & argc, char ** argv)
 // ----------------------------------------------------------------------------
     : QApplication(argc, argv), hasGLMultisample(false),
       hasFBOMultisample(false), hasGLStereoBuffers(false), hasMipmap(false),
-      updateApp(NULL), readyToLoad(false), edition(Unknown),
+      gcThread(NULL), jobPool(NULL), updateApp(NULL), readyToLoad(false),
+      edition(Unknown),
       startDir(QDir::currentPath()),
       splash(NULL), win(NULL), xlr(NULL), screenSaverBlocked(false),
       moduleManager(NULL), peer(NULL)
@@ -255,6 +257,9 @@ void Application::deferredInit()
         gcThread->start();
     }
 
+    // Threads running background jobs for modules, started on demand
+    jobPool = new JobPool;
+
     // #1891 load padlock icon for license dialog
     QPixmap pm(":/images/tao_padlock.svg");
     padlockIcon = new QPixmap(pm.scaled(64, 64, Qt::IgnoreAspectRatio,
@@ -451,6 +456,12 @@ Application::~Application()
         gcThread->wait();
         record(tao_gc, "GC thread %p stopped, deleting", gcThread);
         delete gcThread;
+        gcThread = NULL;
+    }
+    if (jobPool)
+    {
+        record(tao_app, "Deleting job pool %p", jobPool);
+        delete jobPool;
     }
     if (updateApp)
     {
@@ -802,6 +813,9 @@ void Application::cleanup()
         updateApp->cancel();
     // Closing windows will save windows settings (geometry)
     closeAllWindows();
+    // Modules are still loaded, let them know their jobs are cancelled
+    if (jobPool)
+        jobPool->Stop();
     saveSettings();
     if (screenSaverBlocked)
         blockScreenSaver(false);
@@ -68,6 +68,7 @@ struct Window;
 struct SplashScreen;
 struct ModuleManager;
 struct GCThread;
+class  JobPool;
 struct UpdateApplication;
 #ifdef CFG_LICENSE_DOWNLOAD
 struct LicenseDownloadUI;
@@ -199,6 +200,7 @@ public:
     bool               useShaderLighting;
     QString            lang;
     GCThread *         gcThread;
+    JobPool *          jobPool;
     UpdateApplication* updateApp;
 #ifdef CFG_LICENSE_DOWNLOAD
     LicenseDownloadUI * licDownload;
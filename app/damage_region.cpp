@@ -0,0 +1,198 @@
+// *****************************************************************************
+// damage_region.cpp                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Screen area that changed since the last frame, computed from the
+//     bounds of the layouts refreshed in between, so that only that area
+//     needs to be cleared and drawn again.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "damage_region.h"
+#include "opengl_state.h"
+#include <cmath>
+#include <cstring>
+
+TAO_BEGIN
+
+DamageRegion::DamageRegion()
+// ----------------------------------------------------------------------------
+//   Start disabled, with the whole window to draw
+// ----------------------------------------------------------------------------
+    : enabled(false), overlay(false), all(true), partial(false),
+      damage(), drawn(), current(), region(),
+      target(NULL), lastFrame(-1), width(0), height(0)
+{
+    memset(modelview, 0, sizeof(modelview));
+    memset(projection, 0, sizeof(projection));
+}
+
+
+void DamageRegion::Enable(bool enable)
+// ----------------------------------------------------------------------------
+//   Turn damage tracking on or off
+// ----------------------------------------------------------------------------
+//   Layouts drawn while tracking was off did not record their bounds,
+//   so the next frame is drawn entirely.
+{
+    enabled = enable;
+    all = true;
+    previous[0].Empty();
+    previous[1].Empty();
+}
+
+
+void DamageRegion::Project(Box &into, const Box3 &bounds)
+// ----------------------------------------------------------------------------
+//   Add the window area covered by bounds with the current GL transform
+// ----------------------------------------------------------------------------
+{
+    // Nothing drawn (flat shapes have lower.z == upper.z, not IsEmpty)
+    if (bounds.lower.x > bounds.upper.x || bounds.lower.y > bounds.upper.y)
+        return;
+
+    const coord *mv = GL.ModelViewMatrix();
+    const coord *proj = GL.ProjectionMatrix();
+    const int *vp = GL.Viewport();
+    Box screen;
+    for (uint c = 0; c < 8; c++)
+    {
+        coord x = (c & 1) ? bounds.upper.x : bounds.lower.x;
+        coord y = (c & 2) ? bounds.upper.y : bounds.lower.y;
+        coord z = (c & 4) ? bounds.upper.z : bounds.lower.z;
+        coord wx, wy, wz;
+
+        // A corner behind the eye or beyond the far plane may project
+        // anywhere: assume the whole viewport is covered
+        if (!GL.Project(x, y, z, mv, proj, vp, &wx, &wy, &wz) ||
+            wz < 0.0 || wz > 1.0)
+        {
+            screen = Viewport();
+            break;
+        }
+        screen |= Point(wx, wy);
+    }
+
+    screen.lower -= Vector(MARGIN, MARGIN);
+    screen.upper += Vector(MARGIN, MARGIN);
+    into |= screen;
+}
+
+
+Box DamageRegion::Viewport()
+// ----------------------------------------------------------------------------
+//   The current GL viewport, for drawings that may cover all of it
+// ----------------------------------------------------------------------------
+{
+    const int *vp = GL.Viewport();
+    return Box(vp[0], vp[1], vp[2], vp[3]);
+}
+
+
+bool DamageRegion::Begin(longlong frame, const void *buffer, int w, int h,
+                         const coord *mv, const coord *proj)
+// ----------------------------------------------------------------------------
+//   Compute the areas to draw for a frame, return false if it is everything
+// ----------------------------------------------------------------------------
+//   The camera is given by the modelview and projection matrices set up
+//   for the frame. If the previous frame was not drawn in the same buffer
+//   with damage tracking, for instance by another display function, the
+//   buffer contents are unknown.
+{
+    bool full = all || !partial
+        || frame != lastFrame + 1 || buffer != target
+        || w != width || h != height
+        || memcmp(mv, modelview, sizeof(modelview)) != 0
+        || memcmp(proj, projection, sizeof(projection)) != 0;
+
+    target = buffer;
+    lastFrame = frame;
+    width = w;
+    height = h;
+    memcpy(modelview, mv, sizeof(modelview));
+    memcpy(projection, proj, sizeof(projection));
+
+    Box window(0, 0, w, h);
+    if (full)
+    {
+        current = window;
+    }
+    else
+    {
+        // Round to whole pixels, and keep only what is in the window
+        current = damage;
+        current.lower.x = floor(current.lower.x);
+        current.lower.y = floor(current.lower.y);
+        current.upper.x = ceil(current.upper.x);
+        current.upper.y = ceil(current.upper.y);
+        current &= window;
+        if (current.IsEmpty())
+            current.Empty();
+    }
+
+    // The back buffer shows the frame before the last one, and its overlay
+    region = current;
+    region |= previous[0];
+    if (overlay)
+        region |= previous[1];
+    previous[1] = previous[0];
+    previous[0] = current;
+
+    damage.Empty();
+    drawn.Empty();
+    all = false;
+    partial = false;
+    return !full;
+}
+
+
+void DamageRegion::Overflow()
+// ----------------------------------------------------------------------------
+//   Refreshed layouts were drawn outside the damage: draw everything
+// ----------------------------------------------------------------------------
+{
+    current = Box(0, 0, width, height);
+    region = current;
+    previous[0] = current;
+}
+
+
+ulong DamageRegion::Pixels(const Box &b)
+// ----------------------------------------------------------------------------
+//   Number of pixels in a box
+// ----------------------------------------------------------------------------
+{
+    if (b.IsEmpty())
+        return 0;
+    return ulong((b.upper.x - b.lower.x) * (b.upper.y - b.lower.y));
+}
+
+TAO_END
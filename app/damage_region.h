@@ -0,0 +1,107 @@
+#ifndef DAMAGE_REGION_H
+#define DAMAGE_REGION_H
+// *****************************************************************************
+// damage_region.h                                                 Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Screen area that changed since the last frame, computed from the
+//     bounds of the layouts refreshed in between, so that only that area
+//     needs to be cleared and drawn again.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "tao.h"
+#include "coords.h"
+#include "coords3d.h"
+
+TAO_BEGIN
+
+struct DamageRegion
+// ----------------------------------------------------------------------------
+//   Track the part of the window that must be drawn again for a frame
+// ----------------------------------------------------------------------------
+//   Layouts record the window area they cover as they are drawn. When a
+//   layout is refreshed, the area it covered is damaged, and the area it
+//   covers after the refresh is checked once it has been drawn again.
+//   The whole window is damaged when the program runs entirely, or when
+//   the camera, the window size or the display function changed.
+//   The back buffer holds the frame before the last one after a swap, so
+//   the area drawn there is the damage of this frame and of the previous
+//   one. An offscreen target keeps the last frame, and only needs the
+//   damage of this frame.
+//   Coordinates are window pixels, origin at the bottom left.
+{
+    enum { MARGIN = 2 };        // Pixels added around bounds (antialiasing)
+
+    DamageRegion();
+
+    void        Enable(bool enable);
+    bool        Enabled()               { return enabled; }
+    void        ShowOverlay(bool show)  { overlay = show; }
+    bool        Overlay()               { return overlay; }
+
+    // Recording changes between frames
+    void        PartialRefresh()        { partial = true; }
+    void        All()                   { all = true; }
+    void        Add(const Box &area)    { damage |= area; }
+    void        Project(Box &into, const Box3 &bounds);
+    static Box  Viewport();
+    void        Drawn(const Box &after) { drawn |= after; }
+
+    // Drawing a frame
+    bool        Begin(longlong frame, const void *target, int w, int h,
+                      const coord *mv, const coord *proj);
+    bool        Contained()             { return drawn <= Scene(); }
+    void        Overflow();
+    const Box & Current()               { return current; }
+    const Box & Region()                { return region; }
+    const Box & Scene()                 { return target ? current : region; }
+    static ulong Pixels(const Box &b);
+
+private:
+    bool        enabled;
+    bool        overlay;        // Outline the damage of each frame
+    bool        all;            // Everything must be drawn again
+    bool        partial;        // Damage describes all changes
+    Box         damage;         // Area changed since the last frame
+    Box         drawn;          // Area covered by refreshed layouts
+    Box         current;        // Damage of the frame being drawn
+    Box         region;         // Area drawn in the back buffer
+    Box         previous[2];    // Damage of the last two frames
+    const void *target;         // Offscreen buffer, NULL for back buffer
+    longlong    lastFrame;
+    int         width, height;
+    coord       modelview[16], projection[16];
+};
+
+TAO_END
+
+#endif // DAMAGE_REGION_H
@@ -39,6 +39,7 @@
 
 #include "display_driver.h"
 #include "widget.h"
+#include "gl_keepers.h"
 #include "tao_gl.h"
 #include "tao_utf8.h"
 #include "base.h"
@@ -74,6 +75,12 @@ DisplayDriver::DisplayDriver()
                                        backBufferFBOUnuse,
                                        NULL);
 
+    registerDisplayFunction("tiledviews", displayTiledViews,
+                                          tiledViewsUse,
+                                          tiledViewsUnuse,
+                                          tiledViewsSetOpt,
+                                          tiledViewsGetOpt);
+
     text name2D = useFBO() ? "2DFBO" : "2Dplain";
     registerDisplayFunctionAlias("2D", name2D);
     registerDisplayFunctionAlias("default", "2D");
@@ -309,17 +316,40 @@ void DisplayDriver::displayBackBuffer(void *)
     if (!fbname)
         GL.DrawBuffer(GL_BACK);
 
-    // Clear color and depth information
-    setGlClearColor();
-    GL.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // In the back buffer, only draw what changed since the frame it holds
+    Widget *widget = Widget::Tao();
+    DamageRegion &damage = widget->damageRegion();
+    bool partial = !fbname && widget->damageBegin(w, h, NULL);
+    if (partial)
+        scissor(&damage.Region());
 
-    // Set suitable GL parameters for drawing
-    setupGl();
+    for (;;)
+    {
+        // Clear color and depth information
+        setGlClearColor();
+        GL.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Set suitable GL parameters for drawing
+        setupGl();
+
+        // Draw scene, selection, and activities
+        drawScene();
+        drawSelection();
+        drawActivities();
+
+        // If refreshed layouts moved out of the damage, draw everything
+        if (!partial || !widget->damageOverflow())
+            break;
+        partial = false;
+        scissor(NULL);
+        setProjectionMatrix(w, h);
+        setModelViewMatrix();
+    }
 
-    // Draw scene, selection, and activities
-    drawScene();
-    drawSelection();
-    drawActivities();
+    if (!fbname && damage.Enabled() && damage.Overlay())
+        drawDamage(damage.Current(), w, h);
+    if (partial)
+        scissor(NULL);
 
     GL.Restore(save);
 }
@@ -343,9 +373,7 @@ void DisplayDriver::displayBackBufferFBO(void *obj)
     int h = renderHeight();
 
     // Make sure output buffer has the right size (resolution may have changed)
-    // and prepare to draw into it
     o->resize(w, h);
-    o->fbo->begin();
 
     GL.Viewport(0, 0, w, h);
 
@@ -353,24 +381,45 @@ void DisplayDriver::displayBackBufferFBO(void *obj)
     setProjectionMatrix(w, h);
     setModelViewMatrix();
 
-    // Clear color and depth information
-    setGlClearColor();
-    GL.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Set suitable GL parameters for drawing
-    setupGl();
+    // The FBO keeps the last frame: only draw what changed since then.
+    // Keep its contents, and prepare to draw into it
+    Widget *widget = Widget::Tao();
+    DamageRegion &damage = widget->damageRegion();
+    bool partial = widget->damageBegin(w, h, o);
+    o->fbo->begin(!partial);
+    if (partial)
+        scissor(&damage.Current());
 
-    // Draw scene, selection, and activities
-    drawScene();
-    drawSelection();
-    drawActivities();
+    for (;;)
+    {
+        // Clear color and depth information
+        setGlClearColor();
+        GL.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Set suitable GL parameters for drawing
+        setupGl();
+
+        // Draw scene, selection, and activities
+        drawScene();
+        drawSelection();
+        drawActivities();
+
+        // If refreshed layouts moved out of the damage, draw everything
+        if (!partial || !widget->damageOverflow())
+            break;
+        partial = false;
+        scissor(NULL);
+        setProjectionMatrix(w, h);
+        setModelViewMatrix();
+    }
 
     // Done with drawing.
     // Make buffer available as a texture.
     o->fbo->end();
     o->fbo->bind();
 
-    // Draw a full-screen textured quad
+    // Draw a full-screen textured quad, restricted to what changed since
+    // the frame in the back buffer
 
     // Setup viewport and geometry
     GL.Viewport(0, 0, w, h);
@@ -379,6 +428,8 @@ void DisplayDriver::displayBackBufferFBO(void *obj)
     GL.MatrixMode(GL_MODELVIEW);
     GL.LoadIdentity();
     GL.LoadMatrix();
+    if (partial)
+        scissor(&damage.Region());
 
     // Select draw buffer
     GL.DrawBuffer(GL_BACK);
@@ -404,11 +455,74 @@ void DisplayDriver::displayBackBufferFBO(void *obj)
     GL.Vertex   (-1,  1);
     GL.End();
 
+    if (damage.Enabled() && damage.Overlay())
+        drawDamage(damage.Current(), w, h);
+    if (partial)
+        scissor(NULL);
+
     // Restore state
     GL.Restore(save);
 }
 
 
+void DisplayDriver::scissor(const Box *area)
+// ----------------------------------------------------------------------------
+//   Restrict clearing and drawing to the given area, or stop doing it
+// ----------------------------------------------------------------------------
+//   The state is sent to GL immediately, because FBO blits done by Qt
+//   also obey the scissor test.
+{
+    if (area)
+    {
+        int x = area->lower.x, y = area->lower.y;
+        int w = area->upper.x - x, h = area->upper.y - y;
+        if (area->IsEmpty())
+            x = y = w = h = 0;
+        GL.Enable(GL_SCISSOR_TEST);
+        GL.Scissor(x, y, w, h);
+    }
+    else
+    {
+        GL.Disable(GL_SCISSOR_TEST);
+    }
+    GL.Sync(STATE_glflag_GL_SCISSOR_TEST | STATE_scissor);
+}
+
+
+void DisplayDriver::drawDamage(const Box &area, int w, int h)
+// ----------------------------------------------------------------------------
+//   Outline the damaged area of the frame, for debugging
+// ----------------------------------------------------------------------------
+{
+    if (area.IsEmpty())
+        return;
+
+    GL.Viewport(0, 0, w, h);
+    GL.MatrixMode(GL_PROJECTION);
+    GL.LoadIdentity();
+    GL.Ortho(0, w, 0, h, -1, 1);
+    GL.MatrixMode(GL_MODELVIEW);
+    GL.LoadIdentity();
+    GL.LoadMatrix();
+
+    GL.UseProgram(0);
+    GL.Disable(GL_TEXTURE_2D);
+    GL.Disable(GL_LIGHTING);
+    GL.Disable(GL_DEPTH_TEST);
+    GL.Disable(GL_BLEND);
+    GL.LineWidth(1);
+    GL.Color(1.0, 0.0, 0.0, 1.0);
+
+    // Lines through pixel centers, so that they stay within the area
+    GL.Begin(GL_LINE_LOOP);
+    GL.Vertex(area.lower.x + 0.5, area.lower.y + 0.5);
+    GL.Vertex(area.upper.x - 0.5, area.lower.y + 0.5);
+    GL.Vertex(area.upper.x - 0.5, area.upper.y - 0.5);
+    GL.Vertex(area.lower.x + 0.5, area.upper.y - 0.5);
+    GL.End();
+}
+
+
 void * DisplayDriver::backBufferFBOUse()
 // ----------------------------------------------------------------------------
 //   2D back buffer FBO display is about to be used: allocate context
@@ -428,6 +542,111 @@ void DisplayDriver::backBufferFBOUnuse(void *obj)
 }
 
 
+void DisplayDriver::displayTiledViews(void *obj)
+// ----------------------------------------------------------------------------
+//   Draw all viewpoints as tiles of the back buffer
+// ----------------------------------------------------------------------------
+//   Tiles form a square grid, so that each of them shows the whole scene
+//   with the aspect ratio of the window.
+{
+    // Save graphic state
+    Tao::GraphicSave *save = GL.Save();
+
+    TiledViewsParams *o = (TiledViewsParams *) obj;
+    int w = renderWidth();
+    int h = renderHeight();
+    int n = getEyesNumber();
+    for (o->columns = 1; o->columns * o->columns < n; o->columns++)
+        /* Nothing */;
+    o->rows = o->columns;
+
+    // Clear the whole window once, tiles only clear depth information
+    GLint fbname = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fbname);
+    if (!fbname)
+        GL.DrawBuffer(GL_BACK);
+    GL.Viewport(0, 0, w, h);
+    setGlClearColor();
+    GL.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // The mouse is tracked as if the first viewpoint covered the window
+    setMouseTrackingViewport(0, 0, w, h);
+    drawViews(w, h, tiledView, o);
+
+    // Activities cover the whole window
+    GL.Viewport(0, 0, w, h);
+    setProjectionMatrix(w, h);
+    setModelViewMatrix();
+    setupGl();
+    drawActivities();
+
+    GL.Restore(save);
+}
+
+
+void DisplayDriver::tiledView(void *obj, int i)
+// ----------------------------------------------------------------------------
+//   Select the tile for the given viewpoint, first one at the top left
+// ----------------------------------------------------------------------------
+{
+    TiledViewsParams *o = (TiledViewsParams *) obj;
+    int w = renderWidth() / o->columns;
+    int h = renderHeight() / o->rows;
+    int column = (i - 1) % o->columns;
+    int row = (i - 1) / o->columns;
+    GL.Viewport(column * w, (o->rows - 1 - row) * h, w, h);
+    GL.Clear(GL_DEPTH_BUFFER_BIT);
+}
+
+
+void * DisplayDriver::tiledViewsUse()
+// ----------------------------------------------------------------------------
+//   Tiled views display is about to be used: allocate context
+// ----------------------------------------------------------------------------
+{
+    return new TiledViewsParams();
+}
+
+
+void DisplayDriver::tiledViewsUnuse(void *obj)
+// ----------------------------------------------------------------------------
+//   Done with tiled views display
+// ----------------------------------------------------------------------------
+{
+    delete (TiledViewsParams *)obj;
+}
+
+
+bool DisplayDriver::tiledViewsSetOpt(void *obj, std::string name,
+                                     std::string val)
+// ----------------------------------------------------------------------------
+//   Set the number of viewpoints
+// ----------------------------------------------------------------------------
+{
+    TiledViewsParams *o = (TiledViewsParams *) obj;
+    if (name != "PointsOfView")
+        return false;
+    int views = (+val).toInt();
+    if (views < 1)
+        return false;
+    o->views = views;
+    setStereoPlanes(views);
+    return true;
+}
+
+
+std::string DisplayDriver::tiledViewsGetOpt(void *obj, std::string name)
+// ----------------------------------------------------------------------------
+//   Return the number of viewpoints
+// ----------------------------------------------------------------------------
+{
+    TiledViewsParams *o = (TiledViewsParams *) obj;
+    if (name == "PointsOfView")
+        return +QString::number(o->views);
+    return "";
+}
+
+
 // ============================================================================
 //
 //   Static methods exported to module API
@@ -684,6 +903,45 @@ void DisplayDriver::setMouseTrackingViewport(int x, int y, int w, int h)
 }
 
 
+void DisplayDriver::drawViews(int w, int h,
+                              ModuleApi::draw_view_fn view, void *arg)
+// ----------------------------------------------------------------------------
+//   Draw the scene and selection for all viewpoints
+// ----------------------------------------------------------------------------
+//   The scene is drawn from the layouts for the first viewpoint, and
+//   replayed for the others when nothing in it depends on the viewpoint.
+{
+    Widget *widget = Widget::Tao();
+    ViewReplay &replay = widget->viewReplay();
+    bool tracking = widget->mouseTracking();
+    int n = getEyesNumber();
+
+    replay.Begin();
+    for (int i = 1; i <= n; i++)
+    {
+        view(arg, i);
+        setProjectionMatrix(w, h, i, n);
+        setModelViewMatrix(i, n);
+        setupGl();
+        doMouseTracking(tracking && i == 1);
+
+        if (!replay.Replay())
+        {
+            bool recording = replay.Record();
+            drawScene();
+            if (recording)
+                replay.Recorded();
+            replay.drawn++;
+        }
+
+        // Restore the state the recorded scene started from
+        GLAllStateKeeper save;
+        drawSelection();
+    }
+    doMouseTracking(tracking);
+}
+
+
 void DisplayDriver::setProjectionMatrix(int w, int h, int i, int)
 // ----------------------------------------------------------------------------
 //   Set frustum for the given camera
@@ -100,6 +100,8 @@ public:
     static void         setModelViewMatrix (int i = 1, int unused = -1);
     static void         doMouseTracking(bool on);
     static void         setMouseTrackingViewport(int x, int y, int w, int h);
+    static void         drawViews(int w, int h,
+                                  ModuleApi::draw_view_fn view, void *arg);
 
 
 protected:
@@ -145,6 +147,28 @@ protected:
     static void *       backBufferFBOUse();
     static void         backBufferFBOUnuse(void *arg);
 
+    // All viewpoints side by side in the back buffer, e.g. to check or
+    // benchmark multi-view rendering without a multi-view display
+
+    struct TiledViewsParams
+    {
+        TiledViewsParams(): views(8), columns(1), rows(1) {}
+
+        int          views;
+        int          columns, rows;
+    };
+    static void         displayTiledViews(void *);
+    static void *       tiledViewsUse();
+    static void         tiledViewsUnuse(void *arg);
+    static bool         tiledViewsSetOpt(void *arg, std::string name,
+                                         std::string val);
+    static std::string  tiledViewsGetOpt(void *arg, std::string name);
+    static void         tiledView(void *arg, int i);
+
+    // Damage regions: only clear and draw what changed in 2D rendering
+    static void         scissor(const Box *area);
+    static void         drawDamage(const Box &area, int w, int h);
+
 
     static double       stereoDelta(int i, int numCameras);
 
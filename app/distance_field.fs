@@ -0,0 +1,45 @@
+// *****************************************************************************
+// distance_field.fs                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Fragment shader for glyphs cached as signed distance fields
+//
+//     The alpha of the glyph texture is 0.5 on the outline. Antialiasing
+//     is done over one pixel on screen, whatever the size of the glyph.
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+uniform sampler2D glyphs;
+
+void main(void)
+{
+    float distance = texture2D(glyphs, gl_TexCoord[0].st).a;
+    float width = fwidth(distance);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * alpha);
+}
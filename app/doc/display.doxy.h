@@ -63,6 +63,10 @@
  * @image html alioscopy_small.png "Alioscopy® (\"alioscopy\")"
  * @image html alioscopy_detail.png "Alioscopy® (detail)"
  *
+ * The @c tiledviews mode shows all the viewpoints side by side in a grid,
+ * 8 by default. The number of viewpoints is set with
+ * <tt>display_set PointsOfView := n</tt>.
+ *
  * @~french
  * @defgroup Display Affichage et contrôle de la stéréoscopie
  * @ingroup TaoBuiltins
@@ -92,6 +96,10 @@
  * @image html alioscopy_small.png "Alioscopy® (\"alioscopy\")"
  * @image html alioscopy_detail.png "Alioscopy® (détail)"
  *
+ * Le mode @c tiledviews montre tous les points de vue côte à côte dans une
+ * grille, 8 par défaut. Le nombre de points de vue est défini par
+ * <tt>display_set PointsOfView := n</tt>.
+ *
  * @~
  * @{
  */
@@ -107,6 +107,11 @@
  * @ref texture_cache_mem_size, @ref texture_cache_gl_size,
  * @ref texture_compress, and @ref texture_mipmap.
  *
+ * When textures are compressed, the compressed data are also kept in a store
+ * on disk, shared by all documents, so that the next time the same picture is
+ * used, it can be sent to OpenGL directly without being decoded and
+ * compressed again. The size of this store is set by @ref texture_store_size.
+ *
  * When a file is changed on disk, it is reloaded automatically. If a file is
  * deleted or renamed, the texture is replaced by a placeholder. If a
  * non-existent texture file is created, the texture is also updated.
@@ -169,6 +174,12 @@
  * @ref texture_cache_mem_size, @ref texture_cache_gl_size,
  * @ref texture_compress, et @ref texture_mipmap.
  *
+ * Lorsque les textures sont compressées, les données compressées sont aussi
+ * conservées sur le disque dans un espace partagé par tous les documents, afin
+ * que la prochaine utilisation de la même image puisse les envoyer directement
+ * à OpenGL sans décoder ni compresser à nouveau. La taille de cet espace est
+ * définie par @ref texture_store_size.
+ *
  * Lorsqu'un fichier d'image est modifié sur le disque, il est rechargé
  * automatiquement. S'il est effacé, la texture est remplacée par une image
  * par défaut (une mire colorée). Si un fichier non existent est créé,
@@ -1430,6 +1441,50 @@ texture_cache_mem_size(bytes:integer);
  */
 texture_cache_gl_size(bytes:integer);
 
+/**
+ * @~english
+ * Enables or disables progressive loading of textures.
+ * When enabled (the default), textures used in the frame being drawn are
+ * never purged from memory to make room for other ones. If many images must
+ * be loaded for the same frame, large JPEG images are first shown at low
+ * resolution, and are refined in the next frames. Finally, the textures
+ * that were used by the next page the last time it was shown are loaded in
+ * advance.
+ * Returns the previous state.
+ * @~french
+ * Active ou désactive le chargement progressif des textures.
+ * Lorsqu'il est actif (par défaut), les textures utilisées pour l'image en
+ * cours d'affichage ne sont jamais supprimées de la mémoire pour faire de la
+ * place à d'autres. Si de nombreuses images doivent être chargées pour la
+ * même affichage, les grandes images JPEG sont d'abord affichées en basse
+ * résolution, puis affinées dans les affichages suivants. Enfin, les textures
+ * utilisées par la page suivante la dernière fois qu'elle a été affichée sont
+ * chargées à l'avance.
+ * Renvoie l'état précédent.
+ */
+texture_streaming(enable:boolean);
+
+/**
+ * @~english
+ * Defines the amount of disk space used to store compressed textures.
+ * When @ref texture_compress is enabled, the compressed data for each
+ * picture file is saved on disk in the background, and reused by all
+ * documents in later sessions. When the store is full, the least recently
+ * used textures are removed. 20% of @p bytes are freed.
+ * A value of 0 disables the store.
+ * @return the previous value.
+ * @~french
+ * Définit l'espace disque utilisé pour conserver les textures compressées.
+ * Lorsque @ref texture_compress est actif, les données compressées de chaque
+ * fichier image sont enregistrées sur le disque en tâche de fond, et
+ * réutilisées par tous les documents lors des sessions suivantes. Lorsque
+ * l'espace est plein, les textures qui n'ont pas été utilisées récemment
+ * sont supprimées. 20% de @p bytes sont libérés.
+ * La valeur 0 désactive l'enregistrement.
+ * @return la valeur précédente.
+ */
+texture_store_size(bytes:integer);
+
 /**
  * @~english
  * Invalidates stale network images.
@@ -1534,6 +1589,26 @@ animated_texture(filename:text);
  */
 svg(svg:text);
 
+/**
+ * @~english
+ * Creates a texture of @p w by @p h pixels from an SVG file.
+ * This is the same as @ref svg, except that the SVG is rasterized at the
+ * given resolution instead of 512x512 pixels. Rasterized SVGs are shared
+ * between all uses of the same file at the same size, and are rendered
+ * again only when the file changes or when an animated SVG moves to a new
+ * frame. Only animated SVGs cause the page to be refreshed periodically.
+ *
+ * @~french
+ * Crée une texture de @p w par @p h pixels à partir d'un fichier SVG.
+ * Identique à @ref svg, mais l'image est rendue à la résolution donnée au
+ * lieu de 512x512 pixels. Les images rendues sont partagées entre toutes
+ * les utilisations d'un même fichier à la même taille, et ne sont
+ * recalculées que lorsque le fichier change ou qu'un SVG animé passe à
+ * l'image suivante. Seuls les SVG animés provoquent un rafraîchissement
+ * périodique de la page.
+ */
+svg(svg:text, w:integer, h:integer);
+
 /**
  * @~english
  * Geometric transformation for texture.
@@ -2266,6 +2341,33 @@ elliptical_rectangle (x:real, y:real, w:real, h:real, r:real);
  */
 ellipse (x:real, y:real, w:real, h:real);
 
+/**
+ * @~english
+ * Draws an SVG file as vector shapes.
+ *
+ * The SVG document @p img is scaled to fit the rectangle centered at
+ * (@a x, @a y) with width @a w and height @a h. Unlike @ref svg, the
+ * document is not rasterized into a texture: its paths are converted
+ * once into triangles, with their fill, stroke and gradient colors, and
+ * this geometry is shared by all shapes using the same file. The shape
+ * therefore remains crisp at any zoom level. Animations, embedded images
+ * and clipping are not supported; use @ref svg for such documents.
+ *
+ * @~french
+ * Affiche un fichier SVG sous forme de formes vectorielles.
+ *
+ * Le document SVG @p img est mis à l'échelle du rectangle centré en
+ * (@a x, @a y), de largeur @a w et de hauteur @a h. Contrairement à
+ * @ref svg, le document n'est pas converti en texture : ses chemins sont
+ * transformés une fois pour toutes en triangles, avec leurs couleurs de
+ * remplissage, de contour et leurs dégradés, et cette géométrie est
+ * partagée par toutes les formes utilisant le même fichier. La forme reste
+ * donc nette quel que soit le zoom. Les animations, les images incluses et
+ * le découpage ne sont pas pris en charge ; utilisez @ref svg pour ces
+ * documents.
+ */
+svg_shape (x:real, y:real, w:real, h:real, img:text);
+
 /**
  * @~english
  * Draws a circle.
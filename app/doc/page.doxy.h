@@ -279,6 +279,34 @@ page_thumbnail (s:real, i:real, p:text);
  */
 save_page_thumbnail(w:real, h:real, pnum:text, path:text, ptime:real);
 
+/**
+ * @~english
+ * Returns the path of a thumbnail picture of the specified page.
+ * @p w and @p h are the maximum width and height of the picture, in pixels.
+ * @p p is the name of the page. @p ptime is the value of @ref page_time
+ * used to take the snapshot of the page (default value: 0.0).
+ * Thumbnails are generated in the background, one page at a time, so that
+ * the current page keeps being displayed. Pages with a higher @p priority
+ * are generated first (default value: 0). Until the thumbnail is available,
+ * the path is empty, and the current layout is refreshed when it becomes
+ * available. Thumbnails are kept in a cache on disk, and are generated again
+ * only if the source code of the page changes.
+ *
+ * @~french
+ * Renvoie le chemin d'une miniature de la page spécifiée.
+ * @p w et @p h sont la largeur et la hauteur maximales de l'image, en pixels.
+ * @p p est le nom de la page. @p ptime est la valeur de @ref page_time
+ * utilisée pour faire la capture de la page (valeur par défaut : 0.0).
+ * Les miniatures sont créées en tâche de fond, une page à la fois, de sorte
+ * que la page courante continue à être affichée. Les pages de priorité
+ * @p priority plus élevée sont créées en premier (valeur par défaut : 0).
+ * Tant que la miniature n'est pas disponible, le chemin est vide, et le
+ * layout courant est rafraîchi lorsqu'elle le devient. Les miniatures sont
+ * conservées dans un cache sur disque, et ne sont recréées que si le code
+ * source de la page change.
+ */
+text page_thumbnail_file(w:real, h:real, p:text, ptime:real, priority:integer);
+
 /**
  * @~english
  * Returns the number of pages in the current document.
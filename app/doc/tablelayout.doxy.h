@@ -101,6 +101,65 @@ table(x:real, y:real, r:integer, c:integer, contents:tree);
  */
 table(r:integer, c:integer, contents:tree);
 
+/**
+ * @~english
+ * Creates a table of @p r rows and @p c columns that only evaluates the
+ * rows that are visible.
+ *
+ * The table is centered at (@p x, @p y) and is @p h pixels high. It shows
+ * the rows starting @p s pixels below the top of the first row, so that
+ * changing @p s scrolls the table. Unlike @ref table, the @p contents code
+ * block describes a single cell, and is executed once for each visible
+ * cell, with @ref table_cell_row and @ref table_cell_column giving the
+ * index of the cell. This makes the cost of a refresh independent of the
+ * number of rows, e.g. for large data tables.
+ *
+ * The height of each row is measured the first time it is shown, and
+ * remembered. Rows that were not shown yet are assumed to have the average
+ * height of the measured rows. Use @ref table_row_height to give all rows
+ * the same height. Column widths grow to the widest cell shown so far.
+ *
+ * Example:
+ * @code
+virtual_table 0, 0, 5000, 3, 400, 20 * page_time,
+    row_height 20
+    text_box 0, 0, 100, 20,
+        text "Row " & text row & ", column " & text column
+ * @endcode
+ *
+ * @~french
+ * Crée un tableau de @p r lignes et @p c colonnes qui n'évalue que les
+ * lignes visibles.
+ *
+ * Le tableau est centré en (@p x, @p y) et a une hauteur de @p h pixels.
+ * Il affiche les lignes à partir de @p s pixels sous le haut de la première
+ * ligne, si bien que modifier @p s fait défiler le tableau. Contrairement à
+ * @ref table, le bloc de code @p contents décrit une seule cellule, et est
+ * exécuté pour chaque cellule visible, @ref table_cell_row et
+ * @ref table_cell_column donnant l'index de la cellule. Le coût d'un
+ * rafraîchissement ne dépend donc pas du nombre de lignes.
+ *
+ * La hauteur de chaque ligne est mesurée la première fois qu'elle est
+ * affichée, puis mémorisée. Les lignes jamais affichées sont supposées avoir
+ * la hauteur moyenne des lignes mesurées. Utilisez @ref table_row_height
+ * pour donner la même hauteur à toutes les lignes. La largeur des colonnes
+ * s'adapte à la plus large cellule affichée jusque-là.
+ */
+virtual_table(x:real, y:real, r:integer, c:integer, h:real, s:real, contents:tree);
+
+/**
+ * @~english
+ * Gives all rows of the current table a height of @p h pixels.
+ * Rows are then not measured, which is faster for @ref virtual_table.
+ * The short name is @c row_height.
+ *
+ * @~french
+ * Donne à toutes les lignes du tableau une hauteur de @p h pixels.
+ * Les lignes ne sont alors pas mesurées, ce qui est plus rapide pour
+ * @ref virtual_table. Le nom court est @c row_height.
+ */
+table_row_height(h:real);
+
 /**
  * @~english
  * Inserts a fixed-size cell of @p w x @p h pixels.
@@ -132,6 +132,152 @@ boolean enable_animations(animations:boolean);
 boolean show_statistics(flag:boolean);
 
 
+/**
+ * @~english
+ * Controls damage regions.
+ *
+ * When @p flag is true, only the parts of the window covered by layouts
+ * refreshed since the last frame are cleared and drawn again, for
+ * instance the area of a clock animated with @ref refresh. The whole
+ * window is drawn when the program is evaluated entirely, when the camera
+ * or the window size changes, or while objects are selected.
+ * The number of pixels drawn per frame is shown in the rendering
+ * statistics. The @c -damage command-line option enables damage regions.
+ * @returns the previous value.
+ *
+ * @~french
+ * Active ou désactive les zones modifiées.
+ *
+ * Lorsque @p flag vaut @c true, seules les parties de la fenêtre couvertes
+ * par les layouts rafraîchis depuis l'image précédente sont effacées et
+ * redessinées, par exemple la zone d'une horloge animée avec @ref refresh.
+ * Toute la fenêtre est redessinée lorsque le programme est évalué
+ * entièrement, lorsque la caméra ou la taille de la fenêtre change, ou
+ * lorsque des objets sont sélectionnés.
+ * Le nombre de pixels dessinés par image est indiqué dans les statistiques
+ * d'affichage. L'option de ligne de commande @c -damage active les zones
+ * modifiées.
+ * @returns la valeur précédente.
+ */
+boolean damage_regions(flag:boolean);
+
+
+/**
+ * @~english
+ * Outlines damage regions.
+ *
+ * When @p flag is true and @ref damage_regions is enabled, the part of
+ * the window drawn for each frame is outlined in red.
+ * @returns the previous value.
+ *
+ * @~french
+ * Montre les zones modifiées.
+ *
+ * Lorsque @p flag vaut @c true et que @ref damage_regions est actif, la
+ * partie de la fenêtre dessinée pour chaque image est entourée de rouge.
+ * @returns la valeur précédente.
+ */
+boolean show_damage_regions(flag:boolean);
+
+
+/**
+ * @~english
+ * Controls frustum culling.
+ *
+ * When @p flag is true (the default), rectangles, 3D shapes, paths and
+ * layouts that are entirely outside of the view are not drawn. The bounds
+ * of a layout are computed when it is drawn, and kept until it is
+ * refreshed, so that a layout outside of the view is skipped as a whole.
+ * Layouts containing text, modules or shaders are always drawn.
+ * The number of drawings drawn and culled per frame is shown in the
+ * rendering statistics. The @c -noculling command-line option disables
+ * frustum culling.
+ * @returns the previous value.
+ *
+ * @~french
+ * Active ou désactive l'élimination hors du champ de vision.
+ *
+ * Lorsque @p flag vaut @c true (par défaut), les rectangles, formes 3D,
+ * chemins et layouts entièrement hors du champ de vision ne sont pas
+ * dessinés. Les limites d'un layout sont calculées lorsqu'il est dessiné,
+ * et conservées jusqu'à ce qu'il soit rafraîchi, de sorte qu'un layout hors
+ * du champ est ignoré en entier. Les layouts contenant du texte, des
+ * modules ou des shaders sont toujours dessinés.
+ * Le nombre d'objets dessinés et éliminés par image est indiqué dans les
+ * statistiques d'affichage. L'option de ligne de commande @c -noculling
+ * désactive l'élimination.
+ * @returns la valeur précédente.
+ */
+boolean frustum_culling(flag:boolean);
+
+
+/**
+ * @~english
+ * Controls the replay of the scene for multi-view displays.
+ *
+ * When @p flag is true (the default), the display modes that show the
+ * scene from several viewpoints, like stereoscopic or autostereoscopic
+ * modes, draw the layouts for the first viewpoint only, and replay the
+ * recorded drawing commands with the camera of the other viewpoints.
+ * Pages containing stereo layouts, modules that draw themselves or
+ * offscreen frames are drawn again for each viewpoint.
+ * The number of viewpoints drawn and replayed per frame is shown in the
+ * rendering statistics. The @c -nomultiview command-line option disables
+ * the replay.
+ * @returns the previous value.
+ *
+ * @~french
+ * Active ou désactive la réutilisation de la scène pour les affichages
+ * multi-vues.
+ *
+ * Lorsque @p flag vaut @c true (par défaut), les modes d'affichage qui
+ * montrent la scène depuis plusieurs points de vue, comme les modes
+ * stéréoscopiques ou autostéréoscopiques, dessinent les layouts pour le
+ * premier point de vue seulement, et rejouent les commandes de dessin
+ * enregistrées avec la caméra des autres points de vue.
+ * Les pages contenant des layouts stéréo, des modules qui se dessinent
+ * eux-mêmes ou des frames hors écran sont redessinées pour chaque point de
+ * vue.
+ * Le nombre de points de vue dessinés et rejoués par image est indiqué dans
+ * les statistiques d'affichage. L'option de ligne de commande
+ * @c -nomultiview désactive la réutilisation.
+ * @returns la valeur précédente.
+ */
+boolean multiview_replay(flag:boolean);
+
+
+/**
+ * @~english
+ * Controls the batching of draw calls.
+ *
+ * When @p flag is true, consecutive rectangles and triangles that are
+ * drawn with the same attributes, without outline, are drawn with a single
+ * draw call. A shape that overlaps one of the previous ones starts a new
+ * draw call, so that shapes are still drawn on top of the ones before
+ * them. When @p flag is false (the default), each shape is drawn with its
+ * own draw calls.
+ * The number of draw calls per frame, with and without batching, is shown
+ * in the rendering statistics. The @c -batch command-line option
+ * enables batching.
+ * @returns the previous value.
+ *
+ * @~french
+ * Active ou désactive le regroupement des appels de dessin.
+ *
+ * Lorsque @p flag vaut @c true, les rectangles et triangles consécutifs,
+ * dessinés avec les mêmes attributs et sans contour, sont dessinés en un
+ * seul appel. Une forme qui recouvre l'une des précédentes commence un
+ * nouvel appel, de sorte que les formes restent dessinées par-dessus celles
+ * qui les précèdent. Lorsque @p flag vaut @c false (par défaut), chaque
+ * forme est dessinée avec ses propres appels.
+ * Le nombre d'appels de dessin par image, avec et sans regroupement, est
+ * indiqué dans les statistiques d'affichage. L'option de ligne de commande
+ * @c -batch active le regroupement.
+ * @returns la valeur précédente.
+ */
+boolean draw_batching(flag:boolean);
+
+
 /**
  * @~english
  * Reset document view to default parameters.
@@ -1712,6 +1712,50 @@ glyph_cache_size_range (min:real, max:real);
 glyph_cache_scaling (scaling:real, minSize:real);
 
 
+/**
+ * @~english
+ * Cache glyphs as signed distance fields.
+ * When @p flag is true, each glyph is rasterized only once per font
+ * family, weight and style, and its distance to the outline is stored in
+ * the glyph cache. A shader draws it with sharp edges at any size, so
+ * that zooming or animating the font size does not rasterize glyphs
+ * again, and @ref glyph_cache_size_range no longer limits the use of the
+ * glyph cache. When shaders are not available, or while a shader is
+ * active, bitmaps are used as before. Distance fields are disabled by
+ * default, and the @c -sdf command-line option enables them. Distance
+ * fields take less room in the glyph cache, but computing them makes the
+ * first rasterization of each glyph several times slower. Compare the
+ * rendering statistics with and without this option to check if it helps
+ * a given document. The number of glyphs rasterized per frame,
+ * the time spent doing so and the size of the glyph cache are shown in
+ * the rendering statistics.
+ * @returns the previous value.
+ * @see enable_glyph_cache
+ *
+ * @~french
+ * Stocke les glyphes sous forme de champs de distance signée.
+ * Lorsque @p flag vaut @c true, chaque glyphe n'est tracé qu'une fois par
+ * famille, graisse et style de police, et sa distance au contour est
+ * stockée dans le cache de glyphes. Un shader le dessine avec des bords
+ * nets à toutes les tailles, si bien qu'un zoom ou une animation de la
+ * taille de police ne retrace pas les glyphes, et que
+ * @ref glyph_cache_size_range ne limite plus l'usage du cache.
+ * Lorsque les shaders ne sont pas disponibles, ou qu'un shader est actif,
+ * les bitmaps sont utilisés comme auparavant. Les champs de distance sont
+ * désactivés par défaut, et l'option de ligne de commande @c -sdf les
+ * active. Les champs de distance occupent moins de place dans le cache de
+ * glyphes, mais leur calcul rend le premier tracé de chaque glyphe
+ * plusieurs fois plus lent. Comparez les statistiques d'affichage avec et
+ * sans cette option pour vérifier si elle est utile pour un document donné.
+ * Le nombre de glyphes tracés par image, le temps passé à les tracer et la
+ * taille du cache de glyphes sont indiqués dans les statistiques
+ * d'affichage.
+ * @returns la valeur précédente.
+ * @see enable_glyph_cache
+ */
+boolean glyph_cache_distance_field (flag:boolean);
+
+
 /**
  * @~english
  * Return the width in pixels of the specified text rendered with the
@@ -0,0 +1,264 @@
+// *****************************************************************************
+// document_writer.cpp                                             Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Background writer for document source files. Saves are coalesced,
+//     skipped when the contents did not change, and made atomic with a
+//     synchronized temporary file renamed over the original.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "document_writer.h"
+#include "tao_utf8.h"
+#include "base.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <cstdio>
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Tao {
+
+QWeakPointer<DocumentWriter> DocumentWriter::inst;
+
+
+DocumentWriter::DocumentWriter()
+// ----------------------------------------------------------------------------
+//   Start the writer thread
+// ----------------------------------------------------------------------------
+    : busy(false), flushing(false), quit(false)
+{
+    lastQueued.start();
+    start();
+}
+
+
+DocumentWriter::~DocumentWriter()
+// ----------------------------------------------------------------------------
+//   Write pending files without waiting, then stop the thread
+// ----------------------------------------------------------------------------
+{
+    mutex.lock();
+    quit = true;
+    cond.wakeOne();
+    mutex.unlock();
+    wait();
+}
+
+
+QSharedPointer<DocumentWriter> DocumentWriter::instance()
+// ----------------------------------------------------------------------------
+//    Return a pointer to the instance of the document writer
+// ----------------------------------------------------------------------------
+{
+    QSharedPointer<DocumentWriter> ptr;
+    if (!inst)
+    {
+        ptr = QSharedPointer<DocumentWriter>(new DocumentWriter);
+        inst = ptr.toWeakRef();
+    }
+    else
+    {
+        ptr = inst.toStrongRef();
+        XL_ASSERT(ptr);
+    }
+    return ptr;
+}
+
+
+void DocumentWriter::write(const QString &path, const QByteArray &data)
+// ----------------------------------------------------------------------------
+//   Queue contents for a file, replacing contents queued earlier
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    IFTRACE(filesync)
+        debug() << (jobs.contains(path) ? "Coalesce '" : "Queue '")
+                << +path << "' " << data.size() << " bytes\n";
+    jobs[path] = data;
+    lastQueued.restart();
+    cond.wakeOne();
+}
+
+
+void DocumentWriter::flush()
+// ----------------------------------------------------------------------------
+//   Write pending files now, and wait until they are on disk
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    if (jobs.isEmpty() && !busy)
+        return;
+    flushing = true;
+    cond.wakeOne();
+    while (!jobs.isEmpty() || busy)
+        done.wait(&mutex);
+    flushing = false;
+}
+
+
+bool DocumentWriter::pending(const QString &path)
+// ----------------------------------------------------------------------------
+//   Return true if contents for the file are waiting to be written
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    return jobs.contains(path);
+}
+
+
+void DocumentWriter::run()
+// ----------------------------------------------------------------------------
+//   Write queued files once no new save came in for a short while
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    while (!quit || !jobs.isEmpty())
+    {
+        if (jobs.isEmpty())
+        {
+            done.wakeAll();
+            cond.wait(&mutex);
+            continue;
+        }
+
+        qint64 quiet = lastQueued.elapsed();
+        if (!quit && !flushing && quiet < COALESCE_DELAY)
+        {
+            cond.wait(&mutex, COALESCE_DELAY - quiet);
+            continue;
+        }
+
+        DataMap::iterator first = jobs.begin();
+        QString path = first.key();
+        QByteArray data = first.value();
+        jobs.erase(first);
+        busy = true;
+        locker.unlock();
+
+        // Only this thread uses 'hashes', no need to lock it
+        QByteArray hash = QCryptographicHash::hash(data,
+                                                   QCryptographicHash::Sha1);
+        QFileInfo info(path);
+        HashMap::iterator known = hashes.find(path);
+        if (known != hashes.end() &&
+            (known->modified != info.lastModified() ||
+             known->size != info.size()))
+        {
+            // Someone else changed the file since we last wrote it
+            hashes.erase(known);
+        }
+        if (!hashes.contains(path))
+        {
+            // First save of this file: compare with what is on disk
+            QFile current(path);
+            if (current.open(QIODevice::ReadOnly))
+                hashes[path] = Contents(QCryptographicHash::hash(
+                                           current.readAll(),
+                                           QCryptographicHash::Sha1),
+                                       info);
+        }
+        bool changed = hashes.value(path).hash != hash;
+        bool ok = true;
+        if (changed)
+            ok = writeFile(path, data);
+        if (ok)
+            hashes[path] = Contents(hash, QFileInfo(path));
+        else
+            hashes.remove(path);
+
+        IFTRACE(filesync)
+            debug() << (!changed ? "Unchanged '" : ok ? "Wrote '"
+                                                      : "Failed writing '")
+                    << +path << "'\n";
+
+        locker.relock();
+        busy = false;
+        emit written(path, changed, ok);
+    }
+    done.wakeAll();
+}
+
+
+bool DocumentWriter::writeFile(const QString &path, const QByteArray &data)
+// ----------------------------------------------------------------------------
+//   Write a file atomically: write and sync a copy, then rename it
+// ----------------------------------------------------------------------------
+//   Called from the thread with mutex unlocked
+{
+    QString copy = path + "~";
+    QFile out(copy);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    bool ok = out.write(data) == data.size() && out.flush();
+#if defined(Q_OS_WIN)
+    ok = ok && _commit(out.handle()) == 0;
+#else
+    ok = ok && fsync(out.handle()) == 0;
+#endif
+    out.close();
+    if (!ok)
+    {
+        QFile::remove(copy);
+        return false;
+    }
+
+    QByteArray from = QFile::encodeName(copy);
+    QByteArray to = QFile::encodeName(path);
+#if defined(Q_OS_WIN)
+    // On Windows, std::rename fails if destination exists, hence the
+    // rename/rename/remove
+    QByteArray backup = QFile::encodeName(path + ".bak");
+    ok = std::rename(to.constData(), backup.constData()) == 0;
+    if (ok)
+        ok = std::rename(from.constData(), to.constData()) == 0;
+    if (ok)
+        ok = std::remove(backup.constData()) == 0;
+#else
+    // Replaces the original atomically
+    ok = std::rename(from.constData(), to.constData()) == 0;
+#endif
+    return ok;
+}
+
+
+std::ostream & DocumentWriter::debug()
+// ----------------------------------------------------------------------------
+//   Convenience method to log with a common prefix
+// ----------------------------------------------------------------------------
+{
+    std::cerr << "[DocumentWriter] ";
+    return std::cerr;
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef DOCUMENT_WRITER_H
+#define DOCUMENT_WRITER_H
+// *****************************************************************************
+// document_writer.h                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Background writer for document source files. Saves are coalesced,
+//     skipped when the contents did not change, and made atomic with a
+//     synchronized temporary file renamed over the original.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "tao.h"
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QByteArray>
+#include <QString>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <iostream>
+
+namespace Tao {
+
+
+class DocumentWriter : public QThread
+// ----------------------------------------------------------------------------
+//    Singleton. Writes rendered source files to disk in a thread
+// ----------------------------------------------------------------------------
+//    A file queued again before it was written only keeps the latest
+//    contents, and writes wait for a short quiet period so that bursts of
+//    saves (e.g. while dragging) result in a single write.
+//    The thread remembers the SHA-1 of what each file contains, and does
+//    not touch files whose contents would not change. The SHA-1 is computed
+//    again from the file when its size or modification time changed, since
+//    someone else may have modified it.
+{
+    Q_OBJECT
+
+public:
+    enum { COALESCE_DELAY = 250 };      // ms without new save before write
+
+    static QSharedPointer<DocumentWriter> instance();
+
+public:
+    virtual ~DocumentWriter();
+
+    void            write(const QString &path, const QByteArray &data);
+    void            flush();
+    bool            pending(const QString &path);
+
+signals:
+    void            written(QString path, bool changed, bool ok);
+
+protected:
+    DocumentWriter();
+    virtual void    run();
+
+private:
+    bool            writeFile(const QString &path, const QByteArray &data);
+    std::ostream &  debug();
+
+private:
+    struct Contents
+    // ------------------------------------------------------------------------
+    //   What we know a file contains, and when it was last modified
+    // ------------------------------------------------------------------------
+    {
+        Contents(): hash(), modified(), size(-1) {}
+        Contents(const QByteArray &hash, const QFileInfo &info)
+            : hash(hash), modified(info.lastModified()), size(info.size()) {}
+        QByteArray      hash;
+        QDateTime       modified;
+        qint64          size;
+    };
+    typedef QMap<QString, QByteArray>   DataMap;
+    typedef QMap<QString, Contents>     HashMap;
+
+    QMutex          mutex;
+    QWaitCondition  cond, done;
+    DataMap         jobs;               // Path -> contents to write
+    HashMap         hashes;             // Path -> SHA-1 on disk (thread)
+    QElapsedTimer   lastQueued;
+    bool            busy, flushing, quit;
+
+private:
+    static QWeakPointer<DocumentWriter> inst;
+};
+
+}
+
+#endif // DOCUMENT_WRITER_H
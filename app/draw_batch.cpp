@@ -0,0 +1,164 @@
+// *****************************************************************************
+// draw_batch.cpp                                                  Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Batching of consecutive shapes drawn with the same layout state, so
+//     that they are sent to OpenGL with a single draw call.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "draw_batch.h"
+#include "gl_keepers.h"
+#include "layout.h"
+#include "opengl_state.h"
+#include "shapes.h"
+
+TAO_BEGIN
+
+DrawBatch::DrawBatch()
+// ----------------------------------------------------------------------------
+//   Start disabled, with nothing pending
+// ----------------------------------------------------------------------------
+    : merged(0), enabled(false), layout(NULL), depth(0),
+      vertices(), boxes()
+{}
+
+
+bool DrawBatch::Add(Layout *where, GraphicPath &path)
+// ----------------------------------------------------------------------------
+//   Add the fill of a path to the batch, return false if it can't be batched
+// ----------------------------------------------------------------------------
+//   The path must be a single flat contour of straight lines, which is what
+//   GraphicPath::Draw would draw as one polygon without tesselation.
+{
+    if (!enabled || where->extrudeDepth > 0.0)
+        return false;
+
+    // Outlines are drawn shape by shape
+    if (where->lineWidth > 0.0 &&
+        where->lineColor.alpha * where->visibility > 0.0)
+        return false;
+
+    GraphicPath::path_elements &elements = path.elements;
+    uint count = elements.size();
+    if (count < 3 || elements[0].kind != GraphicPath::MOVE_TO)
+        return false;
+    coord z = elements[0].position.z;
+    for (uint i = 1; i < count; i++)
+        if (elements[i].kind != GraphicPath::LINE_TO ||
+            elements[i].position.z != z)
+            return false;
+    if (elements[count-1].position == elements[0].position)
+        count--;
+    if (count < 3)
+        return false;
+
+    // Compute the bounds of the shape where it is drawn
+    Vector3 offset = where->offset;
+    z += offset.z;
+    Box box;
+    for (uint i = 0; i < count; i++)
+        box |= Point(elements[i].position.x + offset.x,
+                     elements[i].position.y + offset.y);
+
+    // Start a new batch if the shape can't be drawn with the pending ones
+    if (layout && (layout != where || depth != z ||
+                   boxes.size() >= MAX_SHAPES))
+        Flush();
+    for (uint b = 0; layout && b < boxes.size(); b++)
+    {
+        Box &o = boxes[b];
+        if (box.lower.x < o.upper.x && o.lower.x < box.upper.x &&
+            box.lower.y < o.upper.y && o.lower.y < box.upper.y)
+            Flush();
+    }
+    layout = where;
+    depth = z;
+    boxes.push_back(box);
+
+    // Add the polygon as a fan of triangles, like GL_POLYGON draws it
+    VertexData first(elements[0].position + offset,
+                     elements[0].position / path.bounds, 0);
+    for (uint i = 2; i < count; i++)
+    {
+        Point3 p1 = elements[i-1].position;
+        Point3 p2 = elements[i].position;
+        vertices.push_back(first);
+        vertices.push_back(VertexData(p1 + offset, p1 / path.bounds, i-1));
+        vertices.push_back(VertexData(p2 + offset, p2 / path.bounds, i));
+    }
+    return true;
+}
+
+
+void DrawBatch::Flush()
+// ----------------------------------------------------------------------------
+//   Draw the pending shapes with the state of their layout
+// ----------------------------------------------------------------------------
+//   This sets the same state as GraphicPath::Draw does for each shape. That
+//   advances the polygon offset twice per shape, once for the fill and once
+//   for the outline, even when there is no outline.
+{
+    if (!layout)
+        return;
+
+    Layout *where = layout;
+    uint shapes = boxes.size();
+    layout = NULL;
+    boxes.clear();
+
+    GLAllStateKeeper save;
+    if (GL.LightsMask() || where->programId)
+        GL.Sync(STATE_lights);
+    GL.LoadMatrix();
+    Shape::setTexture(where);
+    if (Shape::setFillColor(where))
+    {
+        uint stride = sizeof(VertexData);
+        GL.StreamArrays(vertices.size(), &vertices[0].vertex.x, stride,
+                        &vertices[0].normal.x, stride,
+                        &vertices[0].texture.x, 3, stride,
+                        GL.ActiveTextureUnits());
+        GL.DrawArrays(GL_TRIANGLES, 0, vertices.size());
+        GL.StreamDone();
+        merged += shapes - 1;
+    }
+
+    // The pending shapes don't overlap and share the first polygon offset,
+    // but the shapes after them must get the same offset as when unbatched.
+    // setFillColor advanced it once, skip the other 2 * shapes - 1 steps.
+    for (uint s = 1; s < 2 * shapes; s++)
+        where->PolygonOffset(false);
+    GL.ClientActiveTexture(GL_TEXTURE0);
+    vertices.clear();
+}
+
+TAO_END
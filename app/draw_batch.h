@@ -0,0 +1,88 @@
+#ifndef DRAW_BATCH_H
+#define DRAW_BATCH_H
+// *****************************************************************************
+// draw_batch.h                                                    Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Batching of consecutive shapes drawn with the same layout state, so
+//     that they are sent to OpenGL with a single draw call.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "tao.h"
+#include "coords.h"
+#include "path3d.h"
+#include <vector>
+
+TAO_BEGIN
+
+struct Layout;
+
+
+struct DrawBatch
+// ----------------------------------------------------------------------------
+//   Merge the fills of consecutive sibling shapes into a single draw call
+// ----------------------------------------------------------------------------
+//   Drawings of a layout that are not separated by an attribute are drawn
+//   with the same color, texture, shader, blending and transform. Layouts
+//   give their shapes to the batch, which accepts flat polygons without
+//   outline or extrusion, and draws them as triangles when something else
+//   must be drawn. In a single draw call, a shape would be hidden by an
+//   earlier one it overlaps, since they would have the same polygon offset,
+//   so a shape that overlaps one in the batch starts a new batch.
+{
+    enum { MAX_SHAPES = 256 };  // Bound the cost of overlap tests
+
+    DrawBatch();
+
+    void        Enable(bool enable)     { enabled = enable; }
+    bool        Enabled()               { return enabled; }
+
+    bool        Add(Layout *where, GraphicPath &path);
+    void        Flush();
+
+public:
+    ulong       merged;         // Draw calls saved by batching
+
+private:
+    typedef GraphicPath::VertexData     VertexData;
+    typedef GraphicPath::Vertices       Vertices;
+
+    bool        enabled;
+    Layout *    layout;         // Layout the pending shapes belong to
+    coord       depth;          // Z coordinate of the pending shapes
+    Vertices    vertices;       // Triangles of the pending shapes
+    std::vector<Box> boxes;     // Bounds of the pending shapes
+};
+
+TAO_END
+
+#endif // DRAW_BATCH_H
@@ -38,6 +38,7 @@
 // *****************************************************************************
 
 #include "drawing.h"
+#include "drawing_arena.h"
 #include "shapes3d.h"
 #include "layout.h"
 #include "widget.h"
@@ -75,6 +76,24 @@ Drawing::~Drawing()
 }
 
 
+void *Drawing::operator new(size_t size)
+// ----------------------------------------------------------------------------
+//   Allocate drawings in the arena of the layout being evaluated
+// ----------------------------------------------------------------------------
+{
+    return DrawingArena::Allocate(Layout::CurrentArena(), size);
+}
+
+
+void Drawing::operator delete(void *ptr)
+// ----------------------------------------------------------------------------
+//   Release the memory of a drawing to its arena
+// ----------------------------------------------------------------------------
+{
+    DrawingArena::Release(ptr);
+}
+
+
 void Drawing::Draw(Layout *)
 // ----------------------------------------------------------------------------
 //   Draw a shape for rendering purpose
@@ -82,6 +101,15 @@ void Drawing::Draw(Layout *)
 {}
 
 
+bool Drawing::Batch(Layout *, DrawBatch &)
+// ----------------------------------------------------------------------------
+//   Return true if the shape was added to the batch instead of being drawn
+// ----------------------------------------------------------------------------
+{
+    return false;
+}
+
+
 void Drawing::DrawSelection(Layout *layout)
 // ----------------------------------------------------------------------------
 //   Draw the marker indicating that a shape is selected
@@ -50,6 +50,7 @@ TAO_BEGIN
 struct TextureState;
 struct Layout;
 struct PageLayout;
+struct DrawBatch;
 
 
 struct Drawing
@@ -60,6 +61,7 @@ struct Drawing
 //   Bounds() returns the untransformed bounding box for the shape
 //   Space() returns the untransformed space desired around object
 //   For instance, for text, Space() considers font line height, not Bounds()
+//   Batch() draws the shape with its siblings if possible, see DrawBatch
 {
     typedef std::vector<Drawing *>      Drawings;
 
@@ -68,6 +70,7 @@ struct Drawing
     virtual             ~Drawing();
 
     virtual void        Draw(Layout *);
+    virtual bool        Batch(Layout *, DrawBatch &);
     virtual void        DrawSelection(Layout *);
     virtual void        Evaluate(Layout *);
     virtual void        Identify(Layout *);
@@ -82,6 +85,10 @@ struct Drawing
     virtual bool        IsAttribute();
     virtual bool        IsRTL() { return false; }
 
+    // Drawings are allocated in the arena of the current layout
+    static void *       operator new(size_t size);
+    static void         operator delete(void *ptr);
+
     static uint count;
 };
 
@@ -0,0 +1,167 @@
+// *****************************************************************************
+// drawing_arena.cpp                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Bump allocation of the drawings created while evaluating a layout,
+//     released in one step when the layout is cleared.
+//
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "drawing_arena.h"
+#include <cstdlib>
+#include <new>
+
+TAO_BEGIN
+
+ulong DrawingArena::allocations = 0;
+ulong DrawingArena::bytes       = 0;
+ulong DrawingArena::reserved    = 0;
+
+
+DrawingArena::~DrawingArena()
+// ----------------------------------------------------------------------------
+//   Free empty chunks, leave the others to the drawings still using them
+// ----------------------------------------------------------------------------
+{
+    for (Chunks::iterator c = chunks.begin(); c != chunks.end(); c++)
+    {
+        Chunk *chunk = *c;
+        if (chunk->live)
+            chunk->arena = NULL;
+        else
+            FreeChunk(chunk);
+    }
+}
+
+
+void *DrawingArena::Allocate(DrawingArena *arena, size_t size)
+// ----------------------------------------------------------------------------
+//   Allocate an object from the arena, or on its own if there is no arena
+// ----------------------------------------------------------------------------
+//   Each object is preceded by a pointer to its chunk, padded for alignment
+{
+    size_t header = Align(sizeof(Chunk *));
+    size = Align(size) + header;
+    allocations++;
+    bytes += size;
+
+    Chunk *chunk = NULL;
+    char *ptr = NULL;
+    if (arena && size <= LARGE)
+    {
+        chunk = arena->current;
+        if (!chunk || chunk->used + size > chunk->size)
+            chunk = arena->Next();
+    }
+    else
+    {
+        chunk = NewChunk(NULL, size);
+    }
+
+    ptr = (char *) chunk + Align(sizeof(Chunk)) + chunk->used;
+    chunk->used += size;
+    chunk->live++;
+    *(Chunk **) ptr = chunk;
+    return ptr + header;
+}
+
+
+void DrawingArena::Release(void *ptr)
+// ----------------------------------------------------------------------------
+//   Release an object, rewinding or freeing its chunk if it was the last
+// ----------------------------------------------------------------------------
+{
+    if (!ptr)
+        return;
+
+    char *base = (char *) ptr - Align(sizeof(Chunk *));
+    Chunk *chunk = *(Chunk **) base;
+    if (--chunk->live)
+        return;
+
+    DrawingArena *arena = chunk->arena;
+    if (!arena)
+        FreeChunk(chunk);
+    else if (chunk == arena->current)
+        chunk->used = 0;
+}
+
+
+DrawingArena::Chunk *DrawingArena::Next()
+// ----------------------------------------------------------------------------
+//   Switch to an empty chunk, reusing one of ours if possible
+// ----------------------------------------------------------------------------
+{
+    for (Chunks::iterator c = chunks.begin(); c != chunks.end(); c++)
+    {
+        Chunk *chunk = *c;
+        if (!chunk->live)
+        {
+            chunk->used = 0;
+            current = chunk;
+            return chunk;
+        }
+    }
+
+    current = NewChunk(this, CHUNK_SIZE - Align(sizeof(Chunk)));
+    chunks.push_back(current);
+    return current;
+}
+
+
+DrawingArena::Chunk *DrawingArena::NewChunk(DrawingArena *arena, size_t size)
+// ----------------------------------------------------------------------------
+//   Allocate a chunk with the given capacity
+// ----------------------------------------------------------------------------
+{
+    size_t total = Align(sizeof(Chunk)) + size;
+    Chunk *chunk = (Chunk *) malloc(total);
+    if (!chunk)
+        throw std::bad_alloc();
+    chunk->arena = arena;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->live = 0;
+    reserved += total;
+    return chunk;
+}
+
+
+void DrawingArena::FreeChunk(Chunk *chunk)
+// ----------------------------------------------------------------------------
+//   Return a chunk to the system
+// ----------------------------------------------------------------------------
+{
+    reserved -= Align(sizeof(Chunk)) + chunk->size;
+    free(chunk);
+}
+
+TAO_END
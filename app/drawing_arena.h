@@ -0,0 +1,103 @@
+#ifndef DRAWING_ARENA_H
+#define DRAWING_ARENA_H
+// *****************************************************************************
+// drawing_arena.h                                                 Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Bump allocation of the drawings created while evaluating a layout,
+//     released in one step when the layout is cleared.
+//
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "tao.h"
+#include <vector>
+#include <cstddef>
+
+TAO_BEGIN
+
+struct DrawingArena
+// ----------------------------------------------------------------------------
+//   Memory for the drawings created while a layout is the current layout
+// ----------------------------------------------------------------------------
+//   Drawings are allocated by bumping a pointer in the current chunk of
+//   the arena. They are normally all deleted by Layout::Clear, at which
+//   point the chunk is rewound, and the same memory serves the next
+//   evaluation of the layout without going through malloc. Drawings may
+//   however be moved to other layouts (e.g. when paginating text) or
+//   outlive their layout, so each chunk counts the objects still using
+//   it, and a chunk no longer owned by an arena is freed once empty.
+{
+    DrawingArena(): chunks(), current(NULL) {}
+    DrawingArena(const DrawingArena &): chunks(), current(NULL) {}
+    ~DrawingArena();
+    DrawingArena &      operator=(const DrawingArena &) { return *this; }
+
+    static void *       Allocate(DrawingArena *arena, size_t size);
+    static void         Release(void *ptr);
+    static void         ResetCounters()  { allocations = bytes = 0; }
+
+public:
+    // Allocations since last reset, and memory held by all chunks
+    static ulong        allocations;
+    static ulong        bytes;
+    static ulong        reserved;
+
+private:
+    struct Chunk
+    {
+        DrawingArena *  arena;          // Owner, NULL for single objects
+        size_t          size;           // Bytes available after header
+        size_t          used;           // Bytes allocated
+        uint            live;           // Objects not released yet
+    };
+    typedef std::vector<Chunk *>        Chunks;
+
+    enum
+    {
+        ALIGN           = 16,
+        CHUNK_SIZE      = 16 * 1024,
+        LARGE           = CHUNK_SIZE / 4
+    };
+
+    Chunk *             Next();
+    static Chunk *      NewChunk(DrawingArena *arena, size_t size);
+    static void         FreeChunk(Chunk *chunk);
+    static size_t       Align(size_t s) { return (s + ALIGN-1) & ~(ALIGN-1); }
+
+private:
+    Chunks              chunks;
+    Chunk *             current;
+};
+
+TAO_END
+
+#endif // DRAWING_ARENA_H
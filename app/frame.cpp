@@ -230,6 +230,10 @@ void FrameInfo::begin(bool clearContents)
     // Clear the render FBO
     checkGLContext();
 
+    // Binding a framebuffer is not recorded in display lists
+    if (Widget *widget = Widget::TaoExists())
+        widget->viewReplay().ViewDependent();
+
     GL.Sync(STATE_textures);
     GL.Invalidate(STATE_viewport);
     int ok = renderFBO->bind();
@@ -239,6 +243,10 @@ void FrameInfo::begin(bool clearContents)
     GL.SetCached_bufferMode(GL_COLOR_ATTACHMENT0);
     GL.Disable(GL_STENCIL_TEST);
 
+    // The scissor box of the window does not apply here (nor to blits)
+    GL.Disable(GL_SCISSOR_TEST);
+    GL.Sync(STATE_glflag_GL_SCISSOR_TEST);
+
     if (clearContents)
         clear();
     else if (renderFBO != textureFBO)
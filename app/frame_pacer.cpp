@@ -0,0 +1,216 @@
+// *****************************************************************************
+// frame_pacer.cpp                                                 Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Pacing of frames on the display refresh: predicts when the frame
+//     being built will be shown, and when to start building a frame so
+//     that it is ready in time for a given refresh.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "frame_pacer.h"
+#include <cmath>
+
+TAO_BEGIN
+
+// Margin kept between the end of a frame and the refresh that displays it
+static const double SAFETY_MARGIN = 0.002;
+
+
+FramePacer::FramePacer()
+// ----------------------------------------------------------------------------
+//   Start with the default refresh rate and no known phase
+// ----------------------------------------------------------------------------
+    : enabled(false), building(false),
+      interval(1.0 / DEFAULT_RATE), vsync(0),
+      buildTime(0.25 / DEFAULT_RATE), buildStart(0),
+      target(0), lastTarget(0), lastPresented(0),
+      missed(0)
+{}
+
+
+void FramePacer::Enable(bool enable)
+// ----------------------------------------------------------------------------
+//   Turn pacing on or off (it only makes sense when vsync is on)
+// ----------------------------------------------------------------------------
+{
+    if (enable == enabled)
+        return;
+    enabled = enable;
+    building = false;
+    vsync = 0;
+    lastTarget = 0;
+    lastPresented = 0;
+}
+
+
+void FramePacer::SetRefreshRate(double hz)
+// ----------------------------------------------------------------------------
+//   Set the nominal refresh rate of the display, refined by measurements
+// ----------------------------------------------------------------------------
+{
+    if (hz >= 1)
+        interval = 1.0 / hz;
+}
+
+
+double FramePacer::VSyncAfter(double t)
+// ----------------------------------------------------------------------------
+//   Return the first display refresh at or after time t
+// ----------------------------------------------------------------------------
+{
+    if (vsync == 0)
+        return t;
+    double n = ceil((t - vsync) / interval - 0.01);
+    return vsync + n * interval;
+}
+
+
+double FramePacer::DisplayTime(double now)
+// ----------------------------------------------------------------------------
+//   Return the time at which the frame being built will be displayed
+// ----------------------------------------------------------------------------
+//   The prediction is kept while the frame is being built, so that all
+//   evaluations within a frame see the same time. It never goes back, and
+//   two frames never target the same refresh.
+{
+    if (!enabled)
+        return now;
+    if (building && now <= target)
+        return target;
+
+    double t = VSyncAfter(now + buildTime);
+    if (lastTarget > 0 && t < lastTarget + interval / 2)
+        t = VSyncAfter(lastTarget + interval / 2);
+    building = true;
+    buildStart = now;
+    target = t;
+    return t;
+}
+
+
+double FramePacer::FrameStart(double when, double now)
+// ----------------------------------------------------------------------------
+//   Return when to start a frame so that it shows time 'when' on time
+// ----------------------------------------------------------------------------
+{
+    if (!enabled)
+        return when;
+    double slot = VSyncAfter(when);
+    if (lastTarget > 0 && slot < lastTarget + interval / 2)
+        slot = VSyncAfter(lastTarget + interval / 2);
+    double start = slot - buildTime - SAFETY_MARGIN;
+    return start > now ? start : now;
+}
+
+
+bool FramePacer::DrawLater(double now)
+// ----------------------------------------------------------------------------
+//   Check if drawing now would show the current frame before its target
+// ----------------------------------------------------------------------------
+//   This happens when another request comes in the same refresh interval
+//   as the last frame. Drawing is then deferred, so that all the requests
+//   in that interval result in a single frame.
+{
+    if (!enabled || !building || vsync == 0)
+        return false;
+    return DrawStart(now) > now;
+}
+
+
+double FramePacer::DrawStart(double now)
+// ----------------------------------------------------------------------------
+//   Return when to draw the current frame so that it is ready on time
+// ----------------------------------------------------------------------------
+{
+    double start = target - buildTime - SAFETY_MARGIN;
+    double after = target - interval + SAFETY_MARGIN; // Previous refresh
+    if (start < after)
+        start = after;
+    return start > now ? start : now;
+}
+
+
+void FramePacer::FramePresented(double now)
+// ----------------------------------------------------------------------------
+//   Record that a buffer swap returned, i.e. a frame was queued for display
+// ----------------------------------------------------------------------------
+//   With vsync on, the swap returns shortly after the refresh that shows
+//   the frame, which gives the phase of the refresh. Successive swaps that
+//   are a whole number of periods apart refine the period.
+{
+    if (!enabled)
+        return;
+
+    if (lastPresented > 0)
+    {
+        double delta = now - lastPresented;
+        double frames = floor(delta / interval + 0.5);
+        if (frames >= 1 && frames <= 4)
+        {
+            double measured = delta / frames;
+            if (fabs(measured - interval) < 0.1 * interval)
+                interval = 0.95 * interval + 0.05 * measured;
+        }
+    }
+    lastPresented = now;
+
+    // Smooth the phase so that swap jitter does not move the refresh grid
+    double shown = now;
+    if (vsync > 0)
+    {
+        double predicted = VSyncAfter(now - interval / 2);
+        vsync = predicted + 0.1 * (now - predicted);
+        shown = VSyncAfter(now - interval / 2);
+    }
+    else
+    {
+        vsync = now;
+    }
+
+    if (building)
+    {
+        double took = now - buildStart;
+        if (took > 0 && took < 4 * interval)
+            buildTime = 0.9 * buildTime + 0.1 * took;
+        if (shown > target + interval / 2)
+            missed++;
+        lastTarget = shown > target ? shown : target;
+        building = false;
+    }
+    else if (shown > lastTarget)
+    {
+        // Frame drawn without evaluation, e.g. on expose
+        lastTarget = shown;
+    }
+}
+
+TAO_END
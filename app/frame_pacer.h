@@ -0,0 +1,95 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+// *****************************************************************************
+// frame_pacer.h                                                   Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Pacing of frames on the display refresh: predicts when the frame
+//     being built will be shown, and when to start building a frame so
+//     that it is ready in time for a given refresh.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "tao.h"
+
+TAO_BEGIN
+
+struct FramePacer
+// ----------------------------------------------------------------------------
+//   Schedule frames on the display refresh when vertical sync is on
+// ----------------------------------------------------------------------------
+//   The period and phase of the display refresh are estimated from the
+//   times at which buffer swaps return, and the time it takes to build a
+//   frame is averaged over recent frames. From this, the pacer predicts
+//   the refresh at which the frame being built will be displayed, so that
+//   animations are evaluated for that time rather than for the time the
+//   evaluation started. It also tells when to start building a frame so
+//   that it is ready just before the refresh showing a given time, and
+//   whether drawing should wait, so that several requests received during
+//   the same refresh interval result in a single frame.
+//   All times are in seconds.
+{
+    enum { DEFAULT_RATE = 60 };
+
+    FramePacer();
+
+    void        Enable(bool enable);
+    bool        Enabled()               { return enabled; }
+    void        SetRefreshRate(double hz);
+    double      Interval()              { return interval; }
+
+    double      DisplayTime(double now);
+    double      FrameStart(double when, double now);
+    bool        DrawLater(double now);
+    double      DrawStart(double now);
+    void        FramePresented(double now);
+    uint        MissedDeadlines()       { return missed; }
+    void        ResetMissedDeadlines()  { missed = 0; }
+
+private:
+    double      VSyncAfter(double t);
+
+private:
+    bool        enabled;
+    bool        building;       // A frame is being built for 'target'
+    double      interval;       // Estimated display refresh period
+    double      vsync;          // Estimated time of a recent refresh, or 0
+    double      buildTime;      // Average time to build and swap a frame
+    double      buildStart;     // When the current frame was started
+    double      target;         // Predicted display time of current frame
+    double      lastTarget;     // Refresh that shows the last frame
+    double      lastPresented;  // When the last buffer swap returned
+    uint        missed;         // Frames displayed after their target
+};
+
+TAO_END
+
+#endif // FRAME_PACER_H
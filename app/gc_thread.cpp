@@ -42,6 +42,7 @@
 #include "gc.h"
 #include "widget.h"
 #include <QEvent>
+#include <QMutexLocker>
 #include <QTime>
 #include <iostream>
 
@@ -60,16 +61,77 @@ void GCThread::collect()
     t.start();
     w->stats.begin(Statistics::GC);
     XL::GarbageCollector::Collect();
+    uint tot = 0, alloc = 0, freed = 0;
+    XL::GarbageCollector::Singleton()->Statistics(tot, alloc, freed);
     w->stats.end(Statistics::GC);
+    int elapsed = t.elapsed();
     IFTRACE(memory)
-        debug() << "Collect time " << t.elapsed() << " ms\n";
+        debug() << "Collect time " << elapsed << " ms, "
+                << (alloc >> 10) << "K still allocated\n";
     mutex.lock();
+    liveBytes = alloc;
+    duration = duration > 0.0 ? 0.75 * duration + 0.25e-3 * elapsed
+                              : 1e-3 * elapsed;
     collectDone = true;
     cond.wakeOne();
     mutex.unlock();
 }
 
 
+bool GCThread::startCollect(double budget, bool animating, bool paced)
+// ----------------------------------------------------------------------------
+//   Check if a collection should run now, and if so mark it as started
+// ----------------------------------------------------------------------------
+//   The budget is the time until the next frame is evaluated, in seconds.
+//   Returns false if a collection is still running from a previous frame.
+{
+    QMutexLocker locker(&mutex);
+    if (!collectDone)
+        return false;
+
+    bool run = true;
+    uint growth = 0;
+    if (paced)
+    {
+        uint tot = 0, alloc = 0, freed = 0;
+        XL::GarbageCollector::Singleton()->Statistics(tot, alloc, freed);
+        growth = alloc > liveBytes ? alloc - liveBytes : 0;
+        run = growth >= MAX_GROWTH || deferred >= MAX_DEFERRED;
+        if (!run && growth >= MIN_GROWTH)
+            run = !animating || duration < budget;
+    }
+
+    if (!run)
+    {
+        if (growth >= MIN_GROWTH)
+            deferred++;
+        skipped++;
+        saved += duration;
+        IFTRACE(memory)
+            debug() << "Collect skipped, " << (growth >> 10)
+                    << "K allocated, " << deferred << " deferred\n";
+        return false;
+    }
+
+    deferred = 0;
+    collections++;
+    collectDone = false;
+    return true;
+}
+
+
+void GCThread::statistics(ulong &run, ulong &skip, double &savedTime)
+// ----------------------------------------------------------------------------
+//   Return the number of collections run and skipped, and the time saved
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    run = collections;
+    skip = skipped;
+    savedTime = saved;
+}
+
+
 void GCThread::clearCollectDone()
 // ----------------------------------------------------------------------------
 //   Mark that collect cycle has not started
@@ -93,6 +155,16 @@ void GCThread::waitCollectDone()
 }
 
 
+bool GCThread::collecting()
+// ----------------------------------------------------------------------------
+//   Return true while a collection is running
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    return !collectDone;
+}
+
+
 std::ostream & GCThread::debug()
 // ----------------------------------------------------------------------------
 //   Convenience method to log with a common prefix
@@ -48,16 +48,29 @@ struct GCThread : public QThread
 // ----------------------------------------------------------------------------
 //   Run XL garbage collection in a dedicated thread
 // ----------------------------------------------------------------------------
+//   Collections are paced by the volume allocated since the last one,
+//   rather than run for every frame. While animating, a collection that
+//   would not complete before the next frame is evaluated is deferred,
+//   unless too much was allocated or it was deferred for too long.
 {
     Q_OBJECT
 
 public:
-    GCThread() : QThread(NULL), collectDone(false) {}
+    GCThread() : QThread(NULL), collectDone(true), liveBytes(0),
+                 deferred(0), duration(0.0),
+                 collections(0), skipped(0), saved(0.0) {}
     ~GCThread() {}
 
+    // Pacing of collections
+    bool                     startCollect(double budget, bool animating,
+                                          bool paced = true);
+    void                     statistics(ulong &run, ulong &skip,
+                                        double &savedTime);
+
     // Synchronisation with another thread
     void                     clearCollectDone();
     void                     waitCollectDone();
+    bool                     collecting();
 
 public slots:
     void                     collect();
@@ -66,9 +79,23 @@ protected:
     static std::ostream &    debug();
 
 protected:
+    enum
+    {
+        MIN_GROWTH = 1 << 20,           // Not worth collecting below
+        MAX_GROWTH = 16 << 20,          // Collect even while animating
+        MAX_DEFERRED = 120              // Frames a collection can wait
+    };
+
     bool                     collectDone;
     QWaitCondition           cond;
     QMutex                   mutex;
+
+    // Pacing state, protected by mutex
+    uint                     liveBytes;         // Allocated after last GC
+    uint                     deferred;          // Collections deferred
+    double                   duration;          // Average collect time (s)
+    ulong                    collections, skipped;
+    double                   saved;             // Estimated time saved (s)
 };
 
 }
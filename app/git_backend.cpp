@@ -670,6 +670,9 @@ bool GitRepository::commit(text message, bool all)
     if(noLocal)
         return false;
 
+    // Files saved in the background must be on disk and added first
+    flushWrites();
+
     clearCachedDocVersion();
     waitForAsyncProcessCompletion();
     if (message == "")
@@ -44,7 +44,11 @@
 #include "tao_utf8.h"
 #include "path3d.h"
 #include "save.h"
+#include "application.h"
+#include "main.h"
 #include <QFontMetricsF>
+#include <QElapsedTimer>
+#include <vector>
 
 TAO_BEGIN
 
@@ -66,42 +70,21 @@ TAO_BEGIN
 //   The entries we return from Find, on the other hand, are OpenGL texture
 //   coordinates, i.e. we normalize them in the 0..1 range.
 
-PerFontGlyphCache::PerFontGlyphCache(const QFont &font)
+PerFontGlyphCache::PerFontGlyphCache(const QFont &font, qreal baseSize)
 // ----------------------------------------------------------------------------
 //   Construct an empty per-font glyph cache
 // ----------------------------------------------------------------------------
-    : font(font), ascent(0), descent(0), leading(0)
+//   Metrics and glyphs are recorded for baseSize, which defaults to the size
+//   of the font, and scaled to the size of the font being drawn
+    : font(font), ascent(0), descent(0), leading(0),
+      baseSize(baseSize > 0 ? baseSize : font.pointSizeF())
 {
-    QFontMetricsF fm(font);
+    QFont base(font);
+    base.setPointSizeF(this->baseSize);
+    QFontMetricsF fm(base);
     ascent = fm.ascent();
     descent = fm.descent();
     leading = fm.leading();
-    baseSize = font.pointSizeF();
-}
-
-
-PerFontGlyphCache::~PerFontGlyphCache()
-// ----------------------------------------------------------------------------
-//   Clear the per-font glyph cache
-// ----------------------------------------------------------------------------
-{
-    for (CodeMap::iterator ci = codes.begin(); ci != codes.end(); ci++)
-    {
-        GlyphEntry &e = (*ci).second;
-        if (e.interior)
-            GL.DeleteLists(e.interior, 1);
-        if (e.outline)
-            GL.DeleteLists(e.outline, 1);
-
-    }
-    for (TextMap::iterator ti = texts.begin(); ti != texts.end(); ti++)
-    {
-        GlyphEntry &e = (*ti).second;
-        if (e.interior)
-            GL.DeleteLists(e.interior, 1);
-        if (e.outline)
-            GL.DeleteLists(e.outline, 1);
-    }
 }
 
 
@@ -153,6 +136,30 @@ void PerFontGlyphCache::Insert(text word, const GlyphEntry &entry)
 }
 
 
+bool PerFontGlyphCache::CompactMesh()
+// ----------------------------------------------------------------------------
+//   Reclaim the triangles of outlines replaced e.g. for a new line width
+// ----------------------------------------------------------------------------
+{
+    if (!mesh.Garbage() || mesh.Garbage() < mesh.Triangles() / 2)
+        return false;
+
+    TriangleMesh::Ranges live;
+    for (CodeMap::iterator ci = codes.begin(); ci != codes.end(); ci++)
+    {
+        live.push_back(&(*ci).second.interior);
+        live.push_back(&(*ci).second.outline);
+    }
+    for (TextMap::iterator ti = texts.begin(); ti != texts.end(); ti++)
+    {
+        live.push_back(&(*ti).second.interior);
+        live.push_back(&(*ti).second.outline);
+    }
+    mesh.Compact(live);
+    return true;
+}
+
+
 
 // ============================================================================
 //
@@ -161,6 +168,8 @@ void PerFontGlyphCache::Insert(text word, const GlyphEntry &entry)
 // ============================================================================
 
 uint GlyphCache::defaultSize = 128;
+QGLShaderProgram *GlyphCache::sdfProgram = NULL;
+bool              GlyphCache::sdfFailed = false;
 
 GlyphCache::GlyphCache()
 // ----------------------------------------------------------------------------
@@ -171,11 +180,16 @@ GlyphCache::GlyphCache()
       texture(0),
       image(defaultSize, defaultSize, QImage::Format_ARGB32),
       dirty(false),
+      sdf(XL::MAIN->options.sdf_glyphs),
       minFontSize(30),
       maxFontSize(120),
       minFontSizeForAntialiasing(9),
       fontScaling(2.0),
       antiAliasMargin(3),
+      sdfFontSize(32),
+      sdfSpread(8),
+      rasterized(0),
+      rasterTime(0),
       texUnits(1),              // Default is texture unit 0 only
       lastFont(NULL),
       GLcontext(QGLContext::currentContext()),
@@ -224,6 +238,10 @@ void GlyphCache::CheckActiveLayout(Layout *where)
         Clear();
         this->texUnits |= GL.ActiveTextureUnits();
     }
+
+    // Fall back to bitmaps if we can't draw distance fields
+    if (sdf && !DistanceFieldProgram())
+        DistanceField(false);
     layout = where;
 }
 
@@ -236,14 +254,14 @@ GlyphCache::PerFont *GlyphCache::FindFont(const QFont &font, bool create)
     PerFontGlyphCache *perFont = lastFont;
     if (!perFont || perFont->font != font)
     {
-        Key key(font);
+        Key key(font, !sdf);
         FontMap::iterator cacheEntry = cache.find(key);
         if (cacheEntry == cache.end())
         {
             // Create font cache entry if necessary
             if (!create)
                 return NULL;
-            perFont = new PerFontGlyphCache(font);
+            perFont = new PerFontGlyphCache(font, sdf ? sdfFontSize : 0);
             cache[key] = perFont;
         }
         else
@@ -273,16 +291,26 @@ bool GlyphCache::Find(const QFont &font,
 
     if (!found)
     {
+        QElapsedTimer timer;
+        timer.start();
+
         // Apply a font with scaling
+        scale size = font.pointSizeF();
         scale fs = fontScaling;
         uint aam = antiAliasMargin;
-        if (font.pointSizeF() < minFontSizeForAntialiasing)
+        if (sdf)
+        {
+            // Distance fields are rendered once at the base size
+            size = perFont->baseSize;
+            aam = sdfSpread;
+        }
+        else if (size < minFontSizeForAntialiasing)
         {
             fs = 1;
             aam = 0;
         }
         QFont scaled(font);
-        scaled.setPointSizeF(font.pointSizeF() * fs);
+        scaled.setPointSizeF(size * fs);
         if (!aam)
         {
             scaled.setStyleStrategy(QFont::NoAntialias);
@@ -354,8 +382,9 @@ bool GlyphCache::Find(const QFont &font,
         entry.texture = Box(rect.x1+aam, rect.y1+aam, width, height);
         entry.advance = fm.width(qc) / fs;
         entry.scalingFactor = fs;
-        entry.interior = 0;
-        entry.outline = 0;
+        entry.mesh = &perFont->mesh;
+        entry.interior = TriangleMesh::Range();
+        entry.outline = TriangleMesh::Range();
         entry.outlineWidth = 1.0;
         entry.outlineDepth = 0.0;
         entry.outlineRadius = 0.0;
@@ -389,15 +418,19 @@ bool GlyphCache::Find(const QFont &font,
 #endif
 
         painter.end();
+        if (sdf)
+            ComputeDistanceField(rect, aam);
 
         // We will need to update the texture
         dirty = true;
+        rasterized++;
+        rasterTime += timer.nsecsElapsed() / 1000;
     }
 
     // Line width should remain identical even if we scale the font
     lineWidth /= font.pointSizeF() / perFont->baseSize;
 
-    // Check if we want OpenGL display lists:
+    // Check if we need to record the glyph triangles:
     // - If the line width is unknown yet
     // - If there is depth and anything impacting it changed
     scale extra = 0;
@@ -414,7 +447,8 @@ bool GlyphCache::Find(const QFont &font,
                                radiusChange || countChange);
         if (depth > 0)
             extra = radius;
-        if ((!entry.interior && interior) || !entry.outline || outlineChange)
+        if ((!entry.interior.Recorded() && interior) ||
+            !entry.outline.Recorded() || outlineChange)
         {
             // Reset font to original size
             QFont scaled(font);
@@ -427,38 +461,37 @@ bool GlyphCache::Find(const QFont &font,
             qtPath.addText(0, 0, scaled, QString(QChar(code)));
             path.addQtPath(qtPath, -1);
 
+            TriangleMesh &mesh = perFont->mesh;
             if (interior)
             {
-                // Create an OpenGL display list for the glyph
-                if (!entry.interior)
-                    entry.interior = GL.GenLists(1);
-                entry.polycount = GL.polycount;
+                // Record the triangles of the glyph in the font mesh
+                mesh.Free(entry.interior);
                 if (layout->extrudeDepth > 0.0)
                 {
                     XL::Save<scale> saveDepth (layout->extrudeDepth, -1.0);
-                    GL.NewList(entry.interior, GL_COMPILE);
+                    mesh.Begin();
                     path.Draw(layout, Vector3(0,0,0),
                               GL_POLYGON, GLU_TESS_WINDING_POSITIVE);
-                    GL.EndList();
+                    entry.interior = mesh.End();
                 }
                 else
                 {
-                    GL.NewList(entry.interior, GL_COMPILE);
+                    mesh.Begin();
                     path.Draw(layout, Vector3(0,0,0),
                               GL_POLYGON, GLU_TESS_WINDING_POSITIVE);
-                    GL.EndList();
+                    entry.interior = mesh.End();
                 }
-                entry.polycount = GL.polycount - entry.polycount;
+                entry.polycount = entry.interior.count / 3;
             }
 
-            if (!entry.outline || outlineChange)
+            if (!entry.outline.Recorded() || outlineChange)
             {
-                if (!entry.outline)
-                    entry.outline = GL.GenLists(1);
+                mesh.Free(entry.outline);
+                mesh.Begin();
 
                 if (lineWidth > 0)
                 {
-                    // Render outline in a GL list
+                    // Record outline as a stroke of the glyph path
                     QPainterPathStroker stroker;
                     stroker.setWidth(lineWidth);
                     stroker.setCapStyle(Qt::FlatCap);
@@ -467,18 +500,15 @@ bool GlyphCache::Find(const QFont &font,
                     QPainterPath stroke = stroker.createStroke(qtPath);
                     GraphicPath strokePath;
                     strokePath.addQtPath(stroke, -1);
-                    GL.NewList(entry.outline, GL_COMPILE);
                     strokePath.Draw(layout, Vector3(0,0,0),
                                     GL_POLYGON, GLU_TESS_WINDING_POSITIVE);
-                    GL.EndList();
                 }
                 else if (depth > 0.0)
                 {
-                    // Render outline as a depth border
-                    GL.NewList(entry.outline, GL_COMPILE);
+                    // Record outline as a depth border
                     path.Draw(layout, Vector3(0,0,0), GL_POLYGON, GL_DEPTH);
-                    GL.EndList();
                 }
+                entry.outline = mesh.End();
 
                 entry.outlineWidth = lineWidth;
                 entry.outlineDepth = depth;
@@ -488,6 +518,14 @@ bool GlyphCache::Find(const QFont &font,
 
             // Store the new or updated entry
             perFont->Insert(code, entry);
+            if (perFont->CompactMesh())
+                perFont->Find(code, entry);
+
+            IFTRACE(fonts)
+                std::cerr << "Glyph mesh for " << +perFont->font.family()
+                          << " " << perFont->baseSize << ": "
+                          << mesh.Triangles() << " triangles, "
+                          << (mesh.Bytes() >> 10) << "K\n";
         }
     }
 
@@ -513,16 +551,26 @@ bool GlyphCache::Find(const QFont &font,
 
     if (!found)
     {
+        QElapsedTimer timer;
+        timer.start();
+
         // Apply a font with scaling
+        scale size = font.pointSizeF();
         scale fs = fontScaling;
         uint aam = antiAliasMargin;
-        if (font.pointSizeF() < minFontSizeForAntialiasing)
+        if (sdf)
+        {
+            // Distance fields are rendered once at the base size
+            size = perFont->baseSize;
+            aam = sdfSpread;
+        }
+        else if (size < minFontSizeForAntialiasing)
         {
             fs = 1;
             aam = 0;
         }
         QFont scaled(font);
-        scaled.setPointSizeF(font.pointSizeF() * fs);
+        scaled.setPointSizeF(size * fs);
         if (!aam)
         {
             scaled.setStyleStrategy(QFont::NoAntialias);
@@ -555,8 +603,9 @@ bool GlyphCache::Find(const QFont &font,
         entry.texture = Box(rect.x1+aam, rect.y1+aam, width, height);
         entry.advance = fm.width(qs) / fs;
         entry.scalingFactor = fs;
-        entry.interior = 0;
-        entry.outline = 0;
+        entry.mesh = &perFont->mesh;
+        entry.interior = TriangleMesh::Range();
+        entry.outline = TriangleMesh::Range();
         entry.outlineWidth = 1.0;
         entry.outlineDepth = 0.0;
         entry.outlineRadius = 0.0;
@@ -574,15 +623,19 @@ bool GlyphCache::Find(const QFont &font,
         painter.setPen(Qt::black);
         painter.drawText(QPointF(x+fs, y+fs), qs);
         painter.end();
+        if (sdf)
+            ComputeDistanceField(rect, aam);
 
         // We will need to update the texture
         dirty = true;
+        rasterized++;
+        rasterTime += timer.nsecsElapsed() / 1000;
     }
 
     // Line width should remain identical even if we scale the font
     lineWidth /= font.pointSizeF() / perFont->baseSize;
 
-    // Check if we want OpenGL display lists:
+    // Check if we need to record the glyph triangles:
     // - If the line width is unknown yet
     // - If there is depth and anything impacting it changed
     scale extra = 0;
@@ -599,7 +652,8 @@ bool GlyphCache::Find(const QFont &font,
                                radiusChange || countChange);
         if (depth > 0)
             extra = radius;
-        if ((!entry.interior && interior) || !entry.outline || outlineChange)
+        if ((!entry.interior.Recorded() && interior) ||
+            !entry.outline.Recorded() || outlineChange)
         {
             // Reset font to original size
             QFont scaled(font);
@@ -612,38 +666,37 @@ bool GlyphCache::Find(const QFont &font,
             qtPath.addText(0, 0, scaled, QString(+code));
             path.addQtPath(qtPath, -1);
 
+            TriangleMesh &mesh = perFont->mesh;
             if (interior)
             {
-                // Create an OpenGL display list for the glyph
-                if (!entry.interior)
-                    entry.interior = GL.GenLists(1);
-                entry.polycount = GL.polycount;
+                // Record the triangles of the glyph in the font mesh
+                mesh.Free(entry.interior);
                 if (layout->extrudeDepth > 0.0)
                 {
                     XL::Save<scale> saveDepth (layout->extrudeDepth, -1.0);
-                    GL.NewList(entry.interior, GL_COMPILE);
+                    mesh.Begin();
                     path.Draw(layout, Vector3(0,0,0),
                               GL_POLYGON, GLU_TESS_WINDING_POSITIVE);
-                    GL.EndList();
+                    entry.interior = mesh.End();
                 }
                 else
                 {
-                    GL.NewList(entry.interior, GL_COMPILE);
+                    mesh.Begin();
                     path.Draw(layout, Vector3(0,0,0),
                               GL_POLYGON, GLU_TESS_WINDING_POSITIVE);
-                    GL.EndList();
+                    entry.interior = mesh.End();
                 }
-                entry.polycount = GL.polycount - entry.polycount;
+                entry.polycount = entry.interior.count / 3;
             }
 
-            if (!entry.outline || outlineChange)
+            if (!entry.outline.Recorded() || outlineChange)
             {
-                if (!entry.outline)
-                    entry.outline = GL.GenLists(1);
+                mesh.Free(entry.outline);
+                mesh.Begin();
 
                 if (lineWidth > 0)
                 {
-                    // Render outline in a GL list
+                    // Record outline as a stroke of the glyph path
                     QPainterPathStroker stroker;
                     stroker.setWidth(lineWidth);
                     stroker.setCapStyle(Qt::FlatCap);
@@ -652,18 +705,15 @@ bool GlyphCache::Find(const QFont &font,
                     QPainterPath stroke = stroker.createStroke(qtPath);
                     GraphicPath strokePath;
                     strokePath.addQtPath(stroke, -1);
-                    GL.NewList(entry.outline, GL_COMPILE);
                     strokePath.Draw(layout, Vector3(0,0,0),
                                     GL_POLYGON, GLU_TESS_WINDING_POSITIVE);
-                    GL.EndList();
                 }
                 else if (depth > 0.0)
                 {
-                    // Render outline as a depth border
-                    GL.NewList(entry.outline, GL_COMPILE);
+                    // Record outline as a depth border
                     path.Draw(layout, Vector3(0,0,0), GL_POLYGON, GL_DEPTH);
-                    GL.EndList();
                 }
+                entry.outline = mesh.End();
 
                 entry.outlineWidth = lineWidth;
                 entry.outlineDepth = depth;
@@ -673,6 +723,14 @@ bool GlyphCache::Find(const QFont &font,
 
             // Store the new or updated entry
             perFont->Insert(code, entry);
+            if (perFont->CompactMesh())
+                perFont->Find(code, entry);
+
+            IFTRACE(fonts)
+                std::cerr << "Glyph mesh for " << +perFont->font.family()
+                          << " " << perFont->baseSize << ": "
+                          << mesh.Triangles() << " triangles, "
+                          << (mesh.Bytes() >> 10) << "K\n";
         }
     }
 
@@ -704,6 +762,172 @@ void GlyphCache::Allocate(uint width, uint height, Rect &rect)
 }
 
 
+bool GlyphCache::DistanceField(bool enable)
+// ----------------------------------------------------------------------------
+//   Select signed distance fields or bitmaps, return previous state
+// ----------------------------------------------------------------------------
+{
+    bool old = sdf;
+    if (sdf != enable)
+    {
+        Clear();
+        sdf = enable;
+    }
+    return old;
+}
+
+
+QGLShaderProgram *GlyphCache::DistanceFieldProgram()
+// ----------------------------------------------------------------------------
+//   Return the shader drawing glyphs from their distance field
+// ----------------------------------------------------------------------------
+{
+    if (!sdfProgram && !sdfFailed)
+    {
+        if (QGLShaderProgram::hasOpenGLShaderPrograms())
+        {
+            sdfProgram = new QGLShaderProgram();
+            QString path = Application::applicationDirPath();
+            QString vs = path + "/distance_field.vs";
+            QString fs = path + "/distance_field.fs";
+
+            bool ok = false;
+            if (sdfProgram->addShaderFromSourceFile(QGLShader::Vertex, vs))
+            {
+                if (sdfProgram->addShaderFromSourceFile(QGLShader::Fragment,
+                                                        fs))
+                    ok = sdfProgram->link();
+                else
+                    std::cerr << "Error loading shader code: " << +fs << "\n";
+            }
+            else
+            {
+                std::cerr << "Error loading shader code: " << +vs << "\n";
+            }
+            if (!ok)
+            {
+                std::cerr << +sdfProgram->log();
+                delete sdfProgram;
+                sdfProgram = NULL;
+                sdfFailed = true;
+            }
+        }
+        else
+        {
+            std::cerr << "Distance field glyphs disabled due to "
+                         "missing shader support\n";
+            sdfFailed = true;
+        }
+    }
+    return sdfProgram;
+}
+
+
+struct DistanceOffset
+// ----------------------------------------------------------------------------
+//   Offset to the nearest pixel on the other side of the glyph outline
+// ----------------------------------------------------------------------------
+{
+    DistanceOffset(int dx = 0, int dy = 0): dx(dx), dy(dy) {}
+    int         squared() const { return dx*dx + dy*dy; }
+    int         dx, dy;
+};
+typedef std::vector<DistanceOffset> DistanceGrid;
+
+
+static inline void CompareOffset(DistanceGrid &grid, int w, int h,
+                                 int x, int y, int ox, int oy,
+                                 DistanceOffset &best)
+// ----------------------------------------------------------------------------
+//   Keep the offset of a neighbour if it leads to a closer pixel
+// ----------------------------------------------------------------------------
+{
+    int nx = x + ox;
+    int ny = y + oy;
+    if (nx < 0 || ny < 0 || nx >= w || ny >= h)
+        return;
+    DistanceOffset o = grid[ny * w + nx];
+    o.dx += ox;
+    o.dy += oy;
+    if (o.squared() < best.squared())
+        best = o;
+}
+
+
+static void PropagateOffsets(DistanceGrid &grid, int w, int h)
+// ----------------------------------------------------------------------------
+//   Two-pass 8-neighbours Euclidean distance transform (8SSEDT)
+// ----------------------------------------------------------------------------
+{
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            DistanceOffset &p = grid[y * w + x];
+            CompareOffset(grid, w, h, x, y, -1,  0, p);
+            CompareOffset(grid, w, h, x, y,  0, -1, p);
+            CompareOffset(grid, w, h, x, y, -1, -1, p);
+            CompareOffset(grid, w, h, x, y,  1, -1, p);
+        }
+        for (int x = w - 1; x >= 0; x--)
+            CompareOffset(grid, w, h, x, y, 1, 0, grid[y * w + x]);
+    }
+    for (int y = h - 1; y >= 0; y--)
+    {
+        for (int x = w - 1; x >= 0; x--)
+        {
+            DistanceOffset &p = grid[y * w + x];
+            CompareOffset(grid, w, h, x, y,  1,  0, p);
+            CompareOffset(grid, w, h, x, y,  0,  1, p);
+            CompareOffset(grid, w, h, x, y, -1,  1, p);
+            CompareOffset(grid, w, h, x, y,  1,  1, p);
+        }
+        for (int x = 0; x < w; x++)
+            CompareOffset(grid, w, h, x, y, -1, 0, grid[y * w + x]);
+    }
+}
+
+
+void GlyphCache::ComputeDistanceField(const Rect &rect, uint spread)
+// ----------------------------------------------------------------------------
+//   Replace the coverage of a glyph in the image with its distance field
+// ----------------------------------------------------------------------------
+//   The alpha channel ends up at 0.5 on the outline, increasing inside
+//   and decreasing outside, reaching 0 or 1 at 'spread' texels.
+{
+    int w = rect.x2 - rect.x1;
+    int h = rect.y2 - rect.y1;
+    const int far = 9999;
+    DistanceGrid inside(w * h), outside(w * h);
+    for (int y = 0; y < h; y++)
+    {
+        QRgb *line = (QRgb *) image.scanLine(rect.y1 + y) + rect.x1;
+        for (int x = 0; x < w; x++)
+        {
+            bool in = qAlpha(line[x]) >= 128;
+            DistanceOffset none, unknown(far, far);
+            inside[y * w + x]  = in ? unknown : none;
+            outside[y * w + x] = in ? none : unknown;
+        }
+    }
+    PropagateOffsets(inside, w, h);
+    PropagateOffsets(outside, w, h);
+
+    for (int y = 0; y < h; y++)
+    {
+        QRgb *line = (QRgb *) image.scanLine(rect.y1 + y) + rect.x1;
+        for (int x = 0; x < w; x++)
+        {
+            double in = sqrt(double(inside[y * w + x].squared()));
+            double out = sqrt(double(outside[y * w + x].squared()));
+            double d = 0.5 + (in - out) / (2 * spread);
+            int alpha = d < 0 ? 0 : d > 1 ? 255 : int(d * 255 + 0.5);
+            line[x] = qRgba(0, 0, 0, alpha);
+        }
+    }
+}
+
+
 void GlyphCache::GenerateTexture()
 // ----------------------------------------------------------------------------
 //   Copy the current image into our GL texture
@@ -759,6 +983,21 @@ qreal GlyphCache::Leading(const QFont &font)
 }
 
 
+void GlyphCache::MeshStatistics(ulong &triangles, ulong &bytes)
+// ----------------------------------------------------------------------------
+//   Return the size of the glyph meshes for all fonts
+// ----------------------------------------------------------------------------
+{
+    triangles = bytes = 0;
+    for (FontMap::iterator it = cache.begin(); it != cache.end(); it++)
+    {
+        TriangleMesh &mesh = (*it).second->mesh;
+        triangles += mesh.Triangles();
+        bytes += mesh.Bytes();
+    }
+}
+
+
 void GlyphCache::ScaleDown(GlyphEntry &entry, scale fontScale, scale extra)
 // ----------------------------------------------------------------------------
 //   Adjust the scale
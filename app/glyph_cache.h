@@ -43,10 +43,12 @@
 #include "layout.h"
 #include "coords.h"
 #include "binpack.h"
+#include "triangle_mesh.h"
 
 #include <QFont>
 #include <QImage>
 #include <QGLContext>
+#include <QGLShaderProgram>
 #include <map>
 
 TAO_BEGIN
@@ -66,8 +68,9 @@ struct GlyphCacheEntry
     scale           outlineDepth;
     scale           outlineRadius;
     uint            outlineCount;
-    uint            outline;
-    uint            interior;
+    TriangleMesh *  mesh;
+    TriangleMesh::Range outline;
+    TriangleMesh::Range interior;
     uint            polycount;
 };
 
@@ -77,8 +80,7 @@ struct PerFontGlyphCache
 //    Cache storing glyph information for a specific font
 // ----------------------------------------------------------------------------
 {
-    PerFontGlyphCache(const QFont &font);
-    ~PerFontGlyphCache();
+    PerFontGlyphCache(const QFont &font, qreal baseSize = 0);
 
 public:
     typedef GlyphCacheEntry GlyphEntry;
@@ -87,6 +89,7 @@ public:
     bool Find(text word, GlyphEntry &entry);
     void Insert(uint code, const GlyphEntry &entry);
     void Insert(text word, const GlyphEntry &entry);
+    bool CompactMesh();
 
 protected:
     typedef std::map<uint, GlyphEntry>  CodeMap;
@@ -99,6 +102,7 @@ protected:
     TextMap     texts;
     qreal       ascent, descent, leading;
     qreal       baseSize;
+    TriangleMesh mesh;          // Interior and outline of glyphs
 };
 
 
@@ -122,6 +126,9 @@ public:
     uint        Width()        { return packer.Width(); }
     uint        Height()       { return packer.Height(); }
     uint        Texture()      { if (dirty) GenerateTexture(); return texture; }
+    bool        DistanceField() { return sdf; }
+    bool        DistanceField(bool enable);
+    QGLShaderProgram *DistanceFieldProgram();
 
     PerFont *   FindFont(const QFont &font, bool create = false);
 
@@ -136,16 +143,20 @@ public:
     qreal       Descent(const QFont &font);
     qreal       Leading(const QFont &font);
     void        ScaleDown(GlyphEntry &, scale fontScale, scale extra);
+    void        MeshStatistics(ulong &triangles, ulong &bytes);
 
+protected:
+    void        ComputeDistanceField(const Rect &rect, uint spread);
 
 protected:
     // We have a special key that distinguish fonts visually
     // Two fonts with slightly differing size are considered equivalent
     struct Key
     {
-        Key(const QFont &font):
-            font(font) {}
+        Key(const QFont &font, bool sized = true):
+            font(font), sized(sized) {}
         QFont font;
+        bool  sized;            // False for distance fields, any size fits
 
         uint fontSizeOrder(const QFont &font) const
         {
@@ -175,8 +186,9 @@ protected:
 
         int compare(const QFont &f1, const QFont &f2) const
         {
-            if (int sizeCmp = order(fontSizeOrder(f1), fontSizeOrder(f2)))
-                return sizeCmp;
+            if (sized)
+                if (int sizeCmp = order(fontSizeOrder(f1),fontSizeOrder(f2)))
+                    return sizeCmp;
             if (int weight = order(f1.weight(), f2.weight()))
                 return weight;
             if (int style = order(f1.style(), f2.style()))
@@ -221,6 +233,10 @@ protected:
     uint        texture;
     QImage      image;
     bool        dirty;
+    bool        sdf;            // Glyphs are stored as signed distance fields
+
+    static QGLShaderProgram *sdfProgram;
+    static bool              sdfFailed;
 
 public:
     static uint defaultSize;
@@ -229,6 +245,10 @@ public:
     scale       minFontSizeForAntialiasing;
     scale       fontScaling;
     uint        antiAliasMargin;
+    scale       sdfFontSize;
+    uint        sdfSpread;
+    ulong       rasterized;
+    ulong       rasterTime;     // Microseconds spent rasterizing glyphs
     uint64      texUnits;
     PerFont *   lastFont;
     const
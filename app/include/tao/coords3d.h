@@ -41,6 +41,7 @@
 // *****************************************************************************
 
 #include "coords.h"
+#include "tao_simd.h"
 #include <iostream>
 
 TAO_BEGIN
@@ -552,13 +553,7 @@ struct Box3
     Box3 &operator |= (const Point3 &o)
     {
         // Make sure that the box contains the 3D point
-        if (o.x < lower.x)        lower.x = o.x;
-        if (o.y < lower.y)        lower.y = o.y;
-        if (o.z < lower.z)        lower.z = o.z;
-
-        if (o.x > upper.x)        upper.x = o.x;
-        if (o.y > upper.y)        upper.y = o.y;
-        if (o.z > upper.z)        upper.z = o.z;
+        BoxUnionPoints(&lower.x, &o.x, 1);
 
         return *this;
     }
@@ -566,13 +561,7 @@ struct Box3
     Box3 &operator |= (const Box3 &o)
     {
         // Return union of the two boxes (smallest box containing both)
-        if (o.lower.x < lower.x)        lower.x = o.lower.x;
-        if (o.lower.y < lower.y)        lower.y = o.lower.y;
-        if (o.lower.z < lower.z)        lower.z = o.lower.z;
-
-        if (o.upper.x > upper.x)        upper.x = o.upper.x;
-        if (o.upper.y > upper.y)        upper.y = o.upper.y;
-        if (o.upper.z > upper.z)        upper.z = o.upper.z;
+        BoxUnion(&lower.x, &o.lower.x);
 
         return *this;
     }
@@ -629,7 +618,7 @@ struct Box3
     coord Back() const        { return lower.z; }
 
 public:
-    Point3 lower, upper;
+    Point3 lower, upper;        // Contiguous, used as coord[6] by BoxUnion
 
 #undef inf
 };
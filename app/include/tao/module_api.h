@@ -65,8 +65,8 @@
 // - [INCOMPATIBLE CHANGE] If any interfaces have been removed or changed
 //   since the last public release, then set age to 0.
 
-#define TAO_MODULE_API_CURRENT   34
-#define TAO_MODULE_API_AGE       0
+#define TAO_MODULE_API_CURRENT   37
+#define TAO_MODULE_API_AGE       3
 
 
 
@@ -494,6 +494,69 @@ struct ModuleApi
     double (*currentPageTime)();
     double (*DevicePixelRatio)();
     bool (*RenderingTransparency)();
+
+    // ------------------------------------------------------------------------
+    //   Frame invalidation
+    // ------------------------------------------------------------------------
+
+    // Tao does not redraw the window when a refresh did not change any
+    // layout. A module that changes what it draws without a layout refresh
+    // (for instance, when it updates a texture it owns) must call
+    // invalidateFrame() so that the next refresh draws a new frame.
+    // Events posted with postEvent() or postEventOnce(), and refreshes
+    // requested with refreshOn(), also invalidate the frame, so that modules
+    // written before this function still work.
+    void (*invalidateFrame)();
+
+    // ------------------------------------------------------------------------
+    //   Multi-view rendering
+    // ------------------------------------------------------------------------
+
+    // Draw the current page for each viewpoint i from 1 to getEyesNumber().
+    // view(arg, i) is called first to select and clear the destination of
+    // the viewpoint (framebuffer, draw buffer, viewport). It must leave the
+    // same graphic state for all viewpoints, apart from the destination.
+    // Tao then sets the matrices of camera i for a w x h frustum, like
+    // setProjectionMatrix() and setModelViewMatrix(), and draws the scene
+    // and the selection.
+    // The layouts are normally traversed only for the first viewpoint. The
+    // OpenGL commands drawing it are recorded, and replayed with the camera
+    // of the other viewpoints. Pages with content that depends on the
+    // viewpoint are drawn for each viewpoint, like with drawScene().
+    // The mouse is tracked in the first viewpoint only.
+    typedef void (*draw_view_fn)(void *arg, int i);
+    void (*drawViews)(int w, int h, draw_view_fn view, void *arg);
+
+    // ------------------------------------------------------------------------
+    //   Background jobs
+    // ------------------------------------------------------------------------
+
+    typedef void (*job_fn)(void *arg);
+    typedef void (*job_done_fn)(void *arg, bool cancelled);
+
+    // Run work(arg) in a pool of threads shared by all modules, for instance
+    // to decode media, fetch data or compute geometry without delaying
+    // frames. work must not call OpenGL, this API or the XL runtime.
+    // When work returns, done(arg, false) is called in the GUI thread,
+    // before the next frame is evaluated. It may use this API, for instance
+    // postEvent() to refresh a layout or invalidateFrame(). done may be NULL.
+    // module is the name shown with the CPU time of the module's jobs in
+    // the rendering statistics.
+    // If owner is not NULL, the job is cancelled when owner is deleted
+    // through deferredDelete(), typically when the tree info is purged.
+    // Returns an identifier for cancelJob(), or 0 if the job was not queued.
+    unsigned long (*submitJob)(std::string module,
+                               job_fn work, job_done_fn done,
+                               void *arg, XL::Info *owner);
+
+    // Cancel a job. done(arg, true) is called immediately if the job had not
+    // started, otherwise when work returns. Returns false if the job was
+    // already done.
+    bool (*cancelJob)(unsigned long id);
+
+    // Cancel all jobs of an owner, waiting for those that are running.
+    // done(arg, true) is called for all of them before this returns.
+    void (*cancelJobs)(XL::Info *owner);
 };
 
 }
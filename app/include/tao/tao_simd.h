@@ -0,0 +1,413 @@
+#ifndef TAO_SIMD_H
+#define TAO_SIMD_H
+// *****************************************************************************
+// tao_simd.h                                                      Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Vectorized implementations of the matrix and coordinate operations
+//     that are on the critical path (matrix multiply and inverse,
+//     bounding box unions)
+//
+//     The SSE2 and AVX versions are selected at compile time, depending on
+//     the instruction set enabled for the compiler (SSE2 is always present
+//     on x86_64, AVX requires e.g. -mavx). Define TAO_NO_SIMD to force the
+//     scalar versions, which are always available under a -Scalar name.
+//
+//     All matrices are 4x4 column-major arrays of 16 coords, as in OpenGL.
+//     Points are arrays of 3 coords, laid out like Point3.
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "coords.h"
+
+#ifndef TAO_NO_SIMD
+#  if defined(__AVX__)
+#    include <immintrin.h>
+#    define TAO_SIMD_AVX        1
+#    define TAO_SIMD_SSE2       1
+#  elif defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define TAO_SIMD_SSE2       1
+#  endif
+#endif
+
+TAO_BEGIN
+
+// ============================================================================
+//
+//   Scalar reference implementations
+//
+// ============================================================================
+
+inline void MatrixMultiplyScalar(const coord *a, const coord *b, coord *r)
+// ----------------------------------------------------------------------------
+//   Compute r = a * b (r may be the same as a or b)
+// ----------------------------------------------------------------------------
+{
+    coord t[16];
+    for (int col = 0; col < 4; col++)
+        for (int row = 0; row < 4; row++)
+            t[col*4 + row] = a[0*4 + row] * b[col*4 + 0] +
+                             a[1*4 + row] * b[col*4 + 1] +
+                             a[2*4 + row] * b[col*4 + 2] +
+                             a[3*4 + row] * b[col*4 + 3];
+    for (int i = 0; i < 16; i++)
+        r[i] = t[i];
+}
+
+
+inline void MatrixMultiplyVectorScalar(const coord *m, const coord in[4],
+                                       coord out[4])
+// ----------------------------------------------------------------------------
+//   Compute out = m * in (out may be the same as in)
+// ----------------------------------------------------------------------------
+{
+    coord x = in[0], y = in[1], z = in[2], w = in[3];
+    for (int row = 0; row < 4; row++)
+        out[row] = x*m[row] + y*m[4+row] + z*m[8+row] + w*m[12+row];
+}
+
+
+inline bool MatrixInvertScalar(const coord *m, coord *r)
+// ----------------------------------------------------------------------------
+//    Compute inverse of a matrix (source: glu), return false if singular
+// ----------------------------------------------------------------------------
+{
+    coord inv[16], det;
+
+    inv[0] =    m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15]
+              + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+    inv[1] =  - m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15]
+              - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+    inv[2] =    m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15]
+              + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+    inv[3] =  - m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11]
+              - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+
+    inv[4] =  - m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15]
+              - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+    inv[5] =    m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15]
+              + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+    inv[6] =  - m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15]
+              - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+    inv[7] =    m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11]
+              + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+
+    inv[8] =    m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15]
+              + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+    inv[9] =  - m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15]
+              - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+    inv[10] =   m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15]
+              + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+    inv[11] = - m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11]
+              - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+
+    inv[12] = - m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14]
+              - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+    inv[13] =   m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14]
+              + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+    inv[14] = - m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14]
+              - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+    inv[15] =   m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10]
+              + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+    det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+    if (det == 0)
+        return false;
+
+    det = 1.0 / det;
+    for (int i = 0; i < 16; i++)
+        r[i] = inv[i] * det;
+    return true;
+}
+
+
+inline void BoxUnionScalar(coord *box, const coord *other)
+// ----------------------------------------------------------------------------
+//   Union of two boxes laid out as lower.x, lower.y, lower.z, upper.x, ...
+// ----------------------------------------------------------------------------
+{
+    for (int i = 0; i < 3; i++)
+        if (other[i] < box[i])
+            box[i] = other[i];
+    for (int i = 3; i < 6; i++)
+        if (other[i] > box[i])
+            box[i] = other[i];
+}
+
+
+inline void BoxUnionPointsScalar(coord *box, const coord *points, uint count)
+// ----------------------------------------------------------------------------
+//   Extend a box so that it contains 'count' 3D points
+// ----------------------------------------------------------------------------
+{
+    for (uint i = 0; i < count; i++, points += 3)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            if (points[c] < box[c])
+                box[c] = points[c];
+            if (points[c] > box[c+3])
+                box[c+3] = points[c];
+        }
+    }
+}
+
+
+
+// ============================================================================
+//
+//   Vectorized implementations
+//
+// ============================================================================
+
+inline kstring SIMDInstructionSet()
+// ----------------------------------------------------------------------------
+//   Return the name of the instruction set used for vectorized operations
+// ----------------------------------------------------------------------------
+{
+#if defined(TAO_SIMD_AVX)
+    return "AVX";
+#elif defined(TAO_SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+
+inline void MatrixMultiply(const coord *a, const coord *b, coord *r)
+// ----------------------------------------------------------------------------
+//   Compute r = a * b (r may be the same as a or b)
+// ----------------------------------------------------------------------------
+//   Each column of the result is a linear combination of the columns of a
+{
+#if defined(TAO_SIMD_AVX)
+    __m256d a0 = _mm256_loadu_pd(a + 0);
+    __m256d a1 = _mm256_loadu_pd(a + 4);
+    __m256d a2 = _mm256_loadu_pd(a + 8);
+    __m256d a3 = _mm256_loadu_pd(a + 12);
+    __m256d c[4];
+    for (int col = 0; col < 4; col++)
+    {
+        const coord *bc = b + 4 * col;
+        __m256d t = _mm256_mul_pd(a0, _mm256_broadcast_sd(bc + 0));
+        t = _mm256_add_pd(t, _mm256_mul_pd(a1, _mm256_broadcast_sd(bc + 1)));
+        t = _mm256_add_pd(t, _mm256_mul_pd(a2, _mm256_broadcast_sd(bc + 2)));
+        t = _mm256_add_pd(t, _mm256_mul_pd(a3, _mm256_broadcast_sd(bc + 3)));
+        c[col] = t;
+    }
+    for (int col = 0; col < 4; col++)
+        _mm256_storeu_pd(r + 4 * col, c[col]);
+#elif defined(TAO_SIMD_SSE2)
+    __m128d alo[4], ahi[4], clo[4], chi[4];
+    for (int k = 0; k < 4; k++)
+    {
+        alo[k] = _mm_loadu_pd(a + 4*k);
+        ahi[k] = _mm_loadu_pd(a + 4*k + 2);
+    }
+    for (int col = 0; col < 4; col++)
+    {
+        const coord *bc = b + 4 * col;
+        __m128d s = _mm_set1_pd(bc[0]);
+        __m128d lo = _mm_mul_pd(alo[0], s);
+        __m128d hi = _mm_mul_pd(ahi[0], s);
+        for (int k = 1; k < 4; k++)
+        {
+            s = _mm_set1_pd(bc[k]);
+            lo = _mm_add_pd(lo, _mm_mul_pd(alo[k], s));
+            hi = _mm_add_pd(hi, _mm_mul_pd(ahi[k], s));
+        }
+        clo[col] = lo;
+        chi[col] = hi;
+    }
+    for (int col = 0; col < 4; col++)
+    {
+        _mm_storeu_pd(r + 4*col, clo[col]);
+        _mm_storeu_pd(r + 4*col + 2, chi[col]);
+    }
+#else
+    MatrixMultiplyScalar(a, b, r);
+#endif
+}
+
+
+inline void MatrixMultiplyVector(const coord *m, const coord in[4],
+                                 coord out[4])
+// ----------------------------------------------------------------------------
+//   Compute out = m * in (out may be the same as in)
+// ----------------------------------------------------------------------------
+{
+#if defined(TAO_SIMD_AVX)
+    __m256d t = _mm256_mul_pd(_mm256_loadu_pd(m), _mm256_set1_pd(in[0]));
+    t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_loadu_pd(m + 4),
+                                       _mm256_set1_pd(in[1])));
+    t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_loadu_pd(m + 8),
+                                       _mm256_set1_pd(in[2])));
+    t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_loadu_pd(m + 12),
+                                       _mm256_set1_pd(in[3])));
+    _mm256_storeu_pd(out, t);
+#elif defined(TAO_SIMD_SSE2)
+    __m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+    __m128d v[4];
+    for (int k = 0; k < 4; k++)
+        v[k] = _mm_set1_pd(in[k]);
+    for (int k = 0; k < 4; k++)
+    {
+        lo = _mm_add_pd(lo, _mm_mul_pd(_mm_loadu_pd(m + 4*k), v[k]));
+        hi = _mm_add_pd(hi, _mm_mul_pd(_mm_loadu_pd(m + 4*k + 2), v[k]));
+    }
+    _mm_storeu_pd(out, lo);
+    _mm_storeu_pd(out + 2, hi);
+#else
+    MatrixMultiplyVectorScalar(m, in, out);
+#endif
+}
+
+
+inline bool MatrixInvert(const coord *m, coord *r)
+// ----------------------------------------------------------------------------
+//   Compute inverse of a matrix, return false if singular (r may be m)
+// ----------------------------------------------------------------------------
+//   We use the Laplace expansion by 2x2 sub-determinants. The matrix is
+//   split in pairs of rows (0,2) and (1,3), so that each SSE2 operation
+//   computes one sub-determinant or cofactor from the top two rows and
+//   the matching one from the bottom two rows at the same time.
+//   AVX does not help here, since the data would have to cross lanes.
+{
+#if defined(TAO_SIMD_SSE2)
+    // Rows (0,2) and (1,3) of each column j
+    __m128d r02[4], r13[4];
+    for (int j = 0; j < 4; j++)
+    {
+        __m128d lo = _mm_loadu_pd(m + 4*j);             // (m0j, m1j)
+        __m128d hi = _mm_loadu_pd(m + 4*j + 2);         // (m2j, m3j)
+        r02[j] = _mm_unpacklo_pd(lo, hi);               // (m0j, m2j)
+        r13[j] = _mm_unpackhi_pd(lo, hi);               // (m1j, m3j)
+    }
+
+    // Sub-determinants: lane 0 from rows 2-3 (c), lane 1 from rows 0-1 (s)
+#define SWAP(v)         _mm_shuffle_pd(v, v, 1)
+#define SUBDET(j, k)    _mm_sub_pd(_mm_mul_pd(SWAP(r02[j]), SWAP(r13[k])), \
+                                   _mm_mul_pd(SWAP(r13[j]), SWAP(r02[k])))
+    __m128d p0 = SUBDET(0, 1);
+    __m128d p1 = SUBDET(0, 2);
+    __m128d p2 = SUBDET(0, 3);
+    __m128d p3 = SUBDET(1, 2);
+    __m128d p4 = SUBDET(1, 3);
+    __m128d p5 = SUBDET(2, 3);
+#undef SUBDET
+
+    // Determinant, sum of s(i) * c(5-i) with alternating signs
+    __m128d d = _mm_mul_pd(p0, SWAP(p5));
+    d = _mm_sub_pd(d, _mm_mul_pd(p1, SWAP(p4)));
+    d = _mm_add_pd(d, _mm_mul_pd(p2, SWAP(p3)));
+    d = _mm_add_sd(d, SWAP(d));
+    coord det = _mm_cvtsd_f64(d);
+    if (det == 0)
+        return false;
+#undef SWAP
+
+    // Cofactors, computed for two rows of the inverse at once
+#define COFACTOR(r, a, pa, b, pb, c, pc)                                \
+    _mm_add_pd(_mm_sub_pd(_mm_mul_pd(r[a], pa), _mm_mul_pd(r[b], pb)),  \
+               _mm_mul_pd(r[c], pc))
+    __m128d pos = _mm_set1_pd(1.0 / det);
+    __m128d neg = _mm_set1_pd(-1.0 / det);
+    __m128d q0 = _mm_mul_pd(COFACTOR(r13, 1, p5, 2, p4, 3, p3), pos);
+    __m128d q1 = _mm_mul_pd(COFACTOR(r02, 1, p5, 2, p4, 3, p3), neg);
+    __m128d q2 = _mm_mul_pd(COFACTOR(r13, 0, p5, 2, p2, 3, p1), neg);
+    __m128d q3 = _mm_mul_pd(COFACTOR(r02, 0, p5, 2, p2, 3, p1), pos);
+    __m128d q4 = _mm_mul_pd(COFACTOR(r13, 0, p4, 1, p2, 3, p0), pos);
+    __m128d q5 = _mm_mul_pd(COFACTOR(r02, 0, p4, 1, p2, 3, p0), neg);
+    __m128d q6 = _mm_mul_pd(COFACTOR(r13, 0, p3, 1, p1, 2, p0), neg);
+    __m128d q7 = _mm_mul_pd(COFACTOR(r02, 0, p3, 1, p1, 2, p0), pos);
+#undef COFACTOR
+
+    // q0 = (b00, b02), q1 = (b01, b03), q2 = (b10, b12), q3 = (b11, b13)...
+    _mm_storeu_pd(r + 0,  _mm_unpacklo_pd(q0, q2));
+    _mm_storeu_pd(r + 2,  _mm_unpacklo_pd(q4, q6));
+    _mm_storeu_pd(r + 4,  _mm_unpacklo_pd(q1, q3));
+    _mm_storeu_pd(r + 6,  _mm_unpacklo_pd(q5, q7));
+    _mm_storeu_pd(r + 8,  _mm_unpackhi_pd(q0, q2));
+    _mm_storeu_pd(r + 10, _mm_unpackhi_pd(q4, q6));
+    _mm_storeu_pd(r + 12, _mm_unpackhi_pd(q1, q3));
+    _mm_storeu_pd(r + 14, _mm_unpackhi_pd(q5, q7));
+    return true;
+#else
+    return MatrixInvertScalar(m, r);
+#endif
+}
+
+
+inline void BoxUnion(coord *box, const coord *other)
+// ----------------------------------------------------------------------------
+//   Union of two boxes laid out as lower.x, lower.y, lower.z, upper.x, ...
+// ----------------------------------------------------------------------------
+//   Operand order for min/max matches the scalar version for NaN inputs
+{
+#if defined(TAO_SIMD_SSE2)
+    __m128d lxy = _mm_min_pd(_mm_loadu_pd(other), _mm_loadu_pd(box));
+    __m128d ozx = _mm_loadu_pd(other + 2), bzx = _mm_loadu_pd(box + 2);
+    __m128d zx  = _mm_move_sd(_mm_max_pd(ozx, bzx), _mm_min_pd(ozx, bzx));
+    __m128d uyz = _mm_max_pd(_mm_loadu_pd(other + 4), _mm_loadu_pd(box + 4));
+    _mm_storeu_pd(box, lxy);
+    _mm_storeu_pd(box + 2, zx);
+    _mm_storeu_pd(box + 4, uyz);
+#else
+    BoxUnionScalar(box, other);
+#endif
+}
+
+
+inline void BoxUnionPoints(coord *box, const coord *points, uint count)
+// ----------------------------------------------------------------------------
+//   Extend a box so that it contains 'count' 3D points
+// ----------------------------------------------------------------------------
+{
+#if defined(TAO_SIMD_SSE2)
+    __m128d lxy = _mm_loadu_pd(box),     lz = _mm_load_sd(box + 2);
+    __m128d uxy = _mm_loadu_pd(box + 3), uz = _mm_load_sd(box + 5);
+    for (uint i = 0; i < count; i++, points += 3)
+    {
+        __m128d pxy = _mm_loadu_pd(points);
+        __m128d pz = _mm_load_sd(points + 2);
+        lxy = _mm_min_pd(pxy, lxy);
+        uxy = _mm_max_pd(pxy, uxy);
+        lz  = _mm_min_sd(pz, lz);
+        uz  = _mm_max_sd(pz, uz);
+    }
+    _mm_storeu_pd(box, lxy);
+    _mm_store_sd(box + 2, lz);
+    _mm_storeu_pd(box + 3, uxy);
+    _mm_store_sd(box + 5, uz);
+#else
+    BoxUnionPointsScalar(box, points, count);
+#endif
+}
+
+TAO_END
+
+#endif // TAO_SIMD_H
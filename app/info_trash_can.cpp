@@ -37,6 +37,8 @@
 // *****************************************************************************
 
 #include "info_trash_can.h"
+#include "application.h"
+#include "job_pool.h"
 
 TAO_BEGIN
 
@@ -46,11 +48,14 @@ void InfoTrashCan::Empty()
 // ------------------------------------------------------------------------
 //   Empty the trash can
 // ------------------------------------------------------------------------
+//   Background jobs of modules may use the objects, cancel them first
 {
     while (!trash.empty())
     {
         XL::Info *tmp = trash.back();
         trash.pop_back();
+        if (TaoApp->jobPool)
+            TaoApp->jobPool->Cancel(tmp);
         delete tmp;
     }
 
@@ -0,0 +1,453 @@
+// *****************************************************************************
+// job_pool.cpp                                                    Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Pool of threads running background jobs for modules, with completion
+//     callbacks delivered in the GUI thread and CPU time accounted for each
+//     module in the rendering statistics.
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "job_pool.h"
+#include "application.h"
+#include "base.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace Tao {
+
+JobPool::JobPool()
+// ----------------------------------------------------------------------------
+//   Create an empty pool, threads are started for the first job
+// ----------------------------------------------------------------------------
+    : workers(), queues(), nextQueue(0), nextId(1), lastFrame(), owners(),
+      pending(0), running(), finished(), thisFrame(), quit(false)
+{
+    connect(this, SIGNAL(completed()), this, SLOT(deliver()),
+            Qt::QueuedConnection);
+}
+
+
+JobPool::~JobPool()
+// ----------------------------------------------------------------------------
+//   Stop the threads and delete the queues
+// ----------------------------------------------------------------------------
+{
+    Stop();
+    for (uint i = 0; i < queues.size(); i++)
+        delete queues[i];
+}
+
+
+void JobPool::start()
+// ----------------------------------------------------------------------------
+//   Start one thread per core, leaving one for the GUI thread
+// ----------------------------------------------------------------------------
+{
+    int count = QThread::idealThreadCount() - 1;
+    if (count < 1)
+        count = 1;
+
+    IFTRACE(jobs)
+        debug() << "Starting " << count << " threads\n";
+    for (int i = 0; i < count; i++)
+        queues.push_back(new Queue);
+    for (int i = 0; i < count; i++)
+    {
+        Worker *worker = new Worker(this, i);
+        workers.push_back(worker);
+        worker->start(QThread::LowPriority);
+    }
+}
+
+
+ulong JobPool::Submit(text module, job_fn work, job_done_fn done,
+                      void *arg, XL::Info *owner)
+// ----------------------------------------------------------------------------
+//   Queue a job, return its identifier or 0 if it cannot run
+// ----------------------------------------------------------------------------
+{
+    if (!work || quit)
+        return 0;
+    if (workers.empty())
+        start();
+
+    Job *job = new Job;
+    job->id = nextId++;
+    job->module = module;
+    job->work = work;
+    job->done = done;
+    job->arg = arg;
+    job->owner = owner;
+    job->cancelled = false;
+    if (owner)
+        owners[owner]++;
+
+    IFTRACE(jobs)
+        debug() << "Submit job " << job->id << " for " << module << "\n";
+
+    // The worker taking the job may count it before we do
+    Queue *queue = queues[nextQueue++ % queues.size()];
+    queue->mutex.lock();
+    queue->jobs.append(job);
+    queue->mutex.unlock();
+
+    mutex.lock();
+    pending++;
+    wake.wakeOne();
+    mutex.unlock();
+
+    return job->id;
+}
+
+
+bool JobPool::Cancel(ulong id)
+// ----------------------------------------------------------------------------
+//   Cancel a job that is queued, running or not delivered yet
+// ----------------------------------------------------------------------------
+//   A queued job is done immediately. Others are done when delivered.
+{
+    for (uint q = 0; q < queues.size(); q++)
+    {
+        Queue *queue = queues[q];
+        Job *job = NULL;
+        queue->mutex.lock();
+        for (int i = 0; i < queue->jobs.size() && !job; i++)
+            if (queue->jobs[i]->id == id)
+                job = queue->jobs.takeAt(i);
+        queue->mutex.unlock();
+
+        if (job)
+        {
+            IFTRACE(jobs)
+                debug() << "Cancel queued job " << id << "\n";
+            mutex.lock();
+            pending--;
+            mutex.unlock();
+            done(job, true);
+            return true;
+        }
+    }
+
+    QMutexLocker locker(&mutex);
+    Jobs *lists[] = { &running, &finished };
+    for (uint l = 0; l < 2; l++)
+    {
+        Jobs &jobs = *lists[l];
+        for (int i = 0; i < jobs.size(); i++)
+        {
+            if (jobs[i]->id == id)
+            {
+                IFTRACE(jobs)
+                    debug() << "Cancel " << (l ? "completed" : "running")
+                            << " job " << id << "\n";
+                jobs[i]->cancelled = true;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+void JobPool::Cancel(XL::Info *owner)
+// ----------------------------------------------------------------------------
+//   Cancel all jobs of an owner that is about to be deleted
+// ----------------------------------------------------------------------------
+//   Jobs that are running are waited for, so that none of them uses the
+//   owner once this returns, and all are done before the owner is deleted.
+//   This is called for every Info deleted, so owners without jobs return
+//   without locking the queues.
+{
+    if (!owner || owners.find(owner) == owners.end())
+        return;
+
+    Jobs cancelled;
+    for (uint q = 0; q < queues.size(); q++)
+    {
+        Queue *queue = queues[q];
+        queue->mutex.lock();
+        for (int i = 0; i < queue->jobs.size(); i++)
+            if (queue->jobs[i]->owner == owner)
+                cancelled.append(queue->jobs.takeAt(i--));
+        queue->mutex.unlock();
+    }
+
+    mutex.lock();
+    pending -= cancelled.size();
+    for (int i = 0; i < running.size(); i++)
+    {
+        if (running[i]->owner == owner)
+        {
+            IFTRACE(jobs)
+                debug() << "Wait for job " << running[i]->id << "\n";
+            idle.wait(&mutex);
+            i = -1;
+        }
+    }
+    for (int i = 0; i < finished.size(); i++)
+        if (finished[i]->owner == owner)
+            cancelled.append(finished.takeAt(i--));
+    mutex.unlock();
+
+    foreach (Job *job, cancelled)
+    {
+        IFTRACE(jobs)
+            debug() << "Cancel job " << job->id << " with its owner\n";
+        done(job, true);
+    }
+}
+
+
+void JobPool::Deliver()
+// ----------------------------------------------------------------------------
+//   Call the done function of completed jobs in the GUI thread
+// ----------------------------------------------------------------------------
+{
+    mutex.lock();
+    Jobs done = finished;
+    finished.clear();
+    mutex.unlock();
+
+    foreach (Job *job, done)
+    {
+        IFTRACE(jobs)
+            debug() << "Deliver job " << job->id
+                    << (job->cancelled ? " (cancelled)\n" : "\n");
+        done(job, job->cancelled);
+    }
+}
+
+
+void JobPool::Stop()
+// ----------------------------------------------------------------------------
+//   Cancel queued jobs, wait for running ones and stop the threads
+// ----------------------------------------------------------------------------
+{
+    if (workers.empty())
+        return;
+
+    Jobs cancelled;
+    for (uint q = 0; q < queues.size(); q++)
+    {
+        Queue *queue = queues[q];
+        queue->mutex.lock();
+        cancelled.append(queue->jobs);
+        queue->jobs.clear();
+        queue->mutex.unlock();
+    }
+
+    mutex.lock();
+    pending = 0;
+    quit = true;
+    wake.wakeAll();
+    mutex.unlock();
+
+    IFTRACE(jobs)
+        debug() << "Stopping, " << cancelled.size() << " jobs cancelled\n";
+    for (uint i = 0; i < workers.size(); i++)
+    {
+        workers[i]->wait();
+        delete workers[i];
+    }
+    workers.clear();
+
+    foreach (Job *job, cancelled)
+        done(job, true);
+    Deliver();
+}
+
+
+void JobPool::EndFrame(ulong &jobs, ulong &cpuTime)
+// ----------------------------------------------------------------------------
+//   Keep the load of each module for the last frame, return the total
+// ----------------------------------------------------------------------------
+//   Modules that submitted jobs are kept, so that they remain listed
+{
+    QMutexLocker locker(&mutex);
+    lastFrame = thisFrame;
+    jobs = cpuTime = 0;
+    for (ModuleLoads::iterator m = thisFrame.begin(); m != thisFrame.end(); m++)
+    {
+        jobs += (*m).second.jobs;
+        cpuTime += (*m).second.cpuTime;
+        (*m).second = ModuleLoad();
+    }
+}
+
+
+void JobPool::work(uint index)
+// ----------------------------------------------------------------------------
+//   Run jobs in a worker thread until stopped
+// ----------------------------------------------------------------------------
+{
+    forever
+    {
+        Job *job = take(index);
+        if (!job)
+        {
+            QMutexLocker locker(&mutex);
+            while (!quit && pending <= 0)
+                wake.wait(&mutex);
+            if (quit)
+                return;
+            continue;
+        }
+
+        qint64 start = threadCPUTime();
+        job->work(job->arg);
+        qint64 cpuTime = threadCPUTime() - start;
+
+        mutex.lock();
+        ModuleLoad &load = thisFrame[job->module];
+        load.jobs++;
+        load.cpuTime += cpuTime;
+        running.removeOne(job);
+        bool first = finished.isEmpty();
+        finished.append(job);
+        idle.wakeAll();
+        mutex.unlock();
+
+        if (first)
+            emit completed();
+    }
+}
+
+
+JobPool::Job *JobPool::take(uint index)
+// ----------------------------------------------------------------------------
+//   Take the oldest job of our queue, or steal the newest of another one
+// ----------------------------------------------------------------------------
+//   The job is moved to the running list before the queue is unlocked, so
+//   that Cancel always finds it in one place or the other.
+{
+    uint count = queues.size();
+    for (uint i = 0; i < count; i++)
+    {
+        Queue *queue = queues[(index + i) % count];
+        QMutexLocker queueLocker(&queue->mutex);
+        if (queue->jobs.isEmpty())
+            continue;
+
+        Job *job = i ? queue->jobs.takeLast() : queue->jobs.takeFirst();
+        QMutexLocker locker(&mutex);
+        pending--;
+        running.append(job);
+        return job;
+    }
+    return NULL;
+}
+
+
+void JobPool::done(Job *job, bool cancelled)
+// ----------------------------------------------------------------------------
+//   Call the done function of a job in the GUI thread and delete it
+// ----------------------------------------------------------------------------
+{
+    if (job->done)
+        job->done(job->arg, cancelled);
+    if (job->owner)
+    {
+        OwnerJobs::iterator found = owners.find(job->owner);
+        if (found != owners.end() && --(*found).second == 0)
+            owners.erase(found);
+    }
+    delete job;
+}
+
+
+qint64 JobPool::threadCPUTime()
+// ----------------------------------------------------------------------------
+//   CPU time used by the calling thread, in microseconds
+// ----------------------------------------------------------------------------
+{
+#if defined(Q_OS_WIN)
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+        return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 10;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+    // No thread CPU clock, use the time elapsed instead
+    return QDateTime::currentMSecsSinceEpoch() * 1000;
+#endif
+}
+
+
+std::ostream &JobPool::debug()
+// ----------------------------------------------------------------------------
+//   Convenience method to log with a common prefix
+// ----------------------------------------------------------------------------
+{
+    std::cerr << "[JobPool] ";
+    return std::cerr;
+}
+
+
+ulong JobPool::SubmitJob(text module, job_fn work, job_done_fn done,
+                         void *arg, XL::Info *owner)
+// ----------------------------------------------------------------------------
+//   Export Submit to modules
+// ----------------------------------------------------------------------------
+{
+    return TaoApp->jobPool->Submit(module, work, done, arg, owner);
+}
+
+
+bool JobPool::CancelJob(ulong id)
+// ----------------------------------------------------------------------------
+//   Export Cancel to modules
+// ----------------------------------------------------------------------------
+{
+    return TaoApp->jobPool->Cancel(id);
+}
+
+
+void JobPool::CancelJobs(XL::Info *owner)
+// ----------------------------------------------------------------------------
+//   Export Cancel to modules
+// ----------------------------------------------------------------------------
+{
+    TaoApp->jobPool->Cancel(owner);
+}
+
+}
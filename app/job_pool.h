@@ -0,0 +1,162 @@
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+// *****************************************************************************
+// job_pool.h                                                      Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Pool of threads running background jobs for modules, with completion
+//     callbacks delivered in the GUI thread and CPU time accounted for each
+//     module in the rendering statistics.
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "tao.h"
+#include "tao/module_api.h"
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <map>
+#include <vector>
+#include <iostream>
+
+namespace Tao {
+
+class JobPool : public QObject
+// ----------------------------------------------------------------------------
+//    Run module jobs in worker threads, and deliver results between frames
+// ----------------------------------------------------------------------------
+//    Each worker has its own queue. Jobs are submitted to the queues in
+//    turn, workers take the oldest job of their own queue, and steal the
+//    newest job of another queue when theirs is empty, so that a long job
+//    does not hold back the jobs queued after it.
+//    Completed jobs are kept until the GUI thread delivers them, either
+//    when it gets the completed() signal or before it evaluates a frame.
+//    Threads are only started when the first job is submitted.
+{
+    Q_OBJECT
+
+public:
+    typedef ModuleApi::job_fn           job_fn;
+    typedef ModuleApi::job_done_fn      job_done_fn;
+
+    struct ModuleLoad
+    {
+        ModuleLoad(): jobs(0), cpuTime(0) {}
+        ulong       jobs;               // Jobs completed
+        ulong       cpuTime;            // CPU time of their work (us)
+    };
+    typedef std::map<text, ModuleLoad>  ModuleLoads;
+
+public:
+    JobPool();
+    virtual ~JobPool();
+
+    // Used in the GUI thread
+    ulong           Submit(text module, job_fn work, job_done_fn done,
+                           void *arg, XL::Info *owner);
+    bool            Cancel(ulong id);
+    void            Cancel(XL::Info *owner);
+    void            Deliver();
+    void            Stop();
+
+    // Statistics
+    void            EndFrame(ulong &jobs, ulong &cpuTime);
+    const ModuleLoads &LastFrame()      { return lastFrame; }
+
+    // Module API
+    static ulong    SubmitJob(text module, job_fn work, job_done_fn done,
+                              void *arg, XL::Info *owner);
+    static bool     CancelJob(ulong id);
+    static void     CancelJobs(XL::Info *owner);
+
+signals:
+    void            completed();
+
+private slots:
+    void            deliver()           { Deliver(); }
+
+private:
+    struct Job
+    {
+        ulong       id;
+        text        module;
+        job_fn      work;
+        job_done_fn done;
+        void *      arg;
+        XL::Info *  owner;
+        bool        cancelled;
+    };
+    typedef QList<Job *>                Jobs;
+    typedef std::map<XL::Info *, uint>  OwnerJobs;
+
+    struct Queue
+    {
+        QMutex      mutex;
+        Jobs        jobs;
+    };
+
+    struct Worker : QThread
+    {
+        Worker(JobPool *pool, uint index): pool(pool), index(index) {}
+        virtual void run()              { pool->work(index); }
+        JobPool *   pool;
+        uint        index;
+    };
+
+    void            start();
+    void            work(uint index);
+    Job *           take(uint index);
+    void            done(Job *job, bool cancelled);
+    static qint64   threadCPUTime();
+    std::ostream &  debug();
+
+private:
+    // Used only in the GUI thread
+    std::vector<Worker *> workers;
+    std::vector<Queue *>  queues;
+    uint                  nextQueue;
+    ulong                 nextId;
+    ModuleLoads           lastFrame;
+    OwnerJobs             owners;       // Jobs not done yet, by owner
+
+    // Shared with the workers
+    QMutex                mutex;
+    QWaitCondition        wake;         // Jobs were queued
+    QWaitCondition        idle;         // A job completed
+    int                   pending;      // Jobs in the queues
+    Jobs                  running;
+    Jobs                  finished;
+    ModuleLoads           thisFrame;
+    bool                  quit;
+};
+
+}
+
+#endif // JOB_POOL_H
@@ -46,6 +46,13 @@
 #include "tao_utf8.h"
 #include "statistics.h"
 #include "preferences_pages.h"
+#include "damage_region.h"
+#include "module_renderer.h"
+#include "shapes.h"
+#include "shapes3d.h"
+#include "path3d.h"
+#include "draw_batch.h"
+#include "main.h"
 #include <sstream>
 #include "demangle.h"
 
@@ -57,6 +64,8 @@ scale Layout::factorIncrement = -0.005; // Experimental value
 scale Layout::unitBase        = 0;
 scale Layout::unitIncrement   = -1;
 bool  Layout::inIdentify      = false;
+ulong LayoutState::copies     = 0;
+QSharedDataPointer<LayoutModel> LayoutState::identity(new LayoutModel);
 
 
 LayoutState::LayoutState()
@@ -77,6 +86,7 @@ LayoutState::LayoutState()
       lightId(GL_LIGHT0),
       perPixelLighting(TaoApp->useShaderLighting),
       programId(0),
+      model(identity),
       groupDrag(false),
       transparency(false),
       blendOrShade(false)
@@ -105,7 +115,23 @@ LayoutState::LayoutState(const LayoutState &o)
       groupDrag(false),
       transparency(false),
       blendOrShade(false)
-{}
+{
+    copies++;
+}
+
+
+LayoutState &LayoutState::operator=(const LayoutState &o)
+// ----------------------------------------------------------------------------
+//   Copy all state, e.g. to restore it or reset it to the defaults
+// ----------------------------------------------------------------------------
+{
+    InheritState(&o);
+    offset           = o.offset;
+    groupDrag        = o.groupDrag;
+    transparency     = o.transparency;
+    blendOrShade     = o.blendOrShade;
+    return *this;
+}
 
 
 void LayoutState::ClearAttributes()
@@ -167,8 +193,9 @@ Layout::Layout(Widget *widget)
     : Drawing(),
       LayoutState(widget->layout ? *widget->layout : LayoutState()),
       id(0), charId(0), parent(NULL),
-      items(), display(widget), idx(-1),
-      refreshEvents(), nextRefresh(DBL_MAX)
+      items(), display(widget), idx(-1), arena(),
+      refreshEvents(), nextRefresh(DBL_MAX), screenBounds(), damaged(false),
+      cachedBounds(), cachedOffset(), boundsCached(false)
 {
     IFTRACE(justify)
         std::cerr << "<-> Layout::Layout ["<< this << "] parent widget is "
@@ -182,8 +209,9 @@ Layout::Layout(const Layout &o)
 //   Copy constructor
 // ----------------------------------------------------------------------------
     : Drawing(o), LayoutState(o), id(0), charId(0), parent(NULL),
-      items(), display(o.display), idx(-1),
-      refreshEvents(), nextRefresh(DBL_MAX)
+      items(), display(o.display), idx(-1), arena(),
+      refreshEvents(), nextRefresh(DBL_MAX), screenBounds(), damaged(false),
+      cachedBounds(), cachedOffset(), boundsCached(false)
 {
     IFTRACE(justify)
         std::cerr << "<-> Layout::Layout ["<< this << "] parent layout is "
@@ -269,6 +297,9 @@ void Layout::ClearCaches()
     IFTRACE(justify)
         std::cerr << "Layout::ClearCaches ["<< this << "]\n";
 
+    // Bounds will be recomputed next time we are drawn
+    boundsCached = false;
+
     // Remove cached references
     Drawings ch = caches;
     caches.clear();
@@ -293,6 +324,68 @@ void Layout::ClearCaches()
 }
 
 
+static Box3 TransformBounds(const Box3 &bounds, const coord matrix[16])
+// ----------------------------------------------------------------------------
+//   Return the axis-aligned box containing the transformed bounds
+// ----------------------------------------------------------------------------
+{
+    // Nothing drawn (flat shapes have lower.z == upper.z, not IsEmpty)
+    Box3 result;
+    if (bounds.lower.x > bounds.upper.x || bounds.lower.y > bounds.upper.y)
+        return result;
+
+    for (uint c = 0; c < 8; c++)
+    {
+        coord in[4] = { (c & 1) ? bounds.upper.x : bounds.lower.x,
+                        (c & 2) ? bounds.upper.y : bounds.lower.y,
+                        (c & 4) ? bounds.upper.z : bounds.lower.z,
+                        1.0 };
+        coord out[4];
+        GL.MultMatrixVec(matrix, in, out);
+        if (out[3] != 1.0 && out[3] != 0.0)
+            for (uint j = 0; j < 3; j++)
+                out[j] /= out[3];
+        result |= Point3(out[0], out[1], out[2]);
+    }
+    return result;
+}
+
+
+static bool OutsideFrustum(const Box3 &bounds, const coord mvp[16])
+// ----------------------------------------------------------------------------
+//   Check if all corners of the bounds are beyond the same frustum plane
+// ----------------------------------------------------------------------------
+//   The test is done in clip coordinates, where the frustum planes are
+//   -w <= x, y, z <= w. This remains correct for corners behind the eye.
+//   The frustum is enlarged slightly to keep antialiased edges.
+{
+    if (bounds.lower.x > bounds.upper.x || bounds.lower.y > bounds.upper.y)
+        return false;
+
+    const coord margin = 0.02;
+    uint below[3] = { 0, 0, 0 }, above[3] = { 0, 0, 0 };
+    for (uint c = 0; c < 8; c++)
+    {
+        coord in[4] = { (c & 1) ? bounds.upper.x : bounds.lower.x,
+                        (c & 2) ? bounds.upper.y : bounds.lower.y,
+                        (c & 4) ? bounds.upper.z : bounds.lower.z,
+                        1.0 };
+        coord out[4];
+        GL.MultMatrixVec(mvp, in, out);
+        coord w = out[3] + margin * fabs(out[3]);
+        for (uint j = 0; j < 3; j++)
+        {
+            below[j] += out[j] < -w;
+            above[j] += out[j] > w;
+        }
+    }
+    for (uint j = 0; j < 3; j++)
+        if (below[j] == 8 || above[j] == 8)
+            return true;
+    return false;
+}
+
+
 void Layout::Draw(Layout *where)
 // ----------------------------------------------------------------------------
 //   Draw the elements in the layout
@@ -311,14 +404,104 @@ void Layout::Draw(Layout *where)
         GLAllStateKeeper glSave;
         Inherit(where);
 
+        // Record the window area we cover, to redraw only what changed
+        bool bounds = display->damageRegion().Enabled() && !transparency;
+        if (bounds)
+            screenBounds.Empty();
+
+        // Skip drawings entirely outside of the view frustum, and compute
+        // our own bounds as we go, so that our parent can skip us as a whole.
+        // Drawings recorded for other viewpoints may be in their frustum.
+        bool cull = display->culling;
+        bool keep = display->viewReplay().Recording();
+        bool bounded = cull;
+        bool matrices = false;
+        Box3 drawnBounds;
+        Vector3 entryOffset = offset;
+        coord inverse[16], mvp[16], relative[16];
+        ulong drawn = 0, culled = 0;
+        if (cull)
+            bounded = GL.InvertMatrix(GL.ModelViewMatrix(), inverse);
+
+        // Merge the fills of consecutive shapes into single draw calls
+        DrawBatch *batch = &display->drawBatch();
+        if (!batch->Enabled())
+            batch = NULL;
+
         // Display all items
         PushLayout();
         for (Drawings::iterator i = items.begin(); i != items.end(); i++)
         {
             Drawing *child = *i;
-            child->Draw(this);
+            if (!cull || dynamic_cast<Attribute *>(child))
+            {
+                DrawChild(child, bounds, batch);
+                matrices = false;
+                continue;
+            }
+
+            // Transforms only change between drawings that are attributes
+            if (!matrices)
+            {
+                const coord *mv = GL.ModelViewMatrix();
+                GL.MultMatrices(mv, GL.ProjectionMatrix(), mvp);
+                GL.MultMatrices(mv, inverse, relative);
+                matrices = true;
+            }
+
+            // Shaders may move vertices anywhere
+            Box3 box;
+            bool known = !programId && ChildBounds(child, box);
+            if (known && !keep && OutsideFrustum(box, mvp))
+            {
+                culled++;
+            }
+            else
+            {
+                DrawChild(child, bounds, batch);
+                drawn++;
+                if (!known)
+                {
+                    // Modules may change the transform without restoring it
+                    known = !programId && ChildBounds(child, box);
+                    matrices = false;
+                }
+            }
+
+            if (!known)
+                bounded = false;
+            else if (bounded)
+                drawnBounds |= TransformBounds(box, relative);
         }
+        if (batch)
+            batch->Flush();
         PopLayout();
+
+        if (cull)
+        {
+            cachedBounds = drawnBounds;
+            cachedOffset = entryOffset;
+            boundsCached = bounded;
+            display->stats.count(Statistics::DRAWINGS_DRAWN, drawn);
+            display->stats.count(Statistics::DRAWINGS_CULLED, culled);
+            IFTRACE(culling)
+                if (culled)
+                    std::cerr << "Layout " << PrettyId() << " culled "
+                              << culled << " of " << culled + drawn
+                              << " drawings\n";
+        }
+
+        // Check where we were drawn if we were refreshed. Add our area to
+        // the layout we are drawn in, even if we are not one of its items
+        // (text flows, for instance, are drawn by replay items)
+        if (bounds)
+        {
+            if (damaged)
+                display->damageRegion().Drawn(screenBounds);
+            damaged = false;
+            if (where)
+                where->screenBounds |= screenBounds;
+        }
     }
 
     // Two passes for transparency, see #2199
@@ -337,6 +520,120 @@ void Layout::Draw(Layout *where)
 }
 
 
+void Layout::DrawWithBounds(Drawing *child)
+// ----------------------------------------------------------------------------
+//   Draw a child, adding the window area it covers to ours
+// ----------------------------------------------------------------------------
+//   Child layouts record their own area as they are drawn, except those
+//   that do not draw through Layout::Draw, for which it is computed from
+//   their bounds. Attributes compute their bounds by drawing themselves,
+//   so they are not asked. Modules may draw anywhere.
+{
+    DamageRegion &damage = display->damageRegion();
+    if (Layout *layout = dynamic_cast<Layout *>(child))
+    {
+        layout->screenBounds.Empty();
+        layout->Draw(this);
+        if (layout->screenBounds.IsEmpty())
+            damage.Project(layout->screenBounds, layout->Bounds(this));
+        if (layout->damaged)
+            damage.Drawn(layout->screenBounds);
+        layout->damaged = false;
+        screenBounds |= layout->screenBounds;
+        return;
+    }
+
+    if (dynamic_cast<ModuleRenderer *>(child))
+        screenBounds |= DamageRegion::Viewport();
+    else if (!dynamic_cast<Attribute *>(child))
+        damage.Project(screenBounds, child->Bounds(this));
+    child->Draw(this);
+}
+
+
+void Layout::DrawChild(Drawing *child, bool bounds, DrawBatch *batch)
+// ----------------------------------------------------------------------------
+//   Draw a child, or add it to the batch of its siblings
+// ----------------------------------------------------------------------------
+//   Pending siblings are drawn first if the child can't be batched, so that
+//   drawings remain in document order.
+{
+    if (batch)
+    {
+        if (child->Batch(this, *batch))
+        {
+            if (bounds)
+                display->damageRegion().Project(screenBounds,
+                                                child->Bounds(this));
+            return;
+        }
+        batch->Flush();
+    }
+
+    if (bounds)
+        DrawWithBounds(child);
+    else
+        child->Draw(this);
+}
+
+
+bool Layout::CachedBounds(Box3 &bounds)
+// ----------------------------------------------------------------------------
+//   Return the bounds computed the last time we were drawn, if still valid
+// ----------------------------------------------------------------------------
+//   The bounds are in the coordinates of the layout we are drawn in.
+//   Layouts that do not draw their children directly in these coordinates
+//   (e.g. anchors or text flows) override this to return false.
+{
+    if (!boundsCached)
+        return false;
+    bounds = cachedBounds;
+    return true;
+}
+
+
+bool Layout::ChildBounds(Drawing *child, Box3 &bounds)
+// ----------------------------------------------------------------------------
+//   Return the bounds of a child in current coordinates, if cheaply known
+// ----------------------------------------------------------------------------
+//   Only shapes that keep their bounding box are asked. Other drawings,
+//   e.g. text or modules, may draw anywhere and are never culled.
+{
+    if (Layout *layout = dynamic_cast<Layout *>(child))
+        return layout->cachedOffset == Offset() && layout->CachedBounds(bounds);
+
+    if (dynamic_cast<Rectangle *>(child) ||
+        dynamic_cast<Cube *>(child) ||
+        dynamic_cast<GraphicPath *>(child))
+    {
+        bounds = child->Bounds(this);
+
+        // Account for outlines and extrusion, which are not in the bounds
+        coord depth = extrudeDepth + extrudeRadius;
+        Vector3 margin(lineWidth, lineWidth, lineWidth + depth);
+        bounds.lower -= margin;
+        bounds.upper += margin;
+        return true;
+    }
+
+    return false;
+}
+
+
+DrawingArena *Layout::CurrentArena()
+// ----------------------------------------------------------------------------
+//   Return the arena of the layout being evaluated, if any
+// ----------------------------------------------------------------------------
+{
+    if (!XL::MAIN || !XL::MAIN->options.drawing_arenas)
+        return NULL;
+    Widget *widget = Widget::TaoExists();
+    if (!widget || !widget->layout)
+        return NULL;
+    return &widget->layout->arena;
+}
+
+
 void Layout::DrawSelection(Layout *where)
 // ----------------------------------------------------------------------------
 //   Draw the selection for the elements in the layout
@@ -623,6 +920,10 @@ bool Layout::Refresh(QEvent *e, double now, Layout *parent, QString dbg)
             IFTRACE(justify)
                 std::cerr << "--Layout::Refresh[" << this << "] clears \n";
 
+            // The area where we were drawn changes
+            widget->damageRegion().Add(screenBounds);
+            damaged = true;
+
             // Clear old contents of the layout, drop all children
             Clear();
 
@@ -664,6 +965,10 @@ bool Layout::Refresh(QEvent *e, double now, Layout *parent, QString dbg)
         // Forward event to all child layouts
         changed |= RefreshChildren(e, now, dbg);
     }
+
+    // Children that were refreshed may now be drawn elsewhere
+    if (changed)
+        boundsCached = false;
     IFTRACE(justify)
         std::cerr << "<-Layout::Refresh[" << this << "]  \n";
     IFTRACE(lfps)
@@ -952,7 +1257,7 @@ void Layout::Inherit(Layout *where)
 }
 
 
-void LayoutState::InheritState(LayoutState *where)
+void LayoutState::InheritState(const LayoutState *where)
 // ----------------------------------------------------------------------------
 //   Inherit state from some other layoutState except offset
 // ----------------------------------------------------------------------------
@@ -960,7 +1265,11 @@ void LayoutState::InheritState(LayoutState *where)
     // Inherit color and other parameters as initial values
     // Note that these may really impact what gets rendered,
     // e.g. transparent colors may cause shapes to be drawn or not
-    font             = where->font;
+    copies++;
+
+    // Fonts are shared, so this is usually the same font already
+    if (!font.isCopyOf(where->font))
+        font         = where->font;
     alongX           = where->alongX;
     alongY           = where->alongY;
     alongZ           = where->alongZ;
@@ -981,8 +1290,8 @@ void LayoutState::InheritState(LayoutState *where)
 
     programId        = where->programId;
 
+    // Shares the matrix, which is only copied if this state changes it
     model            = where->model;
-
 }
 
 
@@ -1091,6 +1400,7 @@ void StereoLayout::Draw(Layout *where)
 //   Draw only when the eye matches the given viewpoints
 // ----------------------------------------------------------------------------
 {
+    where->Display()->viewReplay().ViewDependent();
     if (Valid(where))
         Layout::Draw(where);
 }
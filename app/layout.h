@@ -49,10 +49,12 @@
 #include "texture_cache.h"
 #include "matrix.h"
 #include "opengl_state.h"
+#include "drawing_arena.h"
 #include <vector>
 #include <set>
 #include <QFont>
 #include <QEvent>
+#include <QSharedData>
 #include <float.h>
 
 
@@ -60,13 +62,26 @@ TAO_BEGIN
 struct Widget;
 struct Layout;
 
+struct LayoutModel : QSharedData
+// ----------------------------------------------------------------------------
+//   The model matrix of a layout state, shared until one layout changes it
+// ----------------------------------------------------------------------------
+{
+    Matrix4             matrix;
+};
+
+
 struct LayoutState
 // ----------------------------------------------------------------------------
 //   The state we want to preserve in a layout
 // ----------------------------------------------------------------------------
+//   The model matrix is only changed by transforms in a few layouts, but is
+//   large. It is shared between copies of the state, and copied the first
+//   time a layout changes it (see ChangeModel).
 {
                         LayoutState();
                         LayoutState(const LayoutState &o);
+    LayoutState &       operator=(const LayoutState &o);
 
 public:
     typedef std::set<int>                       qevent_ids;
@@ -75,8 +90,11 @@ public:
     void                ClearAttributes();
     static text         ToText(qevent_ids & ids);
     static text         ToText(int type);
-    void                InheritState(LayoutState *other);
+    void                InheritState(const LayoutState *other);
     void                toDebugString(std::ostream &out) const;
+    static void         ResetCounters()         { copies = 0; }
+    const Matrix4 &     Model() const   { return model.constData()->matrix; }
+    Matrix4 &           ChangeModel()   { return model->matrix; }
 
 public:
     Vector3             offset;
@@ -97,10 +115,18 @@ public:
     uint                programId;
 
     // Transformations
-    Matrix4             model;
+    QSharedDataPointer<LayoutModel> model;
+
+    // Selection and rendering passes
     bool                groupDrag       : 1;
     bool                transparency    : 1;
     bool                blendOrShade    : 1;
+
+    // Number of copies since last reset, reported per frame
+    static ulong        copies;
+
+    // Identity model matrix shared by default states
+    static QSharedDataPointer<LayoutModel> identity;
 };
 
 
@@ -161,6 +187,11 @@ public:
     virtual void        Inherit(Layout *other);
     void                PushLayout();
     void                PopLayout();
+    void                DrawWithBounds(Drawing *child);
+    void                DrawChild(Drawing *child, bool bounds,
+                                  DrawBatch *batch);
+    virtual bool        CachedBounds(Box3 &bounds);
+    bool                ChildBounds(Drawing *child, Box3 &bounds);
     uint                CharacterId();
     double              PrinterScaling();
     text                PrettyId();
@@ -170,6 +201,9 @@ public:
     // Used to optimize away texturing and programs if in Identify
     static bool         InIdentify()    { return inIdentify; }
 
+    // Memory for the drawings created while we are the current layout
+    static DrawingArena *CurrentArena();
+
 public:
     // OpenGL identification for that shape and for characters within
     uint                id;
@@ -187,12 +221,18 @@ protected:
     // Refresh dependencies
     LayoutNames         names; // Name(s) of this layout
     LayoutNames         deps;  // Layout(s) to refresh with this one
+    DrawingArena        arena; // Drawings created while evaluating us
 
 public:
     qevent_ids          refreshEvents;
     double              nextRefresh;
     Tree_p              body;
     Context_p           ctx;
+    Box                 screenBounds;   // Window area covered when drawn
+    bool                damaged;        // Refreshed since last drawn
+    Box3                cachedBounds;   // Area drawn, in parent coordinates
+    Vector3             cachedOffset;   // Offset inherited when drawn
+    bool                boundsCached;   // Bounds valid until cleared
 
 public:
     // Static attributes for polygon offset computation
@@ -50,6 +50,7 @@
 #include "window.h"
 #include "texture_cache.h"
 #include "file_monitor.h"
+#include "job_pool.h"
 
 TAO_BEGIN
 
@@ -158,6 +159,14 @@ ModuleApiPrivate::ModuleApiPrivate()
     currentPageTime = Widget::currentPageTimeAPI;
     DevicePixelRatio = Widget::DevicePixelRatioAPI;
     RenderingTransparency = Widget::RenderingTransparencyAPI;
+
+    invalidateFrame = Widget::invalidateFrameAPI;
+
+    drawViews = DisplayDriver::drawViews;
+
+    submitJob  = JobPool::SubmitJob;
+    cancelJob  = JobPool::CancelJob;
+    cancelJobs = JobPool::CancelJobs;
 }
 
 TAO_END
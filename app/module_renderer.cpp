@@ -148,7 +148,7 @@ Matrix4 ModuleRenderer::ModelMatrix()
 //   Module interface for currentModelMatrix
 // ----------------------------------------------------------------------------
 {
-    return Widget::Tao()->layout->model;
+    return Widget::Tao()->layout->Model();
 }
 
 
@@ -159,6 +159,9 @@ void ModuleRenderer::Draw(Layout *where)
 {
     record(module_renderer, "Draw [%p] in layout %p", this, where);
 
+    // Modules may draw differently for each viewpoint, or outside of GL
+    where->Display()->viewReplay().ViewDependent();
+
     // Synchronise GL states
     GL.Sync();
 
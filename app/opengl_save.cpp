@@ -39,8 +39,201 @@
 
 TAO_BEGIN
 
-// Declare all the stacks we use
-#define GS(type, name)          OpenGLChanges<type> OpenGLSave::name##_changes;
+// The undo log shared by all save levels
+OpenGLUndoLog OpenGLSave::log;
+
+
+OpenGLUndoLog::~OpenGLUndoLog()
+// ----------------------------------------------------------------------------
+//   Release the blocks of the log
+// ----------------------------------------------------------------------------
+{
+    for (uint i = 0; i < blocks.size(); i++)
+        qFreeAligned(blocks[i]);
+}
+
+
+bool OpenGLUndoLog::Find(size_t mark, uint state, uint index)
+// ----------------------------------------------------------------------------
+//   Check if we already have a record for the state since given mark
+// ----------------------------------------------------------------------------
+//   Only works for keyed records, which are indexed by (state, index)
+{
+    size_t last = keys.Get(Key(state, index));
+    return last && last - 1 >= mark;
+}
+
+
+size_t &OpenGLUndoLog::Index::Set(uint64 key)
+// ----------------------------------------------------------------------------
+//   Return the entry for the key, creating it with value 0 if necessary
+// ----------------------------------------------------------------------------
+//   The caller must store a non-zero value in a newly created entry
+{
+    if (slots.size())
+    {
+        uint s = Lookup(key);
+        if (slots[s].last)
+            return slots[s].last;
+    }
+    if (2 * (used + 1) > slots.size())
+        Grow();
+    uint s = Lookup(key);
+    slots[s].key = key;
+    used++;
+    return slots[s].last;
+}
+
+
+void OpenGLUndoLog::Index::Erase(uint64 key)
+// ----------------------------------------------------------------------------
+//   Remove the key, shifting back the entries that follow it
+// ----------------------------------------------------------------------------
+{
+    if (!slots.size())
+        return;
+    uint mask = slots.size() - 1;
+    uint hole = Lookup(key);
+    if (!slots[hole].last)
+        return;
+    slots[hole].last = 0;
+    used--;
+
+    // Move back any following entry that cannot be found past the hole
+    for (uint s = (hole + 1) & mask; slots[s].last; s = (s + 1) & mask)
+    {
+        uint home = Hash(slots[s].key) & mask;
+        bool stays = hole <= s
+            ? (hole < home && home <= s)
+            : (hole < home || home <= s);
+        if (stays)
+            continue;
+        slots[hole] = slots[s];
+        slots[s].last = 0;
+        hole = s;
+    }
+}
+
+
+void OpenGLUndoLog::Index::Grow()
+// ----------------------------------------------------------------------------
+//   Double the number of slots and reinsert existing entries
+// ----------------------------------------------------------------------------
+{
+    std::vector<Slot> old;
+    old.swap(slots);
+    Slot free = { 0, 0 };
+    slots.resize(old.size() ? 2 * old.size() : 64, free);
+    for (uint i = 0; i < old.size(); i++)
+    {
+        if (old[i].last)
+        {
+            uint s = Lookup(old[i].key);
+            slots[s] = old[i];
+        }
+    }
+}
+
+
+void OpenGLUndoLog::NextBlock()
+// ----------------------------------------------------------------------------
+//   Move the top of the log to the beginning of the next block
+// ----------------------------------------------------------------------------
+{
+    size_t block = (top - 1) / BLOCK_SIZE;
+    if (ends.size() <= block)
+        ends.resize(block + 1);
+    ends[block] = top;
+    top = (block + 1) * BLOCK_SIZE;
+}
+
+
+template <class Element, class State>
+void OpenGLUndoLog::RestoreElement(State &state,
+                                   std::vector<Element> &elements,
+                                   Record &record)
+// ----------------------------------------------------------------------------
+//   Restore one element in a collection of states
+// ----------------------------------------------------------------------------
+{
+    uint index = record.index;
+    ElementChange<Element> &change = Pop< ElementChange<Element> >(record);
+    if (change.count < elements.size())
+        elements.resize(change.count);
+    if (index < change.count)
+        elements[index] = change.value;
+    state.active = change.active;
+    state.dirty |= 1ULL << index;
+    Discard(change);
+}
+
+
+void OpenGLUndoLog::Restore(OpenGLState *gs, size_t mark)
+// ----------------------------------------------------------------------------
+//   Replay the log backwards down to the given mark
+// ----------------------------------------------------------------------------
+{
+    while (top > mark)
+    {
+        Record &record = Last();
+        switch(record.state)
+        {
+#define GS(type, name)                                          \
+        case STATE_BIT_##name:                                  \
+        {                                                       \
+            type &value = Pop<type>(record);                    \
+            gs->name = value;                                   \
+            gs->name##_isDirty = true;                          \
+            Discard(value);                                     \
+            break;                                              \
+        }
+// The following are necessary because we can't reference bitfields
+#define GBITFIELD(name)                                         \
+        case STATE_BIT_##name:                                  \
+            gs->name = Pop<bool>(record);                       \
+            gs->name##_isDirty = true;                          \
+            break;
+#define GFLAG(name)             GBITFIELD(glflag_##name)
+#define GCLIENTSTATE(name)      GBITFIELD(glclientstate_##name)
+#define GCOLLECTION(type, name)
 #include "opengl_state.tbl"
+#undef GBITFIELD
+
+        case STATE_BIT_textures:
+        {
+            GLuint id = record.index;
+            TextureState &tex = Pop<TextureState>(record);
+            TextureState &ntex = gs->textures.textures[id];
+            tex.mipMap = ntex.mipMap; // Mipmap is the only setting not restored
+            ntex = tex;
+            Discard(tex);
+            gs->textures.dirty.insert(id);
+            gs->textures_isDirty = true;
+            break;
+        }
+        case STATE_BIT_textureUnits:
+            RestoreElement(gs->textureUnits, gs->textureUnits.units, record);
+            gs->textureUnits_isDirty = true;
+            break;
+        case STATE_BIT_clientTextureUnits:
+            RestoreElement(gs->clientTextureUnits,
+                           gs->clientTextureUnits.units, record);
+            gs->clientTextureUnits_isDirty = true;
+            break;
+        case STATE_BIT_lights:
+            RestoreElement(gs->lights, gs->lights.lights, record);
+            gs->lights_isDirty = true;
+            break;
+        case STATE_BIT_clipPlanes:
+            RestoreElement(gs->clipPlanes, gs->clipPlanes.planes, record);
+            gs->clipPlanes_isDirty = true;
+            break;
+        default:
+            XL_ASSERT(!"Invalid state in OpenGL undo log");
+            top = mark;
+            break;
+        }
+    }
+}
 
 TAO_END
@@ -44,106 +44,168 @@ TAO_BEGIN
 
 // ============================================================================
 //
-//    Class recording individual changes in the OpenGL state
+//    Undo log recording individual changes in the OpenGL state
 //
 // ============================================================================
 
-template <class State>
-struct OpenGLChanges
+struct OpenGLUndoLog
 // ----------------------------------------------------------------------------
-//   A recording of the changes for a given state type
+//   A single contiguous log of (state id, old value) records
 // ----------------------------------------------------------------------------
-//   This class records how a given value changes over time.
+//   All save levels share a single log. Each OpenGLSave remembers the top of
+//   the log when it was created, and restoring it simply replays the records
+//   pushed since then in reverse order. The cost of a restore is therefore
+//   proportional to what actually changed, not to the size of the state.
 //
-//   The default implementation shown here simply creates a stack of values,
-//   where the top of the stack is the last value to restore in the graphics
-//   state. This implementation is efficient for small states, e.g. colors,
-//   or for "atomic" states, e.g. matrices.
+//   For collections like textures, texture units or lights, we do not record
+//   the whole collection, only the element that changes ("deltas"). If we have
+//   200 textures active, and we change the state of texture 103, the log will
+//   only contain the old state of texture 103.
 //
-//   For more complex states like texture changes, it is more efficient to
-//   record changes as "deltas", in which case we will use a specialization
-//   of this class. If we have 200 textures active, and we change the state
-//   of texture 103, teh 'change_type' will only contain changes for texture
-//   103, not changes for any other texture, saving both memory and CPU time.
+//   The log is stored in fixed-size blocks that never move once allocated.
+//   Values are constructed in place with their natural alignment, so that
+//   saved states with non-trivial members (e.g. SIMD matrices) are never
+//   copied byte by byte when the log grows. Keyed records (textures) are also
+//   indexed by (state, index), so that checking if an element was already
+//   saved at the current level does not require walking the log.
+//
+//   The storage is never released, so that once we reached the maximum depth
+//   for a given document, saving and restoring no longer allocates memory.
 {
-    // By default, we record a change as a state
-    typedef State               change_type;
-
-    // By default, we record changes with a vector containing old values
-    typedef std::vector<State>  changes_type;
-    changes_type                changes;
-
-public:
-    // Default 'save' function records a change
-    inline bool save(const change_type &change, bool alreadySaved)
+    struct Record
+    // ------------------------------------------------------------------------
+    //   Trailer for each record, allows walking the log backwards
+    // ------------------------------------------------------------------------
     {
-        if (!alreadySaved)
-            changes.push_back(change);
-        return true;
-    }
-
-    // Default 'restore' function reverts old state, returns true if dirty
-    inline bool restore(State &state)
+        uint32  state;          // StateBits value for the saved state
+        uint32  index;          // Element index or texture ID in collections
+        uint32  size;           // Aligned size of the saved value
+        uint32  keyed;          // Record is in the (state, index) index
+        size_t  previous;       // Previous position for the same key
+    };
+
+    struct Index
+    // ------------------------------------------------------------------------
+    //   Open-addressed table of the last position + 1 of keyed records
+    // ------------------------------------------------------------------------
+    //   Linear probing with backward-shift deletion, so there are no
+    //   tombstones and popped slots are immediately reusable. The table
+    //   only grows when it becomes half full.
     {
-        state = changes.back();
-        changes.pop_back();
-        return true;
-    }
-};
+        struct Slot
+        {
+            uint64      key;
+            size_t      last;           // 0 if the slot is free
+        };
+        Index(): slots(), used(0) {}
 
+        size_t          Get(uint64 key)
+        {
+            return slots.size() ? slots[Lookup(key)].last : 0;
+        }
+        size_t &        Set(uint64 key);
+        void            Erase(uint64 key);
 
-template<>
-struct OpenGLChanges<TexturesState>
-// ----------------------------------------------------------------------------
-//    For texture states, we only record textures that changed
-// ----------------------------------------------------------------------------
-{
-    // By default, we record a change as a state
-    typedef TextureState                change_type;
+    private:
+        static uint     Hash(uint64 key)
+        {
+            return uint((key * 0x9E3779B97F4A7C15ULL) >> 32);
+        }
+        uint            Lookup(uint64 key)
+        {
+            uint mask = slots.size() - 1;
+            uint s = Hash(key) & mask;
+            while (slots[s].last && slots[s].key != key)
+                s = (s + 1) & mask;
+            return s;
+        }
+        void            Grow();
 
-    // By default, we record changes with a vector containing old values
-    typedef std::vector<TexturesState>  changes_type;
-    changes_type                        changes;
+        std::vector<Slot> slots;        // Power of two number of slots
+        uint              used;         // Number of slots in use
+    };
+
+    template <class Element>
+    struct ElementChange
+    // ------------------------------------------------------------------------
+    //   The old value of one element in a collection of states
+    // ------------------------------------------------------------------------
+    {
+        ElementChange(uint64 active, uint count, const Element &value)
+            : active(active), count(count), value(value) {}
+        uint64  active;         // Old mask of active elements
+        uint    count;          // Old number of elements in the collection
+        Element value;          // Old value (if index < count)
+    };
 
 public:
-    // Record a texture change
-    inline bool save(const change_type &tex, bool alreadySaved)
+    OpenGLUndoLog(): blocks(), ends(), top(0), keys(),
+                     levels(0), saved(0), restored(0), bytes(0) {}
+    ~OpenGLUndoLog();
+
+    size_t              Top()                   { return top; }
+    template <class T>
+    void                Save(uint state, uint index, const T &value,
+                             bool keyed = false);
+    bool                Find(size_t mark, uint state, uint index);
+    void                Restore(OpenGLState *gs, size_t mark);
+    void                ResetCounters()
     {
-        if (!alreadySaved)
-        {
-            // First time we save a texture on this stack level:
-            // create save area
-            TexturesState empty;
-            changes.push_back(empty);
-        }
+        levels = saved = restored = bytes = 0;
+    }
 
-        // Already have a valid state on the top of the stack, update it
-        // but only if we didn't already save that texture at this level
-        TexturesState &ts = changes.back();
-        if (ts.textures.count(tex.id) == 0)
-            ts.textures[tex.id] = tex;
+private:
+    enum
+    {
+        BLOCK_SIZE      = 64 * 1024,    // Size of a block in the log
+        ALIGNMENT       = 16,           // Alignment of all values in the log
+        RECORD_SIZE     = (sizeof(Record) + ALIGNMENT-1) & ~(ALIGNMENT-1)
+    };
 
-        return true;
+    static uint64       Key(uint state, uint index)
+    {
+        return (uint64(state) << 32) | index;
     }
-
-    // Restore a texture change
-    inline bool restore(TexturesState &state)
+    static size_t       Aligned(size_t size)
     {
-        TexturesState &saved = changes.back();
-        TexturesState::texture_map &texs = saved.textures;
-        TexturesState::texture_map::iterator it;
-        for (it = texs.begin(); it != texs.end(); it++)
-        {
-            GLuint id = (*it).first;
-            TextureState &tex  = (*it).second;
-            TextureState &ntex = state.textures[id];
-            tex.mipMap = ntex.mipMap; // Mipmap is the only setting not restored
-            ntex = tex;
-            state.dirty.insert(id);
-        }
-        changes.pop_back();
-        return true;
+        return (size + ALIGNMENT - 1) & ~size_t(ALIGNMENT - 1);
+    }
+    char *              Address(size_t pos)
+    {
+        return blocks[pos / BLOCK_SIZE] + pos % BLOCK_SIZE;
+    }
+    size_t              End(size_t pos)
+    {
+        // At the start of a block, the last record is in the previous one
+        if (pos && pos % BLOCK_SIZE == 0)
+            pos = ends[pos / BLOCK_SIZE - 1];
+        return pos;
     }
+    void                NextBlock();
+    template <class T>
+    T &                 Pop(Record &record);
+    template <class T>
+    static void         Discard(T &value)       { value.~T(); }
+    Record &            Last()
+    {
+        return *((Record *) Address(End(top) - RECORD_SIZE));
+    }
+    template <class Element, class State>
+    void                RestoreElement(State &state,
+                                       std::vector<Element> &elements,
+                                       Record &record);
+
+    std::vector<char *> blocks;         // Blocks of BLOCK_SIZE bytes
+    std::vector<size_t> ends;           // End of the records in each block
+    size_t              top;            // Position of the top of the log
+    Index               keys;           // Last position + 1 of keyed records
+
+public:
+    // Counters for the statistics overlay, reset on each frame
+    ulong               levels;         // Number of save levels created
+    ulong               saved;          // Number of state records saved
+    ulong               restored;       // Number of state records restored
+    ulong               bytes;          // Bytes copied while saving/restoring
 };
 
 
@@ -168,13 +230,25 @@ public:
 
 public:
 #define GS(type, name)                                                  \
-    inline void save_##name(const OpenGLChanges<type>::change_type &c)  \
+    inline void save_##name(const type &value)                          \
     {                                                                   \
-        if (saving_##name)                                              \
-            saved_##name = name##_changes.save(c, saved_##name);        \
+        if (saving_##name && !saved_##name)                             \
+        {                                                               \
+            saved_##name = true;                                        \
+            log.Save(STATE_BIT_##name, 0, value);                       \
+        }                                                               \
     }
+#define GCOLLECTION(type, name)
 #include "opengl_state.tbl"
 
+    // Collections only record the element being changed
+    void save_textures(const TextureState &texture);
+    void save_textureUnits(const TextureUnitsState &units, uint index);
+    void save_clientTextureUnits(const ClientTextureUnitsState &units,
+                                 uint index);
+    void save_lights(const LightsState &lights, uint index);
+    void save_clipPlanes(const ClipPlanesState &planes, uint index);
+
 public:
     OpenGLState *gs;
 #define GS(type, name)                          \
@@ -182,10 +256,13 @@ public:
     bool saving_##name:1;
 #include "opengl_state.tbl"
     OpenGLSave *oldSave;
+    size_t      mark;                   // Top of the undo log at creation
+    uint64      savedTextureUnits;      // Elements already saved at level
+    uint64      savedClientTextureUnits;
+    uint64      savedLights;
+    uint64      savedClipPlanes;
 
-#define GS(type, name)                          \
-    static OpenGLChanges<type> name##_changes;
-#include "opengl_state.tbl"
+    static OpenGLUndoLog log;
 };
 
 
@@ -196,6 +273,69 @@ public:
 //
 // ============================================================================
 
+template <class T>
+inline void OpenGLUndoLog::Save(uint state, uint index, const T &value,
+                                bool keyed)
+// ----------------------------------------------------------------------------
+//   Push the old value of some state on the log
+// ----------------------------------------------------------------------------
+{
+    size_t size = Aligned(sizeof(T));
+    XL_ASSERT(size + RECORD_SIZE <= BLOCK_SIZE);
+    if (top % BLOCK_SIZE + size + RECORD_SIZE > BLOCK_SIZE)
+        NextBlock();
+    if (top / BLOCK_SIZE >= blocks.size())
+        blocks.push_back((char *) qMallocAligned(BLOCK_SIZE, ALIGNMENT));
+
+    size_t pos = top;
+    new((void *) Address(pos)) T(value);
+    top += size;
+
+    Record &record = *((Record *) Address(top));
+    record.state = state;
+    record.index = index;
+    record.size = size;
+    record.keyed = keyed;
+    record.previous = ~size_t(0);
+    if (keyed)
+    {
+        size_t &last = keys.Set(Key(state, index));
+        if (last)
+            record.previous = last - 1;
+        last = pos + 1;
+    }
+    top += RECORD_SIZE;
+    if (top % BLOCK_SIZE == 0)
+        NextBlock();
+
+    saved++;
+    bytes += sizeof(T);
+}
+
+
+template <class T>
+inline T &OpenGLUndoLog::Pop(Record &record)
+// ----------------------------------------------------------------------------
+//   Pop the value associated to the last record from the log
+// ----------------------------------------------------------------------------
+//   The returned reference remains valid until the next Save
+{
+    size_t pos = End(top) - RECORD_SIZE - record.size;
+    top = End(pos);             // Never leave top at the start of a block
+    if (record.keyed)
+    {
+        uint64 key = Key(record.state, record.index);
+        if (record.previous == ~size_t(0))
+            keys.Erase(key);
+        else
+            keys.Set(key) = record.previous + 1;
+    }
+    restored++;
+    bytes += sizeof(T);
+    return *((T *) Address(pos));
+}
+
+
 inline OpenGLSave::OpenGLSave(OpenGLState *gs)
 // ----------------------------------------------------------------------------
 //   Prepare to save the state
@@ -204,9 +344,12 @@ inline OpenGLSave::OpenGLSave(OpenGLState *gs)
     : gs(gs ? gs : gs = ((OpenGLState *) &GL)),
 #define GS(type, name)  saved_##name(false), saving_##name(true),
 #include "opengl_state.tbl"
-      oldSave(gs->save)
+      oldSave(gs->save), mark(log.Top()),
+      savedTextureUnits(0), savedClientTextureUnits(0),
+      savedLights(0), savedClipPlanes(0)
 {
     gs->save = this;
+    log.levels++;
 }
 
 
@@ -220,36 +363,100 @@ inline OpenGLSave::OpenGLSave(uint64 flags, OpenGLState *gs)
       saved_##name(false),                      \
       saving_##name(flags & STATE_##name),
 #include "opengl_state.tbl"
-      oldSave(gs->save)
+      oldSave(gs->save), mark(log.Top()),
+      savedTextureUnits(0), savedClientTextureUnits(0),
+      savedLights(0), savedClipPlanes(0)
 {
     gs->save = this;
+    log.levels++;
 }
 
 
 inline OpenGLSave::~OpenGLSave()
 // ----------------------------------------------------------------------------
-//   Restore what needs to be saved
+//   Restore what was recorded since this save level was created
 // ----------------------------------------------------------------------------
 {
-#define GS(type, name)                                          \
-    if (saved_##name)                                           \
-        gs->name##_isDirty = name##_changes.restore(gs->name);
-// The following two are necessary because we can't reference bitfields
-#define GBITFIELD(name)                                         \
-    if (saved_##name)                                           \
-    {                                                           \
-        bool tmp = gs->name;                                    \
-        gs->name##_isDirty = name##_changes.restore(tmp);       \
-        gs->name = tmp;                                         \
+    if (log.Top() != mark)
+        log.Restore(gs, mark);
+    gs->save = oldSave;
+}
+
+
+inline void OpenGLSave::save_textures(const TextureState &texture)
+// ----------------------------------------------------------------------------
+//   Record the old state of a single texture, once per save level
+// ----------------------------------------------------------------------------
+{
+    if (saving_textures && !log.Find(mark, STATE_BIT_textures, texture.id))
+    {
+        saved_textures = true;
+        log.Save(STATE_BIT_textures, texture.id, texture, true);
     }
-#define GFLAG(name)             GBITFIELD(glflag_##name)
-#define GCLIENTSTATE(name)      GBITFIELD(glclientstate_##name)
-#include "opengl_state.tbl"
-#undef GBITFIELD
+}
 
-    gs->save = oldSave;
+
+// Record the old state of an element in a collection, once per save level
+#define SAVE_ELEMENT(name, Element, mask, coll, elems, index)           \
+    do                                                                  \
+    {                                                                   \
+        uint64 bit = 1ULL << index;                                     \
+        if (saving_##name && !(mask & bit))                             \
+        {                                                               \
+            mask |= bit;                                                \
+            saved_##name = true;                                        \
+            uint count = coll.elems.size();                             \
+            log.Save(STATE_BIT_##name, index,                           \
+                     OpenGLUndoLog::ElementChange<Element>(             \
+                         coll.active, count,                            \
+                         index < count ? coll.elems[index] : Element()));\
+        }                                                               \
+    } while(0)
+
+
+inline void OpenGLSave::save_textureUnits(const TextureUnitsState &units,
+                                          uint index)
+// ----------------------------------------------------------------------------
+//   Record the old state of a texture unit
+// ----------------------------------------------------------------------------
+{
+    SAVE_ELEMENT(textureUnits, TextureUnitState,
+                 savedTextureUnits, units, units, index);
+}
+
+
+inline void OpenGLSave::save_clientTextureUnits(const ClientTextureUnitsState &u,
+                                                uint index)
+// ----------------------------------------------------------------------------
+//   Record the old state of a client texture unit
+// ----------------------------------------------------------------------------
+{
+    SAVE_ELEMENT(clientTextureUnits, ClientTextureUnitState,
+                 savedClientTextureUnits, u, units, index);
 }
 
+
+inline void OpenGLSave::save_lights(const LightsState &lights, uint index)
+// ----------------------------------------------------------------------------
+//   Record the old state of a light
+// ----------------------------------------------------------------------------
+{
+    SAVE_ELEMENT(lights, LightState, savedLights, lights, lights, index);
+}
+
+
+inline void OpenGLSave::save_clipPlanes(const ClipPlanesState &planes,
+                                        uint index)
+// ----------------------------------------------------------------------------
+//   Record the old state of a clip plane
+// ----------------------------------------------------------------------------
+{
+    SAVE_ELEMENT(clipPlanes, ClipPlaneState,
+                 savedClipPlanes, planes, planes, index);
+}
+
+#undef SAVE_ELEMENT
+
 TAO_END
 
 #endif // GRAPHIC_SAVE
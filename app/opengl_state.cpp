@@ -45,6 +45,7 @@
 #include "opengl_state.h"
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
 #include "opengl_save.h"
@@ -93,6 +94,14 @@ text OpenGLState::vendorsList[LAST_VENDOR] =
     } while (0)
 
 
+#define SAVE_ELEMENT(name, index)               \
+    do                                          \
+    {                                           \
+        if (save)                               \
+            save->save_##name(name, index);     \
+    } while (0)
+
+
 #define CHANGE_MATRIX(Code)                             \
     do                                                  \
     {                                                   \
@@ -143,10 +152,11 @@ OpenGLState::OpenGLState()
       renderer("Random Bits Pusher"),
       version("Unreleased Internal version pi"),
       extensionsAvailable("None"),
-      polycount(0),
+      polycount(0), drawCalls(0), streamedBytes(0),
 
       matrixMode(GL_MODELVIEW),
-      viewport(0, 0, 0, 0), listBase(0), pointSize(1),
+      viewport(0, 0, 0, 0), scissor(0, 0, 0, 0),
+      listBase(0), pointSize(1),
       polygonOffset(0, 0), color(1,1,1,1), clearColor(-1,-1,-1,-1),
       frontAmbient(0.2,0.2,0.2,1.0), frontDiffuse(0.8,0.8,0.8,1.0),
       frontSpecular(0,0,0,1), frontEmission(0,0,0,1), frontShininess(0),
@@ -167,15 +177,29 @@ OpenGLState::OpenGLState()
 #define GFLAG(name)             glflag_##name(false),
 #define GCLIENTSTATE(name)      glclientstate_##name(false),
 #include "opengl_state.tbl"
-      save(NULL)
-{}
+      save(NULL),
+      streamMode(STREAM_UNKNOWN), streamBuffer(0),
+      streamChunk(0), streamChunks(0), streamOffset(0),
+      streamMapped(false), streamNormals(false), streamUnits(0),
+      streamClient()
+{
+    memset(streamFences, 0, sizeof(streamFences));
+}
 
 
 OpenGLState::~OpenGLState()
 // ----------------------------------------------------------------------------
-//    Destructor
+//    Destructor, releases the streaming buffer and its fences
 // ----------------------------------------------------------------------------
-{}
+{
+    if (!streamBuffer)
+        return;
+
+    for (uint c = 0; c < STREAM_CHUNKS; c++)
+        if (streamFences[c])
+            glDeleteSync(streamFences[c]);
+    DeleteBuffers(1, &streamBuffer);
+}
 
 
 void OpenGLState::MakeCurrent()
@@ -380,6 +404,8 @@ void OpenGLState::Sync(uint64 which)
          glDrawBuffer(bufferMode));
     SYNC(viewport,
          glViewport(viewport.x, viewport.y, viewport.w, viewport.h));
+    SYNC(scissor,
+         glScissor(scissor.x, scissor.y, scissor.w, scissor.h));
     SYNC(pointSize,
          glPointSize(pointSize));
     SYNC(polygonOffset,
@@ -567,90 +593,29 @@ void OpenGLState::LoadIdentity()
 
 void OpenGLState::MultMatrices(const coord *m1, const coord *m2, coord *result)
 // ----------------------------------------------------------------------------
-//    Multiply two 4x4 matrices (source: glu)
+//    Multiply two 4x4 matrices (same order as glu, i.e. result = m2 * m1)
 // ----------------------------------------------------------------------------
 {
-    for (int i= 0; i < 4; i++)
-        for (int j = 0; j < 4; j++)
-            result[i * 4 + j] = m1[i * 4 + 0] * m2[0 * 4 + j] +
-                                m1[i * 4 + 1] * m2[1 * 4 + j] +
-                                m1[i * 4 + 2] * m2[2 * 4 + j] +
-                                m1[i * 4 + 3] * m2[3 * 4 + j];
+    MatrixMultiply(m2, m1, result);
 }
 
 
 void OpenGLState::MultMatrixVec(const coord matrix[16], const coord in[4],
                                  coord out[4])
 // ----------------------------------------------------------------------------
-//    Multiply a matrix by a vector (source: glu)
+//    Multiply a matrix by a vector
 // ----------------------------------------------------------------------------
 {
-    for (int i = 0; i < 4; i++)
-        out[i] = in[0] * matrix[0 * 4 + i] +
-                 in[1] * matrix[1 * 4 + i] +
-                 in[2] * matrix[2 * 4 + i] +
-                 in[3] * matrix[3 * 4 + i];
+    MatrixMultiplyVector(matrix, in, out);
 }
 
 
 bool OpenGLState::InvertMatrix(const GLdouble m[16], GLdouble invOut[16])
 // ----------------------------------------------------------------------------
-//    Compute inverse of a matrix (source: glu)
-// ----------------------------------------------------------------------------
-{
-    double inv[16], det;
-    int i;
-
-    // First column
-    inv[0] =    m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15]
-              + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
-    inv[1] =  - m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15]
-              - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
-    inv[2] =    m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15]
-              + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
-    inv[3] =  - m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11]
-              - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
-
-    // Second column
-    inv[4] =  - m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15]
-              - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
-    inv[5] =    m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15]
-              + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
-    inv[6] =  - m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15]
-              - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
-    inv[7] =    m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11]
-              + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
-
-    // Third column
-    inv[8] =    m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15]
-              + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
-    inv[9] =  - m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15]
-              - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
-    inv[10] =   m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15]
-              + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
-    inv[11] = - m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11]
-              - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
-
-    // Fourht column
-    inv[12] = - m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14]
-              - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
-    inv[13] =   m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14]
-              + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
-    inv[14] = - m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14]
-              - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
-    inv[15] =   m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10]
-              + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
-
-    // Compute determinant
-    det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
-    if (det == 0)
-        return false;
-
-    det = 1.0 / det;
-    for (i = 0; i < 16; i++)
-        invOut[i] = inv[i] * det;
-
-    return true;
+//    Compute inverse of a matrix, return false if it is not invertible
+// ----------------------------------------------------------------------------
+{
+    return MatrixInvert(m, invOut);
 }
 
 
@@ -1153,15 +1118,16 @@ ClientTextureUnitState &OpenGLState::ClientActiveTexture()
      XL_ASSERT(clientActiveTexture >= GL_TEXTURE0);
      XL_ASSERT(clientActiveTexture < GL_TEXTURE0+MAX_TEXTURE_COORDS);
      uint at = clientActiveTexture - GL_TEXTURE0;
+
+     // Save client texture unit state on the state stack
+     if (save)
+         save->save_clientTextureUnits(clientTextureUnits, at);
+     clientTextureUnits_isDirty = true;
+
      if (at >= clientTextureUnits.units.size())
          clientTextureUnits.units.resize(at + 1);
      clientTextureUnits.dirty |=  1ULL << at;
 
-     // Save clint texture unit state on the state stack
-     clientTextureUnits_isDirty = true;
-     if (save)
-         save->save_clientTextureUnits(clientTextureUnits);
-
      return clientTextureUnits.units[at];
 }
 
@@ -1172,6 +1138,7 @@ void OpenGLState::DrawElements(GLenum  mode, int count, GLenum type, const GLvoi
 // ----------------------------------------------------------------------------
 {
     Sync();
+    drawCalls++;
     glDrawElements(mode, count, type, indices);
 }
 
@@ -1183,6 +1150,7 @@ void OpenGLState::DrawArrays(GLenum mode, int first, int count)
 {
     Sync();
     polycount += count * (1 + (mode == GL_QUADS));
+    drawCalls++;
     glDrawArrays(mode, first, count);
 }
 
@@ -1334,6 +1302,16 @@ void OpenGLState::Viewport(int x, int y, int w, int h)
 }
 
 
+void OpenGLState::Scissor(int x, int y, int w, int h)
+// ----------------------------------------------------------------------------
+//    Set the scissor box, used when GL_SCISSOR_TEST is enabled
+// ----------------------------------------------------------------------------
+{
+    ViewportState newScissor(x, y, w, h);
+    CHANGE(scissor, newScissor);
+}
+
+
 void OpenGLState::RasterPos(coord x, coord y, coord z, coord w)
 // ----------------------------------------------------------------------------
 //    Specify the raster position in window coordinates for pixel operations
@@ -2180,7 +2158,7 @@ TextureUnitState &OpenGLState::ActiveTextureUnitState(bool isDirty)
         // Save texture unit state on the state stack
         textureUnits_isDirty = true;
         if (save)
-            save->save_textureUnits(textureUnits);
+            save->save_textureUnits(textureUnits, at);
     }
 
     if (at >= textureUnits.units.size())
@@ -2637,7 +2615,7 @@ void OpenGLState::SetLight(GLenum light, bool active)
         uint id = light - GL_LIGHT0;
 
         lights.dirty |= 1ULL << id;
-        SAVE(lights);
+        SAVE_ELEMENT(lights, id);
         lights_isDirty = true;
 
         if (id >= lights.lights.size())
@@ -2688,7 +2666,7 @@ void OpenGLState::Light(GLenum light, GLenum pname, const float* params)
     }
     LightState &ls = lights.lights[id];
     lights.dirty |= 1ULL << id;
-    SAVE(lights);
+    SAVE_ELEMENT(lights, id);
     lights_isDirty = true;
 
     switch(pname)
@@ -2933,7 +2911,7 @@ ClipPlaneState &OpenGLState::ClipPlane(GLenum plane)
 
     // Save old state and mark it as dirty
     clipPlanes.dirty |= 1ULL << id;
-    SAVE(clipPlanes);
+    SAVE_ELEMENT(clipPlanes, id);
     clipPlanes_isDirty = true;
 
     if (id >= clipPlanes.planes.size())
@@ -3746,6 +3724,248 @@ void OpenGLState::UnmapBuffer(GLenum target)
 }
 
 
+// ============================================================================
+//
+//    Vertex streaming
+//
+// ============================================================================
+//   Shapes computed on the CPU at each frame used to be drawn from double
+//   arrays in client memory, which the driver must copy and convert at each
+//   draw call. StreamArrays packs them as interleaved floats, written into a
+//   ring of chunks in a vertex buffer that is mapped without synchronization.
+//   A fence is placed on each chunk when we move to the next one, and waited
+//   for before the chunk is reused. Without sync objects, or if one frame
+//   goes through the whole ring, the buffer is orphaned instead.
+//   Old contexts, large arrays and -nostreaming use float client arrays.
+
+void OpenGLState::StreamArrays(uint count,
+                               const coord *vertices, uint vertexStride,
+                               const coord *normals, uint normalStride,
+                               const coord *texCoords, uint texSize,
+                               uint texStride, uint64 textureUnits)
+// ----------------------------------------------------------------------------
+//   Stream vertex data and enable the arrays to draw it
+// ----------------------------------------------------------------------------
+//   Strides are in bytes, 0 for tightly packed coordinates. Texture
+//   coordinates are used for the units in textureUnits. The arrays remain
+//   enabled until StreamDone.
+{
+    if (streamMode == STREAM_UNKNOWN)
+        streamInit();
+
+    // Interleave the coordinates of each vertex as floats
+    uint floats = 3 + (normals ? 3 : 0) + (texCoords ? texSize : 0);
+    uint stride = floats * sizeof(float);
+    const char *base = NULL;
+    float *out = streamAllocate(count * stride, base);
+
+    if (!vertexStride)
+        vertexStride = 3 * sizeof(coord);
+    if (!normalStride)
+        normalStride = 3 * sizeof(coord);
+    if (!texStride)
+        texStride = texSize * sizeof(coord);
+    const char *v = (const char *) vertices;
+    const char *n = (const char *) normals;
+    const char *t = (const char *) texCoords;
+    for (uint i = 0; i < count; i++)
+    {
+        const coord *vertex = (const coord *) (v + i * vertexStride);
+        *out++ = vertex[0];
+        *out++ = vertex[1];
+        *out++ = vertex[2];
+        if (normals)
+        {
+            const coord *normal = (const coord *) (n + i * normalStride);
+            *out++ = normal[0];
+            *out++ = normal[1];
+            *out++ = normal[2];
+        }
+        if (texCoords)
+        {
+            const coord *tex = (const coord *) (t + i * texStride);
+            for (uint k = 0; k < texSize; k++)
+                *out++ = tex[k];
+        }
+    }
+    if (streamMapped)
+    {
+        UnmapBuffer(GL_ARRAY_BUFFER);
+        streamedBytes += count * stride;
+    }
+
+    // The pointers refer to the buffer bound when they are set
+    VertexPointer(3, GL_FLOAT, stride, base);
+    EnableClientState(GL_VERTEX_ARRAY);
+    streamNormals = normals != NULL;
+    if (normals)
+    {
+        NormalPointer(GL_FLOAT, stride, base + 3 * sizeof(float));
+        EnableClientState(GL_NORMAL_ARRAY);
+    }
+    streamUnits = 0;
+    if (texCoords)
+    {
+        const char *tex = base + (normals ? 6 : 3) * sizeof(float);
+        for (uint unit = 0; unit < maxTextureCoords && textureUnits; unit++)
+        {
+            uint64 bit = 1ULL << unit;
+            if (textureUnits & bit)
+            {
+                ClientActiveTexture(GL_TEXTURE0 + unit);
+                EnableClientState(GL_TEXTURE_COORD_ARRAY);
+                TexCoordPointer(texSize, GL_FLOAT, stride, tex);
+                textureUnits &= ~bit;
+                streamUnits |= bit;
+            }
+        }
+    }
+    if (streamMapped)
+        BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void OpenGLState::StreamDone()
+// ----------------------------------------------------------------------------
+//   Disable the arrays enabled by the last StreamArrays
+// ----------------------------------------------------------------------------
+{
+    DisableClientState(GL_VERTEX_ARRAY);
+    if (streamNormals)
+        DisableClientState(GL_NORMAL_ARRAY);
+    for (uint unit = 0; streamUnits; unit++)
+    {
+        uint64 bit = 1ULL << unit;
+        if (streamUnits & bit)
+        {
+            ClientActiveTexture(GL_TEXTURE0 + unit);
+            DisableClientState(GL_TEXTURE_COORD_ARRAY);
+            streamUnits &= ~bit;
+        }
+    }
+    streamNormals = false;
+}
+
+
+void OpenGLState::StreamEndFrame()
+// ----------------------------------------------------------------------------
+//   Start counting the chunks used by the next frame
+// ----------------------------------------------------------------------------
+{
+    streamChunks = 0;
+}
+
+
+void OpenGLState::streamInit()
+// ----------------------------------------------------------------------------
+//   Create the streaming buffer if the context supports it
+// ----------------------------------------------------------------------------
+{
+    streamMode = STREAM_CLIENT;
+    if (!XL::MAIN->options.vertex_streaming ||
+        !HasBuffers() || IsNull(glMapBufferRange))
+        return;
+
+    GenBuffers(1, &streamBuffer);
+    BindBuffer(GL_ARRAY_BUFFER, streamBuffer);
+    BufferData(GL_ARRAY_BUFFER, STREAM_CHUNKS * STREAM_CHUNK_SIZE,
+               NULL, GL_STREAM_DRAW);
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    bool fences =
+        !IsNull(glFenceSync) &&
+        !IsNull(glClientWaitSync) &&
+        !IsNull(glDeleteSync);
+    streamMode = fences ? STREAM_FENCE : STREAM_ORPHAN;
+}
+
+
+float *OpenGLState::streamAllocate(uint bytes, const char *&base)
+// ----------------------------------------------------------------------------
+//   Return where to write streamed data, and base to give to GL pointers
+// ----------------------------------------------------------------------------
+//   When the data is mapped in the streaming buffer, the buffer is bound
+//   and base is its offset in the buffer.
+{
+    streamMapped = false;
+    if (streamMode != STREAM_CLIENT && bytes && bytes <= STREAM_CHUNK_SIZE)
+    {
+        if (streamOffset + bytes > (streamChunk + 1) * STREAM_CHUNK_SIZE)
+            streamNextChunk();
+
+        BindBuffer(GL_ARRAY_BUFFER, streamBuffer);
+        void *data = glMapBufferRange(GL_ARRAY_BUFFER, streamOffset, bytes,
+                                      GL_MAP_WRITE_BIT |
+                                      GL_MAP_INVALIDATE_RANGE_BIT |
+                                      GL_MAP_UNSYNCHRONIZED_BIT);
+        if (data)
+        {
+            base = (const char *) (size_t) streamOffset;
+            streamOffset += (bytes + 15) & ~15;
+            streamMapped = true;
+            return (float *) data;
+        }
+        BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    streamClient.resize(bytes / sizeof(float) + 1);
+    base = (const char *) &streamClient[0];
+    return &streamClient[0];
+}
+
+
+void OpenGLState::streamNextChunk()
+// ----------------------------------------------------------------------------
+//   Fence the current chunk, and wait until the GPU is done with the next one
+// ----------------------------------------------------------------------------
+{
+    if (streamMode == STREAM_FENCE)
+        streamFences[streamChunk] =
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    streamChunk = (streamChunk + 1) % STREAM_CHUNKS;
+    streamOffset = streamChunk * STREAM_CHUNK_SIZE;
+
+    // Waiting for a chunk used by this frame would stall, orphan instead
+    if (++streamChunks >= STREAM_CHUNKS ||
+        (streamMode == STREAM_ORPHAN && streamChunk == 0))
+    {
+        streamOrphan();
+        return;
+    }
+
+    GLsync &fence = streamFences[streamChunk];
+    if (fence)
+    {
+        GLenum rc = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     1000000000ULL);
+        glDeleteSync(fence);
+        fence = NULL;
+        if (rc != GL_ALREADY_SIGNALED && rc != GL_CONDITION_SATISFIED)
+            streamOrphan();
+    }
+}
+
+
+void OpenGLState::streamOrphan()
+// ----------------------------------------------------------------------------
+//   Give the buffer a new data store, so that nothing waits for the old one
+// ----------------------------------------------------------------------------
+{
+    for (uint c = 0; c < STREAM_CHUNKS; c++)
+    {
+        if (streamFences[c])
+        {
+            glDeleteSync(streamFences[c]);
+            streamFences[c] = NULL;
+        }
+    }
+    BindBuffer(GL_ARRAY_BUFFER, streamBuffer);
+    BufferData(GL_ARRAY_BUFFER, STREAM_CHUNKS * STREAM_CHUNK_SIZE,
+               NULL, GL_STREAM_DRAW);
+    streamChunks = 0;
+}
+
+
 TAO_END
 
 
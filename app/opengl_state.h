@@ -402,8 +402,7 @@ struct TexturesState
 // ----------------------------------------------------------------------------
 //    The state of all textures
 // ----------------------------------------------------------------------------
-//    This is also used in OpenGLSave to record the previous state of the
-//    textures that have been changed.
+//    OpenGLSave only records the individual TextureState that changed
 {
     TexturesState(): textures() { textures[0] = TextureState(); }
 
@@ -499,10 +498,20 @@ public:
 //
 // ============================================================================
 
-struct OpenGLState : GraphicState
+#ifdef Q_DECL_FINAL
+#define TAO_FINAL       Q_DECL_FINAL
+#else
+#define TAO_FINAL
+#endif
+
+struct OpenGLState TAO_FINAL : GraphicState
 // ----------------------------------------------------------------------------
 //   Class to manage graphic states
 // ----------------------------------------------------------------------------
+//   In-tree code accesses the state through the GL macro, i.e. through an
+//   OpenGLState reference. Since the class is final, the compiler may bind
+//   these calls statically. Modules only see the virtual GraphicState
+//   interface.
 {
     OpenGLState();
     virtual ~OpenGLState();
@@ -620,6 +629,7 @@ struct OpenGLState : GraphicState
 
     // Attributes management
     virtual void Viewport(int x, int y, int w, int h);
+    void         Scissor(int x, int y, int w, int h);
     virtual void RasterPos(coord x, coord y, coord z = 0, coord w = 1);
     virtual void WindowPos(coord x, coord y, coord z = 0, coord w = 1);
     virtual void PixelStorei(GLenum pname,  int param);
@@ -805,6 +815,17 @@ struct OpenGLState : GraphicState
     virtual void * MapBuffer(GLenum target, GLenum access);
     virtual void   UnmapBuffer(GLenum target);
 
+    // Streaming vertex data of shapes drawn from client memory
+    void           StreamArrays(uint count,
+                                const coord *vertices, uint vertexStride = 0,
+                                const coord *normals = NULL,
+                                uint normalStride = 0,
+                                const coord *texCoords = NULL,
+                                uint texSize = 2, uint texStride = 0,
+                                uint64 textureUnits = 0);
+    void           StreamDone();
+    void           StreamEndFrame();
+
 public:
 #define GS(type, name)                          \
     inline void SetCached_##name(type name)     \
@@ -852,6 +873,8 @@ public:
     LightsState             currentLights;
     ClipPlanesState         currentClipPlanes;
     ulong                   polycount;
+    ulong                   drawCalls;
+    ulong                   streamedBytes;
 
 #define GS(type, name)                          \
     type name;
@@ -883,6 +906,31 @@ private:
     friend struct OpenGLSave;
     OpenGLSave *save;
 
+    // Vertex streaming, see StreamArrays
+    enum { STREAM_CHUNKS = 8, STREAM_CHUNK_SIZE = 1 << 20 };
+    enum StreamMode
+    {
+        STREAM_UNKNOWN,         // Not initialized yet
+        STREAM_CLIENT,          // Float arrays in client memory
+        STREAM_ORPHAN,          // Buffer orphaned when the ring wraps
+        STREAM_FENCE            // Fence on each chunk of the ring
+    };
+    StreamMode          streamMode;
+    GLuint              streamBuffer;
+    uint                streamChunk;    // Chunk being written
+    uint                streamChunks;   // Chunks entered in this frame
+    uint                streamOffset;   // Next free byte in the buffer
+    bool                streamMapped;   // Last arrays are in the buffer
+    bool                streamNormals;  // Last arrays have normals
+    uint64              streamUnits;    // Last arrays texture units
+    GLsync              streamFences[STREAM_CHUNKS];
+    std::vector<float>  streamClient;
+
+    void                streamInit();
+    float *             streamAllocate(uint bytes, const char *&base);
+    void                streamNextChunk();
+    void                streamOrphan();
+
     // Return the current texture matrix
     Matrix4 &           TextureMatrix()
     {
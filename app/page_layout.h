@@ -98,6 +98,7 @@ public:
 
     virtual void        Draw(Layout *where);
     virtual void        DrawSelection(Layout *);
+    virtual bool        CachedBounds(Box3 &)  { return false; }
     virtual void        Identify(Layout *l);
     virtual Box3        Bounds(Layout *layout);
     virtual Box3        Space(Layout *layout);
@@ -141,6 +142,7 @@ struct TextFlow : Layout
 public:
     virtual void        Draw(Layout *where);
     virtual void        DrawSelection(Layout *);
+    virtual bool        CachedBounds(Box3 &)  { return false; }
     virtual void        Identify(Layout *l);
     virtual void        Clear();
     virtual bool        Paginate(PageLayout *page);
@@ -205,6 +207,7 @@ struct TextSpan : Layout
 
     virtual void        Draw(Layout *where);
     virtual void        DrawSelection(Layout *);
+    virtual bool        CachedBounds(Box3 &)  { return false; }
     virtual void        Identify(Layout *l);
     virtual bool        Paginate(PageLayout *page);
 
@@ -244,6 +247,7 @@ struct AnchorLayout : Layout
 
     virtual void        Draw(Layout *where);
     virtual void        DrawSelection(Layout *);
+    virtual bool        CachedBounds(Box3 &)  { return false; }
     virtual void        Identify(Layout *l);
     virtual bool        Paginate(PageLayout *page);
 
@@ -0,0 +1,335 @@
+// *****************************************************************************
+// page_thumbnails.cpp                                             Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Asynchronous generation of page thumbnails, e.g. for a slide sorter.
+//     Requests are served by priority, and results are cached on disk,
+//     named after the source of the page.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "page_thumbnails.h"
+#include "widget.h"
+#include "base.h"
+#include "tao_utf8.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace Tao {
+
+PageThumbnails::PageThumbnails(Widget *widget)
+// ----------------------------------------------------------------------------
+//   Create the cache directory and start the writer thread
+// ----------------------------------------------------------------------------
+    : widget(widget), requests(), states(), renderTimer(), requestCount(0),
+      readyEventType(QEvent::registerEventType()), bytes(0), quit(false)
+{
+#if QT_VERSION >= 0x050000
+    QString base = QStandardPaths::writableLocation(
+        QStandardPaths::CacheLocation);
+#else
+    QString base = QDesktopServices::storageLocation(
+        QDesktopServices::CacheLocation);
+#endif
+    dir.setPath(base + "/thumbnails");
+    if (!dir.exists())
+        dir.mkpath(".");
+
+    renderTimer.setSingleShot(true);
+    connect(&renderTimer, SIGNAL(timeout()), this, SLOT(renderNext()));
+    connect(this, SIGNAL(stored(QString, bool)),
+            this, SLOT(storeDone(QString, bool)), Qt::QueuedConnection);
+    connect(this, SIGNAL(evicted(QString)),
+            this, SLOT(evictDone(QString)), Qt::QueuedConnection);
+    start(QThread::LowPriority);
+}
+
+
+PageThumbnails::~PageThumbnails()
+// ----------------------------------------------------------------------------
+//   Finish pending writes and stop the thread
+// ----------------------------------------------------------------------------
+{
+    renderTimer.stop();
+    mutex.lock();
+    quit = true;
+    cond.wakeOne();
+    mutex.unlock();
+    wait();
+}
+
+
+QString PageThumbnails::request(text context, text page, XL::Tree *source,
+                                uint width, uint height, double time,
+                                int priority)
+// ----------------------------------------------------------------------------
+//   Return the path of the thumbnail if available, otherwise queue it
+// ----------------------------------------------------------------------------
+//   The same page can be requested again with a different priority, e.g.
+//   when it scrolls into view, the highest priority being retained.
+{
+    QString key = keyName(context, page, source, width, height, time);
+    QString name = key + ".png";
+
+    StateMap::iterator s = states.find(key);
+    if (s == states.end())
+    {
+        // Thumbnails from a previous session are checked once
+        if (dir.exists(name))
+        {
+            states[key] = READY;
+            return dir.filePath(name);
+        }
+
+        IFTRACE(thumbnails)
+            debug() << "Request '" << page << "' " << width << "x" << height
+                    << " priority " << priority << " [" << +key << "]\n";
+        Request r;
+        r.page = page;
+        r.key = key;
+        r.width = width;
+        r.height = height;
+        r.time = time;
+        r.priority = priority;
+        r.order = requestCount++;
+        requests.append(r);
+        states[key] = PENDING;
+        if (!renderTimer.isActive())
+            renderTimer.start(RENDER_INTERVAL);
+        return "";
+    }
+
+    switch (*s)
+    {
+    case READY:
+        return dir.filePath(name);
+    case PENDING:
+        for (int i = 0; i < requests.size(); i++)
+            if (requests[i].key == key && requests[i].priority < priority)
+                requests[i].priority = priority;
+        break;
+    default:
+        break;
+    }
+    return "";
+}
+
+
+QString PageThumbnails::keyName(text context, text page, XL::Tree *source,
+                                uint width, uint height, double time)
+// ----------------------------------------------------------------------------
+//   Name of the cache entry for the given document, page source, size, time
+// ----------------------------------------------------------------------------
+{
+    std::ostringstream os;
+    os << context << '\n' << page << '\n'
+       << width << 'x' << height << '@' << time << '\n'
+       << source;
+    std::string data = os.str();
+    QByteArray hash = QCryptographicHash::hash(
+        QByteArray(data.data(), data.size()), QCryptographicHash::Sha1);
+    return QString(hash.toHex());
+}
+
+
+void PageThumbnails::renderNext()
+// ----------------------------------------------------------------------------
+//   Render the request with the highest priority, and queue it for storage
+// ----------------------------------------------------------------------------
+{
+    if (requests.isEmpty())
+        return;
+
+    int best = 0;
+    for (int i = 1; i < requests.size(); i++)
+    {
+        const Request &r = requests[i];
+        const Request &b = requests[best];
+        if (r.priority > b.priority ||
+            (r.priority == b.priority && r.order < b.order))
+            best = i;
+    }
+
+    // The widget may be busy (e.g. drawing or printing), retry later
+    Request r = requests[best];
+    Job job;
+    if (!widget->renderPage(r.page, r.time, job.image))
+    {
+        renderTimer.start(RENDER_INTERVAL);
+        return;
+    }
+    requests.removeAt(best);
+    states[r.key] = STORING;
+
+    IFTRACE(thumbnails)
+        debug() << "Rendered '" << r.page << "' " << job.image.width()
+                << "x" << job.image.height() << ", "
+                << requests.size() << " remaining\n";
+
+    job.key = r.key;
+    job.width = r.width;
+    job.height = r.height;
+    mutex.lock();
+    jobs.append(job);
+    cond.wakeOne();
+    mutex.unlock();
+
+    // Let the presentation run before rendering the next page
+    if (!requests.isEmpty())
+        renderTimer.start(RENDER_INTERVAL);
+}
+
+
+void PageThumbnails::storeDone(QString key, bool ok)
+// ----------------------------------------------------------------------------
+//   A thumbnail was written, refresh the layouts that are waiting for it
+// ----------------------------------------------------------------------------
+{
+    states[key] = ok ? READY : FAILED;
+    widget->postEvent(readyEventType, true);
+}
+
+
+void PageThumbnails::evictDone(QString key)
+// ----------------------------------------------------------------------------
+//   A thumbnail was removed from disk, render it again if requested
+// ----------------------------------------------------------------------------
+{
+    StateMap::iterator s = states.find(key);
+    if (s != states.end() && *s == READY)
+        states.erase(s);
+}
+
+
+void PageThumbnails::run()
+// ----------------------------------------------------------------------------
+//   Scale and write queued thumbnails to disk
+// ----------------------------------------------------------------------------
+{
+    evict(MAX_BYTES);
+
+    QMutexLocker locker(&mutex);
+    while (!quit || !jobs.isEmpty())
+    {
+        if (jobs.isEmpty())
+        {
+            cond.wait(&mutex);
+            continue;
+        }
+
+        Job job = jobs.takeFirst();
+        locker.unlock();
+        write(job);
+        if (bytes > MAX_BYTES)
+            evict(MAX_BYTES);
+        locker.relock();
+    }
+}
+
+
+void PageThumbnails::write(Job &job)
+// ----------------------------------------------------------------------------
+//   Scale the rendered page to the thumbnail size, and save it as PNG
+// ----------------------------------------------------------------------------
+//   Called from the thread with mutex unlocked
+{
+    QImage scaled = job.image.scaled(job.width, job.height,
+                                     Qt::KeepAspectRatio,
+                                     Qt::SmoothTransformation);
+    job.image = QImage();
+
+    // Write to temporary file, then rename, so that readers never see
+    // partial files (including other instances of the application)
+    QString name = job.key + ".png";
+    QString tmpName = job.key + ".tmp";
+    bool ok = scaled.save(dir.filePath(tmpName), "PNG");
+    dir.remove(name);
+    if (!ok || !dir.rename(tmpName, name))
+    {
+        dir.remove(tmpName);
+        ok = false;
+    }
+    if (ok)
+        bytes += QFileInfo(dir.filePath(name)).size();
+
+    IFTRACE(thumbnails)
+        debug() << (ok ? "Stored [" : "Failed to store [") << +name << "] "
+                << scaled.width() << "x" << scaled.height() << "\n";
+    emit stored(job.key, ok);
+}
+
+
+void PageThumbnails::evict(quint64 target)
+// ----------------------------------------------------------------------------
+//   Remove the oldest thumbnails until the cache size is below target
+// ----------------------------------------------------------------------------
+//   Called from the thread when it starts, then each time a thumbnail
+//   written brings the cache above its maximum size
+{
+    QFileInfoList files = dir.entryInfoList(QStringList("*.png"), QDir::Files,
+                                            QDir::Time | QDir::Reversed);
+    quint64 size = 0;
+    foreach (const QFileInfo &info, files)
+        size += info.size();
+
+    for (int i = 0; i < files.size() && size > target; i++)
+    {
+        const QFileInfo &info = files[i];
+        IFTRACE(thumbnails)
+            debug() << "Evict [" << +info.fileName() << "]\n";
+        if (dir.remove(info.fileName()))
+        {
+            size -= info.size();
+            emit evicted(info.completeBaseName());
+        }
+    }
+    bytes = size;
+}
+
+
+std::ostream &PageThumbnails::debug()
+// ----------------------------------------------------------------------------
+//   Convenience method to log with a common prefix
+// ----------------------------------------------------------------------------
+{
+    std::cerr << "[PageThumbnails] ";
+    return std::cerr;
+}
+
+}
@@ -0,0 +1,144 @@
+#ifndef PAGE_THUMBNAILS_H
+#define PAGE_THUMBNAILS_H
+// *****************************************************************************
+// page_thumbnails.h                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Asynchronous generation of page thumbnails, e.g. for a slide sorter.
+//     Requests are served by priority, and results are cached on disk,
+//     named after the source of the page.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "tao.h"
+#include "tao_tree.h"
+#include <QDir>
+#include <QMap>
+#include <QList>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QTimer>
+#include <iostream>
+
+namespace Tao {
+
+struct Widget;
+
+
+class PageThumbnails : public QThread
+// ----------------------------------------------------------------------------
+//    Render requested page thumbnails between frames, store them in a thread
+// ----------------------------------------------------------------------------
+//    Pages can only be evaluated and drawn in the GUI thread. The widget
+//    renders one page at a time when the render timer fires, in a layout
+//    and an offscreen frame of its own, so that the page being presented
+//    is not disturbed and keeps being refreshed between two thumbnails.
+//    Scaling, PNG encoding and disk writes are done by the thread.
+//    Files are named after the SHA-1 of the document path, page name, page
+//    source, size and time, so that thumbnails of pages that did not change
+//    survive edits and sessions.
+{
+    Q_OBJECT
+
+public:
+    PageThumbnails(Widget *widget);
+    virtual ~PageThumbnails();
+
+    QString         request(text context, text page, XL::Tree *source,
+                            uint width, uint height, double time,
+                            int priority);
+    int             readyEvent()        { return readyEventType; }
+
+signals:
+    void            stored(QString key, bool ok);
+    void            evicted(QString key);
+
+protected:
+    virtual void    run();
+
+private slots:
+    void            renderNext();
+    void            storeDone(QString key, bool ok);
+    void            evictDone(QString key);
+
+private:
+    enum State { PENDING, STORING, READY, FAILED };
+    enum { RENDER_INTERVAL = 20, MAX_BYTES = 64 * 1024 * 1024 };
+
+    struct Request
+    {
+        text        page;
+        QString     key;
+        uint        width, height;
+        double      time;
+        int         priority;
+        ulong       order;              // Serve in request order otherwise
+    };
+
+    struct Job
+    {
+        QString     key;
+        QImage      image;
+        uint        width, height;
+    };
+
+    typedef QMap<QString, State>        StateMap;
+
+    static QString  keyName(text context, text page, XL::Tree *source,
+                            uint width, uint height, double time);
+
+    void            write(Job &job);
+    void            evict(quint64 target);
+    std::ostream &  debug();
+
+private:
+    // Used only in the GUI thread
+    Widget *        widget;
+    QList<Request>  requests;
+    StateMap        states;
+    QTimer          renderTimer;
+    ulong           requestCount;
+    int             readyEventType;
+
+    // Used only in the thread
+    quint64         bytes;              // Size of the thumbnails on disk
+
+    // Shared with the thread
+    QDir            dir;
+    QMutex          mutex;
+    QWaitCondition  cond;
+    QList<Job>      jobs;
+    bool            quit;
+};
+
+}
+
+#endif // PAGE_THUMBNAILS_H
@@ -41,6 +41,7 @@
 // *****************************************************************************
 
 #include "path3d.h"
+#include "triangle_mesh.h"
 #include "layout.h"
 #include "manipulator.h"
 #include "gl_keepers.h"
@@ -116,39 +117,20 @@ static void drawArrays(GLenum mode, uint64 textureUnits, Vertices &data)
 //   Draw arrays
 // ----------------------------------------------------------------------------
 {
-    double *vdata = &data[0].vertex.x;
-    double *tdata = &data[0].texture.x;
-    double *ndata = &data[0].normal.x;
-    GLuint size = data.size();
-
-    GL.VertexPointer(3,GL_DOUBLE,sizeof(VertexData), vdata);
-    GL.NormalPointer(GL_DOUBLE, sizeof(VertexData), ndata);
-    GL.EnableClientState(GL_VERTEX_ARRAY);
-    GL.EnableClientState(GL_NORMAL_ARRAY);
-
-    // Activate texture coordinates for all used units
-    for(uint i = 0; i < GL.MaxTextureCoords() ; i++)
+    // Record triangles instead of drawing them, e.g. for cached glyphs
+    if (TriangleMesh *mesh = TriangleMesh::recording)
     {
-        if(textureUnits & (1 << i))
-        {
-            GL.ClientActiveTexture( GL_TEXTURE0 + i );
-            GL.EnableClientState(GL_TEXTURE_COORD_ARRAY);
-            GL.TexCoordPointer(3, GL_DOUBLE, sizeof(VertexData), tdata);
-        }
+        mesh->Add(mode, data);
+        return;
     }
 
-    GL.DrawArrays(mode, 0, size);
-    GL.DisableClientState(GL_VERTEX_ARRAY);
-    GL.DisableClientState(GL_NORMAL_ARRAY);
-
-    for(uint i = 0; i < GL.MaxTextureCoords() ; i++)
-    {
-        if(textureUnits & (1 << i))
-        {
-            GL.ClientActiveTexture( GL_TEXTURE0 + i );
-            GL.DisableClientState(GL_TEXTURE_COORD_ARRAY);
-        }
-    }
+    // Stream vertices, with texture coordinates for all used units
+    uint stride = sizeof(VertexData);
+    GL.StreamArrays(data.size(), &data[0].vertex.x, stride,
+                    &data[0].normal.x, stride,
+                    &data[0].texture.x, 3, stride, textureUnits);
+    GL.DrawArrays(mode, 0, data.size());
+    GL.StreamDone();
 
     // Restore the client active texture
     GL.ClientActiveTexture(GL_TEXTURE0);
@@ -408,7 +390,11 @@ static void CALLBACK tessEnd(PolygonData *poly)
         Layout *layout = poly->layout;
         uint64 textureUnits = GL.ActiveTextureUnits();
         double depth = layout->extrudeDepth;
-        if (depth > 0.0)
+        if (depth > 0.0 && TriangleMesh::recording)
+        {
+            TriangleMesh::recording->Add(poly->mode, data, true, depth);
+        }
+        else if (depth > 0.0)
         {
             bool invert = poly->path->invert;
             GL.Sync();
@@ -1116,7 +1102,11 @@ void GraphicPath::Draw(Layout *layout,
             {
                 if (depth > 0.0)
                 {
-                    if (!tesselation)
+                    if (!tesselation && TriangleMesh::recording)
+                    {
+                        TriangleMesh::recording->Add(mode, data, true, depth);
+                    }
+                    else if (!tesselation)
                     {
                         // If no tesselation is required, draw back directly
                         GraphicSave* save = GL.Save();
@@ -773,6 +773,7 @@ int     PerformancesPage::texture2DMinFilter_ = 0;
 int     PerformancesPage::texture2DMagFilter_ = 0;
 quint64 PerformancesPage::textureCacheMaxMem_ = 0ULL;
 quint64 PerformancesPage::textureCacheMaxGLMem_ = 0ULL;
+quint64 PerformancesPage::textureStoreMaxSize_ = 0ULL;
 
 
 PerformancesPage::PerformancesPage(QWidget *parent)
@@ -871,6 +872,19 @@ PerformancesPage::PerformancesPage(QWidget *parent)
     connect(cacheGLMemCombo, SIGNAL(currentIndexChanged(int)),
             this,  SLOT(textureCacheMaxGLMemChanged(int)));
     settingsLayout->addWidget(cacheGLMemCombo, 8, 2);
+    settingsLayout->addWidget(new QLabel(tr("Compressed texture store on disk:")), 9, 1);
+    storeSizeCombo = new QComboBox;
+    storeSizeCombo->addItem(tr("Disabled"), QVariant(0));
+    storeSizeCombo->addItem(tr("256 MiB"), QVariant(256*CACHE_MB));
+    storeSizeCombo->addItem(tr("1 GiB (default)"), QVariant(CACHE_GB));
+    storeSizeCombo->addItem(tr("4 GiB"), QVariant(4*CACHE_GB));
+    QVariant storeSaved = QVariant(TextureStore::instance()->maxSize());
+    int storeIndex = storeSizeCombo->findData(storeSaved);
+    if (storeIndex != -1)
+        storeSizeCombo->setCurrentIndex(storeIndex);
+    connect(storeSizeCombo, SIGNAL(currentIndexChanged(int)),
+            this,  SLOT(textureStoreMaxSizeChanged(int)));
+    settingsLayout->addWidget(storeSizeCombo, 9, 2);
 
     settings->setLayout(settingsLayout);
 
@@ -1025,6 +1039,29 @@ void PerformancesPage::textureCacheMaxGLMemChanged(int index)
 }
 
 
+void PerformancesPage::setTextureStoreMaxSize(quint64 bytes)
+// ----------------------------------------------------------------------------
+//   Save setting, update texture store value
+// ----------------------------------------------------------------------------
+{
+    QSettings settings;
+    settings.beginGroup(PERFORMANCES_GROUP);
+    settings.setValue("TextureStoreMaxSize", QVariant(bytes));
+    TextureStore::instance()->setMaxSize(bytes);
+    textureStoreMaxSize_ = bytes;
+}
+
+
+void PerformancesPage::textureStoreMaxSizeChanged(int index)
+// ----------------------------------------------------------------------------
+//   Set texture store max disk size from combo box index
+// ----------------------------------------------------------------------------
+{
+    quint64 bytes = storeSizeCombo->itemData(index).toULongLong();
+    setTextureStoreMaxSize(bytes);
+}
+
+
 void PerformancesPage::readAllSettings()
 // ----------------------------------------------------------------------------
 //   Read all values from user's settings and cache them
@@ -1047,6 +1084,9 @@ void PerformancesPage::readAllSettings()
     textureCacheMaxGLMem_ =
                           Q("TextureCacheMaxGLMem",
                             textureCacheMaxGLMemDefault());
+    textureStoreMaxSize_ =
+                          Q("TextureStoreMaxSize",
+                            textureStoreMaxSizeDefault());
 
 #undef B
 #undef I
@@ -1132,6 +1172,15 @@ quint64 PerformancesPage::textureCacheMaxGLMem()
 }
 
 
+quint64 PerformancesPage::textureStoreMaxSize()
+// ----------------------------------------------------------------------------
+//   Read setting for the size of the compressed texture store on disk
+// ----------------------------------------------------------------------------
+{
+    RETURN_CACHED(textureStoreMaxSize_);
+}
+
+
 bool PerformancesPage::perPixelLightingDefault()
 // ----------------------------------------------------------------------------
 //   Should per-pixel lighting be enabled by default?
@@ -1203,4 +1252,13 @@ quint64 PerformancesPage::textureCacheMaxGLMemDefault()
     return CACHE_UNLIMITED;
 }
 
+
+quint64 PerformancesPage::textureStoreMaxSizeDefault()
+// ----------------------------------------------------------------------------
+//   Default value for the size of the compressed texture store on disk
+// ----------------------------------------------------------------------------
+{
+    return CACHE_GB;
+}
+
 }
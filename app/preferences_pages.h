@@ -192,6 +192,7 @@ public:
     static int     texture2DMagFilter();
     static quint64 textureCacheMaxMem();
     static quint64 textureCacheMaxGLMem();
+    static quint64 textureStoreMaxSize();
 
 protected slots:
     void           setPerPixelLighting(bool on);
@@ -206,6 +207,8 @@ protected slots:
     void           textureCacheMaxMemChanged(int index);
     void           setTextureCacheMaxGLMem(quint64 bytes);
     void           textureCacheMaxGLMemChanged(int index);
+    void           setTextureStoreMaxSize(quint64 bytes);
+    void           textureStoreMaxSizeChanged(int index);
 
 protected:
     static void    readAllSettings();
@@ -218,12 +221,14 @@ protected:
     static int     texture2DMagFilterDefault();
     static quint64 textureCacheMaxMemDefault();
     static quint64 textureCacheMaxGLMemDefault();
+    static quint64 textureStoreMaxSizeDefault();
 
 protected:
     QRadioButton * lightFixed;
     QRadioButton * lightVShader;
     QRadioButton * lightFShader;
     QComboBox    * magCombo, * minCombo, * cacheMemCombo, * cacheGLMemCombo;
+    QComboBox    * storeSizeCombo;
 
 protected:
     static bool    dirty;
@@ -237,6 +242,7 @@ protected:
     static int     texture2DMagFilter_;
     static quint64 textureCacheMaxMem_;
     static quint64 textureCacheMaxGLMem_;
+    static quint64 textureStoreMaxSize_;
 };
 
 }
@@ -49,7 +49,7 @@
 #include <QDir>
 #include <QtGlobal>
 #include <QApplication>
-#include <fstream>
+#include <sstream>
 #include <math.h>
 
 #if defined(CFG_NOGIT) && defined(CFG_NONETWORK)
@@ -67,20 +67,24 @@ struct Repository::Commit Repository::HeadCommit  = Repository::Commit("HEAD");
 Repository::Repository(const QString &path): path(path),
                                      pullInterval(XL::MAIN->options
                                                   .pull_interval),
-                                     state(RS_Clean), whatsNew("")
+                                     state(RS_Clean), whatsNew(""),
+                                     writer(DocumentWriter::instance())
 {
     connect(&branchCheckTimer, SIGNAL(timeout()),
             this, SLOT(checkCurrentBranch()));
     branchCheckTimer.start(1000);
+    connect(writer.data(), SIGNAL(written(QString,bool,bool)),
+            this, SLOT(fileWritten(QString,bool,bool)));
 }
 
 
 Repository::~Repository()
 // ----------------------------------------------------------------------------
-//   Remove self from cache (if present)
+//   Remove self from cache (if present), make sure files are on disk
 // ----------------------------------------------------------------------------
 {
     RepositoryFactory::removeFromCache(path);
+    writer->flush();
 }
 
 
@@ -110,10 +114,12 @@ text Repository::styleSheet()
 
 bool Repository::write(text fileName, XL::Tree *tree)
 // ----------------------------------------------------------------------------
-//   Write the text into a repository, ready to commit, return true if OK
+//   Render the tree and queue it for writing, return true if OK
 // ----------------------------------------------------------------------------
+//   The tree is rendered here, since it may change as soon as we return.
+//   The file is written by the document writer thread, and the change is
+//   recorded in the repository once it is on disk (see fileWritten).
 {
-    bool ok = false;
     text full = fullName(fileName);
 
     if (full == "")
@@ -122,38 +128,74 @@ bool Repository::write(text fileName, XL::Tree *tree)
     if (!QFileInfo(+full).isWritable())
         return false;
 
-    // Write the file in a copy (avoid overwriting original)
-    text copy = full + "~";
-    {
-        std::ofstream output(copy.c_str());
-        XL::Renderer renderer(output);
-        QFileInfo stylesheet(+styleSheet());
-        QFileInfo syntax("system:xl.syntax");
-        QString sspath(stylesheet.absoluteFilePath());
-        QString sypath(syntax.absoluteFilePath());
-        IFTRACE(paths)
-                std::cerr << "Loading git stylesheet '" << +sspath
-                << "' with syntax '" << +sypath << "'\n";
-        renderer.SelectStyleSheet(+sspath, +sypath);
-        renderer.Render(tree);
-        output.flush();
-        ok = output.good();
-    }
+    std::ostringstream output;
+    XL::Renderer renderer(output);
+    QFileInfo stylesheet(+styleSheet());
+    QFileInfo syntax("system:xl.syntax");
+    QString sspath(stylesheet.absoluteFilePath());
+    QString sypath(syntax.absoluteFilePath());
+    IFTRACE(paths)
+            std::cerr << "Loading git stylesheet '" << +sspath
+            << "' with syntax '" << +sypath << "'\n";
+    renderer.SelectStyleSheet(+sspath, +sypath);
+    renderer.Render(tree);
+    if (!output.good())
+        return false;
 
-    // If we were successful writing, rename to new file
-    // Note: on Windows, std::rename (or QDir::rename) fail if
-    // destination exists, hence the rename/rename/remove
-    text backup = full + ".bak";
-    if (ok)
-        ok = std::rename(full.c_str(), backup.c_str()) == 0;
-    if (ok)
-        ok = std::rename(copy.c_str(), full.c_str()) == 0;
-    if (ok)
-        ok = std::remove(backup.c_str()) == 0;
+    text data = output.str();
+    writing[+full] = fileName;
+    writer->write(+full, QByteArray(data.data(), data.length()));
 
     state = RS_NotClean;
 
-    return ok;
+    return true;
+}
+
+
+void Repository::flushWrites()
+// ----------------------------------------------------------------------------
+//   Wait until files being saved are on disk and recorded in the repository
+// ----------------------------------------------------------------------------
+{
+    writer->flush();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+
+void Repository::fileWritten(QString path, bool changed, bool ok)
+// ----------------------------------------------------------------------------
+//   The document writer is done with a file, record the change if any
+// ----------------------------------------------------------------------------
+{
+    if (!writing.contains(path) || writer->pending(path))
+        return;
+    text fileName = writing.take(path);
+
+    if (!ok)
+    {
+        // Keep the source file dirty so that the next save tries again
+        IFTRACE(filesync)
+            std::cerr << "Could not write " << fileName
+                      << " to repository\n";
+        if (XL::MAIN->files.count(fileName))
+            XL::MAIN->files[fileName].changed = true;
+        emit writeFailed(path);
+        return;
+    }
+    if (!changed)
+        return;
+
+    // Record that we need to commit it sometime soon
+    change(fileName);
+    IFTRACE(filesync)
+        std::cerr << "Changed " << fileName << "\n";
+
+    // Record time when file was changed
+    if (XL::MAIN->files.count(fileName))
+    {
+        QDateTime modified = QFileInfo(path).lastModified();
+        XL::MAIN->files[fileName].modified = modified.toTime_t();
+    }
 }
 
 
@@ -45,6 +45,7 @@
 #include "tao_tree.h"
 #include "tao_process.h"
 #include "main.h"
+#include "document_writer.h"
 #include <QString>
 #include <QProcess>
 #include <QtGlobal>
@@ -160,6 +161,7 @@ public:
     virtual void        markChanged(text reason);
     virtual void        abort(process_p proc);
     process_p           dispatch(process_p cmd, void *id = NULL);
+    void                flushWrites();
 
 public:
     virtual QString     userVisibleName()               = 0;
@@ -225,6 +227,7 @@ signals:
     void                deleted();
     void                branchChanged(QString newBranch);
     void                asyncGetRemoteTagsComplete(QStringList tags);
+    void                writeFailed(QString path);
 
 public:
     virtual QString     command()                       = 0;
@@ -237,6 +240,7 @@ protected slots:
     virtual void        asyncProcessFinished(int exitCode, QProcess::ExitStatus);
     virtual void        asyncProcessError(QProcess::ProcessError error);
     virtual void        checkCurrentBranch() {};
+    virtual void        fileWritten(QString path, bool changed, bool ok);
 
 protected:
     struct ProcQueueConsumer
@@ -262,6 +266,8 @@ public:
 protected:
     QQueue<process_p> pQueue;
     QTimer            branchCheckTimer;
+    QSharedPointer<DocumentWriter> writer;
+    QMap<QString, text> writing;        // Full path -> name being written
 };
 
 
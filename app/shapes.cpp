@@ -44,11 +44,13 @@
 #include "layout.h"
 #include "attributes.h"
 #include "path3d.h"
+#include "draw_batch.h"
 #include "gl_keepers.h"
 #include "application.h"
 #include "widget_surface.h"
 #include "texture_cache.h"
 #include <QPainterPath>
+#include <typeinfo>
 #include "lighting.h"
 TAO_BEGIN
 
@@ -78,47 +80,6 @@ bool Shape::setTexture(Layout *where)
 
 
 
-void Shape::enableTexCoord(double *texCoord, uint64 mask)
-// ----------------------------------------------------------------------------
-//    Enable texture coordinates of the specified units
-// ----------------------------------------------------------------------------
-{
-    uint unit = 0;
-    mask &= GL.ActiveTextureUnits();
-    while (mask)
-    {
-        if (mask & (1ULL << unit))
-        {
-            GL.ClientActiveTexture(GL_TEXTURE0 + unit);
-            GL.EnableClientState(GL_TEXTURE_COORD_ARRAY);
-            GL.TexCoordPointer(2, GL_DOUBLE, 0, texCoord);
-            mask &= ~(1ULL << unit);
-        }
-        unit++;
-    }
-}
-
-
-void Shape::disableTexCoord(uint64 mask)
-// ----------------------------------------------------------------------------
-//    Disable texture coordinates of the specified unit
-// ----------------------------------------------------------------------------
-{
-    uint unit = 0;
-    mask &= GL.ActiveTextureUnits();
-    while (mask)
-    {
-        if (mask & (1ULL << unit))
-        {
-            GL.ClientActiveTexture( GL_TEXTURE0 + unit);
-            GL.DisableClientState(GL_TEXTURE_COORD_ARRAY);
-            mask &= ~(1ULL << unit);
-        }
-        unit++;
-    }
-}
-
-
 bool Shape::setFillColor(Layout *where)
 // ----------------------------------------------------------------------------
 //    Set the fill color and texture according to the layout attributes
@@ -292,6 +253,26 @@ void Rectangle::Draw(GraphicPath &path)
 }
 
 
+bool Rectangle::Batch(Layout *where, DrawBatch &batch)
+// ----------------------------------------------------------------------------
+//   Draw the rectangle with its siblings if it is a simple polygon
+// ----------------------------------------------------------------------------
+//   Subclasses may draw something else than their path, e.g. SVG shapes,
+//   or draw it differently, e.g. with tesselation. Only the classes known
+//   to draw their path as a single polygon are batched.
+{
+    const std::type_info &type = typeid(*this);
+    if (type != typeid(Rectangle) &&
+        type != typeid(IsoscelesTriangle) &&
+        type != typeid(RightTriangle))
+        return false;
+
+    GraphicPath path;
+    Draw(path);
+    return batch.Add(where, path);
+}
+
+
 void PlaceholderRectangle::Draw(Layout *where)
 // ----------------------------------------------------------------------------
 //    Draw the shape using a path
@@ -779,6 +760,17 @@ void Star::Draw(GraphicPath &path)
 }
 
 
+Box3 SpeechBalloon::Bounds(Layout *where)
+// ----------------------------------------------------------------------------
+//   The bounds of a speech balloon include the end of its tail
+// ----------------------------------------------------------------------------
+{
+    Box3 result = Rectangle::Bounds(where);
+    result |= Point3(a.x, a.y, 0) + where->offset;
+    return result;
+}
+
+
 void SpeechBalloon::Draw(Layout *where)
 // ----------------------------------------------------------------------------
 //    We need correct tesselation
@@ -847,6 +839,17 @@ void SpeechBalloon::Draw(GraphicPath &path)
 }
 
 
+Box3 Callout::Bounds(Layout *where)
+// ----------------------------------------------------------------------------
+//   The bounds of a callout include the end of its tail
+// ----------------------------------------------------------------------------
+{
+    Box3 result = Rectangle::Bounds(where);
+    result |= Point3(a.x, a.y, 0) + where->offset;
+    return result;
+}
+
+
 void Callout::Draw(Layout *where)
 // ----------------------------------------------------------------------------
 //    We need correct tesselation
@@ -1137,11 +1140,10 @@ void Plane::Draw(PlaneMesh* plane, Layout *where)
     GL.Scale(width, height, 1.0);
     GL.Normal(0., 0., 1.);
 
-    // Set vertex coordinates
-    GL.VertexPointer(3, GL_DOUBLE, 0, &plane->vertices[0].x);
-    GL.EnableClientState(GL_VERTEX_ARRAY);
-
-    enableTexCoord(&plane->textures[0].x, ~0ULL);
+    // Stream vertex and texture coordinates
+    GL.StreamArrays(plane->vertices.size(), &plane->vertices[0].x, 0,
+                    NULL, 0, &plane->textures[0].x, 2, 0,
+                    GL.ActiveTextureUnits());
     setTexture(where);
 
     GLuint size = stacks * slices * 4;
@@ -1155,9 +1157,7 @@ void Plane::Draw(PlaneMesh* plane, Layout *where)
         for(GLuint i = 0; i < size; i+= 4)
             GL.DrawElements(GL_LINE_LOOP, 4 , GL_UNSIGNED_INT, &plane->indices[0] + i);
 
-    disableTexCoord(~0ULL);
-
-    GL.DisableClientState(GL_VERTEX_ARRAY);
+    GL.StreamDone();
 }
 
 TAO_END
@@ -61,8 +61,6 @@ struct Shape : Drawing
 
 public:
     // Shape parameters
-    static void         enableTexCoord(double *texCoord, uint64 mask = ~0UL);
-    static void         disableTexCoord(uint64 mask);
     static bool         setTexture(Layout *where);
     static bool         setShader(Layout *where);
     static bool         setFillColor(Layout *where);
@@ -89,6 +87,7 @@ struct Rectangle : Shape2
 {
     Rectangle(const Box &b): Shape2(), bounds(b) {}
     virtual void        Draw(GraphicPath &path);
+    virtual bool        Batch(Layout *where, DrawBatch &batch);
     virtual Box3        Bounds(Layout *where);
     Box                 bounds;
 };
@@ -243,6 +242,7 @@ struct SpeechBalloon : Rectangle
 {
     SpeechBalloon(const Box &b, coord r, coord ax, coord ay)
         : Rectangle(b), r(r), a(ax, ay) {}
+    virtual Box3        Bounds(Layout *where);
     virtual void        Draw(Layout *where);
     virtual void        Draw(GraphicPath &path);
     double r;
@@ -257,6 +257,7 @@ struct Callout : Rectangle
 {
     Callout(const Box &b, coord r, coord ax, coord ay, coord d)
         : Rectangle(b), r(r), a(ax, ay), d(d) {}
+    virtual Box3        Bounds(Layout *where);
     virtual void        Draw(Layout *where);
     virtual void        Draw(GraphicPath &path);
     coord r;
@@ -121,7 +121,7 @@ void Cube::Draw(Layout *where)
         {xu, yl, zl}, {xu, yu, zl}, {xu, yu, zu}, {xu, yl, zu}
     };
 
-    static GLdouble textures[][2] = {
+    static coord textures[][2] = {
         {1, 0}, {1, 1}, {0, 1}, {0, 0},
         {0, 0}, {1, 0}, {1, 1}, {0, 1},
         {0, 0}, {1, 0}, {1, 1}, {0, 1},
@@ -130,7 +130,7 @@ void Cube::Draw(Layout *where)
         {1, 0}, {1, 1}, {0, 1}, {0, 0}
     };
 
-    static GLfloat normals[][3] =
+    static coord normals[][3] =
     {
         { 0,  0, -1}, { 0,  0, -1}, { 0,  0, -1}, { 0,  0, -1},
         { 0,  0,  1}, { 0,  0,  1}, { 0,  0,  1}, { 0,  0,  1},
@@ -142,19 +142,15 @@ void Cube::Draw(Layout *where)
 
     GLAllStateKeeper save;
 
-    GL.EnableClientState(GL_VERTEX_ARRAY);
-    GL.VertexPointer(3, GL_DOUBLE, 0, vertices);
-
     // Set normals only if we have lights or shaders
-    if(GL.LightsMask() || where->programId)
-    {
+    bool lit = GL.LightsMask() || where->programId;
+    if (lit)
         GL.Sync(STATE_lights);
-        GL.EnableClientState(GL_NORMAL_ARRAY);
-        GL.NormalPointer(GL_FLOAT, 0, normals);
-    }
 
-    //Active texture coordinates for all used units
-    enableTexCoord(&textures[0][0], ~0ULL);
+    // Stream vertices, with texture coordinates for all used units
+    GL.StreamArrays(24, &vertices[0][0], 0,
+                    lit ? &normals[0][0] : NULL, 0,
+                    &textures[0][0], 2, 0, GL.ActiveTextureUnits());
     setTexture(where);
     GL.LoadMatrix();
 
@@ -167,13 +163,7 @@ void Cube::Draw(Layout *where)
         for (uint face = 0; face < 6; face++)
             GL.DrawArrays(GL_LINE_LOOP, 4*face, 4);
 
-    // Disable texture coordinates after drawing
-    disableTexCoord(~0ULL);
-
-    if(GL.LightsMask() || where->programId)
-        GL.DisableClientState(GL_NORMAL_ARRAY);
-
-    GL.DisableClientState(GL_VERTEX_ARRAY);
+    GL.StreamDone();
 }
 
 
@@ -193,21 +183,19 @@ void MeshBased::Draw(Mesh *mesh, Layout *where)
 
     GLAllStateKeeper save;
 
-    // Set Vertices
-    GL.EnableClientState(GL_VERTEX_ARRAY);
-    GL.VertexPointer(3, GL_DOUBLE, 0, &mesh->vertices[0].x);
-
     // Set normals only if we have lights or shaders
-    if(GL.LightsMask() || where->programId)
+    bool lit = GL.LightsMask() || where->programId;
+    if (lit)
     {
         GL.Sync(STATE_lights);
         GL.Enable(GL_NORMALIZE);
-        GL.EnableClientState(GL_NORMAL_ARRAY);
-        GL.NormalPointer(GL_DOUBLE, 0, &mesh->normals[0].x);
     }
 
-    //Active texture coordinates for all used units
-    enableTexCoord(&mesh->textures[0].x, ~0ULL);
+    // Stream vertices, with texture coordinates for all used units
+    uint count = mesh->textures.size();
+    GL.StreamArrays(count, &mesh->vertices[0].x, 0,
+                    lit ? &mesh->normals[0].x : NULL, 0,
+                    &mesh->textures[0].x, 2, 0, GL.ActiveTextureUnits());
     GL.Translate(p.x, p.y, p.z);
     GL.Scale(bounds.Width(), bounds.Height(), bounds.Depth());
     GL.LoadMatrix();
@@ -218,21 +206,13 @@ void MeshBased::Draw(Mesh *mesh, Layout *where)
     // Optimize drawing of convex shapes in case of no shaders thanks to
     // backface culling (doesn't need to draw back faces)
     if (setFillColor(where))
-        GL.DrawArrays(GL_QUAD_STRIP, 0, mesh->textures.size());
+        GL.DrawArrays(GL_QUAD_STRIP, 0, count);
     if (setLineColor(where))
-        GL.DrawArrays(GL_LINE_LOOP, 0, mesh->textures.size());
-
-    // Disable texture coordinates
-    disableTexCoord(~0ULL);
+        GL.DrawArrays(GL_LINE_LOOP, 0, count);
 
-    // Disable normals
-    if (GL.LightsMask() || where->programId)
-    {
+    GL.StreamDone();
+    if (lit)
         GL.Disable(GL_NORMALIZE);
-        GL.DisableClientState(GL_NORMAL_ARRAY);
-    }
-
-    GL.DisableClientState(GL_VERTEX_ARRAY);
 }
 
 
@@ -131,6 +131,13 @@ void Statistics::reset()
         max[i] = 0;
         lastMaxTime[i] = 0;
     }
+    for (int c = 0; c < LAST_COUNTER; c++)
+    {
+        counter[c] = 0;
+        lastCounter[c] = 0;
+        maxCounter[c] = 0;
+        lastMaxCounter[c] = 0;
+    }
     intervalTimer.start();
 }
 
@@ -222,6 +229,16 @@ void Statistics::end(Operation op)
             }
             frameTotal[i] = 0;
         }
+        for (int c = 0; c < LAST_COUNTER; c++)
+        {
+            if (counter[c] > maxCounter[c] || now-lastMaxCounter[c] >= interval)
+            {
+                maxCounter[c] = counter[c];
+                lastMaxCounter[c] = now;
+            }
+            lastCounter[c] = counter[c];
+            counter[c] = 0;
+        }
     }
 }
 
@@ -231,9 +248,20 @@ double Statistics::fps()
 //    Average frames per second during last 'interval' seconds
 // ----------------------------------------------------------------------------
 {
+    return rate(FRAME);
+}
+
+
+double Statistics::rate(Operation op)
+// ----------------------------------------------------------------------------
+//    Number of operations per second during last 'interval' seconds
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(op >= 0 && op < LAST_OP);
+
     if (!enabled || intervalTimer.elapsed() < interval)
         return -1.0;
-    return (double)data[FRAME].size() * 1000 / interval;
+    return (double)data[op].size() * 1000 / interval;
 }
 
 
@@ -284,4 +312,37 @@ int Statistics::maxTime(Operation op)
     return max[op];
 }
 
+
+void Statistics::count(Counter c, ulong n)
+// ----------------------------------------------------------------------------
+//    Add to a per-frame counter
+// ----------------------------------------------------------------------------
+{
+    if (!enabled)
+        return;
+
+    XL_ASSERT(c >= 0 && c < LAST_COUNTER);
+    counter[c] += n;
+}
+
+
+ulong Statistics::lastFrameCount(Counter c)
+// ----------------------------------------------------------------------------
+//    Value of the counter for the last complete frame
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(c >= 0 && c < LAST_COUNTER);
+    return lastCounter[c];
+}
+
+
+ulong Statistics::maxCount(Counter c)
+// ----------------------------------------------------------------------------
+//    Maximum value of the counter for a frame during last 'interval' seconds
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(c >= 0 && c < LAST_COUNTER);
+    return maxCounter[c];
+}
+
 TAO_END
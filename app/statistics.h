@@ -102,9 +102,20 @@ struct Statistics
 public:
     enum Operation
     {
-        EXEC, GC, GC_WAIT, DRAW, SELECT, FRAME,
+        EXEC, GC, GC_WAIT, DRAW, SELECT, FRAME, SOURCE,
+        IDLE,
         LAST_OP
     };
+    enum Counter
+    {
+        STATE_LEVELS, STATE_SAVES, STATE_RESTORES, STATE_BYTES,
+        DAMAGE_PIXELS, DRAWINGS_DRAWN, DRAWINGS_CULLED,
+        DRAWING_ALLOCS, DRAWING_BYTES, LAYOUT_STATE_COPIES,
+        GLYPHS_RASTERIZED, GLYPH_RASTER_TIME,
+        VIEWS_DRAWN, VIEWS_REPLAYED, JOBS_DONE, JOB_TIME,
+        DRAW_CALLS, STREAMED_BYTES, DRAW_CALLS_MERGED,
+        LAST_COUNTER
+    };
     enum Destination
     {
         TO_SCREEN = 0x1, TO_CONSOLE = 0x2
@@ -125,10 +136,15 @@ public:
     bool    isEnabled(int what = TO_SCREEN);
 
     double  fps();
+    double  rate(Operation op);
     int     averageTime(Operation op);
     int     averageTimePerFrame(Operation op);
     int     maxTime(Operation op);
 
+    void    count(Counter c, ulong n = 1);
+    ulong   lastFrameCount(Counter c);
+    ulong   maxCount(Counter c);
+
 protected:
     int         enabled;
     int         interval;   // Measuring interval (ms)
@@ -141,6 +157,11 @@ protected:
     int         max[LAST_OP];
     int         lastMaxTime[LAST_OP];
     bool        running[LAST_OP];
+
+    // Per-frame counters
+    ulong       counter[LAST_COUNTER], lastCounter[LAST_COUNTER];
+    ulong       maxCounter[LAST_COUNTER];
+    qint64      lastMaxCounter[LAST_COUNTER];
 };
 
 TAO_END
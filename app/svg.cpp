@@ -41,28 +41,32 @@
 #include "svg.h"
 #include "tao_utf8.h"
 #include "application.h"
+#include <QFileInfo>
+#include <sstream>
 
 
 TAO_BEGIN
 
-SvgRendererInfo::SvgRendererInfo(Widget *w, uint width, uint height)
+SvgRendererInfo::document_map   SvgRendererInfo::documents;
+SvgRendererInfo::raster_map     SvgRendererInfo::rasters;
+ulong                           SvgRendererInfo::bytes    = 0;
+uint                            SvgRendererInfo::useCount = 0;
+
+
+SvgRendererInfo::SvgRendererInfo(Widget *widget)
 // ----------------------------------------------------------------------------
-//   Create a renderer with the right size
+//   Create the info for a tree, rasters are in the global cache
 // ----------------------------------------------------------------------------
-    : FrameInfo(width, height), widget(w)
+    : widget(widget), w(DEFAULT_SIZE), h(DEFAULT_SIZE), animated(false)
 {
 }
 
 
 SvgRendererInfo::~SvgRendererInfo()
 // ----------------------------------------------------------------------------
-//   When deleting the info, delete all renderers we have
+//   Nothing to delete, rasters may still be used by other trees
 // ----------------------------------------------------------------------------
 {
-    renderer_map::iterator i;
-    GL.Disable(GL_TEXTURE_2D);
-    for (i = renderers.begin(); i != renderers.end(); i++)
-        delete (*i).second;
 }
 
 
@@ -77,48 +81,199 @@ QSvgRenderer * SvgRendererInfo::defaultImageRenderer()
 }
 
 
-GLuint SvgRendererInfo::bind (text file)
+void SvgRendererInfo::purgeRasters()
+// ----------------------------------------------------------------------------
+//   Delete all rasters and renderers, e.g. when the GL context changes
+// ----------------------------------------------------------------------------
+{
+    raster_map::iterator r;
+    for (r = rasters.begin(); r != rasters.end(); r++)
+        delete (*r).second.frame;
+    rasters.clear();
+    bytes = 0;
+
+    document_map::iterator d;
+    for (d = documents.begin(); d != documents.end(); d++)
+        if ((*d).second.renderer != defaultImageRenderer())
+            delete (*d).second.renderer;
+    documents.clear();
+}
+
+
+bool SvgRendererInfo::changed(Document &doc, text file)
 // ----------------------------------------------------------------------------
-//    Activate a given SVG renderer
+//   Check if the file changed on disk, at most once per second
 // ----------------------------------------------------------------------------
 {
-    QSvgRenderer *r = renderers[file];
-    if (!r)
+    uint now = QDateTime::currentDateTime().toTime_t();
+    if (doc.checked == now)
+        return false;
+    doc.checked = now;
+
+    QFileInfo fi(+file);
+    QDateTime modified = fi.exists() ? fi.lastModified() : QDateTime();
+    if (modified == doc.modified)
+        return false;
+    doc.modified = modified;
+    return true;
+}
+
+
+SvgRendererInfo::Document *SvgRendererInfo::document(text file)
+// ----------------------------------------------------------------------------
+//   Return the shared renderer for a file, reloading it if file changed
+// ----------------------------------------------------------------------------
+{
+    Document &doc = documents[file];
+    bool reload = changed(doc, file);
+    if (doc.renderer && !reload)
+        return &doc;
+
+    if (doc.renderer && doc.renderer != defaultImageRenderer())
+        delete doc.renderer;
+
+    // Not parented to the widget: the renderer may outlive it
+    QString svgFile(+file);
+    QFileInfo fi(svgFile);
+    if (!fi.isReadable())
+        svgFile = "svg:" + svgFile;
+    QSvgRenderer *r = new QSvgRenderer(svgFile);
+    if (!r->isValid())
     {
-        while (renderers.size() > MAX_TEXTURES)
-        {
-            renderer_map::iterator first = renderers.begin();
-            delete (*first).second;
-            renderers.erase(first);
-        }
+        delete r;
+        r = defaultImageRenderer();
+    }
+    doc.renderer = r;
 
-        QString svgFile(+file);
-        QFileInfo fi(svgFile);
-        if (!fi.isReadable())
-            svgFile = "svg:" + svgFile;
-        r = new QSvgRenderer(svgFile, widget);
-        if (r->isValid())
-        {
-            r->connect(r, SIGNAL(repaintNeeded()), widget, SLOT(updateGL()));
-        }
-        else
+    // Rasters of that file must be rendered again
+    raster_map::iterator i;
+    for (i = rasters.begin(); i != rasters.end(); i++)
+        if ((*i).second.document == &doc)
+            (*i).second.rendered = -1;
+
+    return &doc;
+}
+
+
+void SvgRendererInfo::use(text key, int drawings)
+// ----------------------------------------------------------------------------
+//   Count the drawings using a raster, which must not be evicted
+// ----------------------------------------------------------------------------
+//   A raster may be purged while drawings still use it, e.g. when the GL
+//   context changes, in which case there is nothing left to count.
+{
+    raster_map::iterator found = rasters.find(key);
+    if (found == rasters.end())
+        return;
+    Raster &raster = (*found).second;
+    if (drawings > 0 || raster.drawings > 0)
+        raster.drawings += drawings;
+}
+
+
+void SvgRendererInfo::evict()
+// ----------------------------------------------------------------------------
+//   Evict least recently used rasters until the cache fits in budget
+// ----------------------------------------------------------------------------
+//   This is called between frames. Rasters used by drawings are kept, since
+//   the layouts holding these drawings will draw them again.
+{
+    while (bytes > MAX_BYTES)
+    {
+        raster_map::iterator i, lru = rasters.end();
+        for (i = rasters.begin(); i != rasters.end(); i++)
+            if ((*i).second.drawings == 0 &&
+                (lru == rasters.end() ||
+                 (*i).second.lastUse < (*lru).second.lastUse))
+                lru = i;
+        if (lru == rasters.end())
+            break;
+
+        Raster &raster = (*lru).second;
+        FrameInfo *frame = raster.frame;
+        IFTRACE(fbo)
+            std::cerr << "[SvgRendererInfo] Evict " << (*lru).first << "\n";
+        bytes -= frame->w * frame->h * 4;
+        delete frame;
+
+        // Delete renderer when no raster uses it anymore
+        Document *doc = raster.document;
+        if (--doc->users == 0)
         {
-            delete r;
-            r = defaultImageRenderer();
+            document_map::iterator d;
+            for (d = documents.begin(); d != documents.end(); d++)
+            {
+                if (&(*d).second == doc)
+                {
+                    if (doc->renderer != defaultImageRenderer())
+                        delete doc->renderer;
+                    documents.erase(d);
+                    break;
+                }
+            }
         }
-        renderers[file] = r;
+        rasters.erase(lru);
     }
+}
+
 
-    if (r)
+GLuint SvgRendererInfo::bind(text file, uint width, uint height)
+// ----------------------------------------------------------------------------
+//    Bind the raster for the given file and size, rendering it if needed
+// ----------------------------------------------------------------------------
+{
+    std::ostringstream os;
+    os << file << '@' << width << 'x' << height;
+    text key = os.str();
+
+    raster_map::iterator found = rasters.find(key);
+    if (found == rasters.end())
+    {
+        Raster &raster = rasters[key];
+        raster.frame = new FrameInfo(width, height);
+        raster.document = document(file);
+        raster.document->users++;
+        bytes += width * height * 4;
+        found = rasters.find(key);
+    }
+    else
+    {
+        // Checks modification date, invalidates raster if file changed
+        document(file);
+    }
+
+    Raster &raster = (*found).second;
+    QSvgRenderer *r = raster.document->renderer;
+    raster.lastUse = ++useCount;
+    animated = r->animated();
+    w = width;
+    h = height;
+    rasterKey = key;
+
+    // The renderer is shared, so connect it to each widget drawing it
+    if (animated)
+        r->connect(r, SIGNAL(repaintNeeded()), widget, SLOT(updateGL()),
+                   Qt::UniqueConnection);
+
+    // Static rasters are rendered once, animated ones at the SVG frame rate
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool render = raster.rendered < 0;
+    if (animated && !render)
+    {
+        int fps = r->framesPerSecond();
+        render = now - raster.rendered >= 1000 / (fps > 0 ? fps : 30);
+    }
+    if (render)
     {
         GL.Disable(GL_TEXTURE_2D);
         if (TaoApp->hasGLMultisample)
             GL.Disable(GL_MULTISAMPLE);
-        FramePainter painter(this);
+        FramePainter painter(raster.frame);
         r->render(&painter);
+        raster.rendered = now;
     }
 
-    return FrameInfo::bind();
+    return raster.frame->bind();
 }
 
 TAO_END
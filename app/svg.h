@@ -39,26 +39,89 @@
 // *****************************************************************************
 
 #include "frame.h"
+#include "attributes.h"
+#include <QDateTime>
 
 TAO_BEGIN
 
-struct SvgRendererInfo : FrameInfo
+struct SvgRendererInfo : XL::Info
 // ----------------------------------------------------------------------------
-//    Hold information about the SVG renderer for a tree
+//    Hold information about the SVG rasters used by a tree
 // ----------------------------------------------------------------------------
+//    Rasters are shared by all trees through a global cache, keyed by file
+//    and pixel size, and re-rendered only when the file changes or when an
+//    animated SVG moves to another frame. The cache is limited in bytes,
+//    least recently used rasters being evicted first. Rasters used by the
+//    drawings of a layout are kept, and eviction only happens between frames.
 {
     typedef SvgRendererInfo *                   data_t;
-    typedef std::map<text, QSvgRenderer *>      renderer_map;
-    enum { MAX_TEXTURES = 20 };
+    enum { DEFAULT_SIZE = 512 };
+    enum { MAX_BYTES = 64 * 1024 * 1024 };
 
-    SvgRendererInfo(Widget *w, uint width=512, uint height=512);
+    SvgRendererInfo(Widget *widget);
     ~SvgRendererInfo();
     operator data_t() { return this; }
-    GLuint bind(text img);
+    GLuint bind(text img, uint width=DEFAULT_SIZE, uint height=DEFAULT_SIZE);
 
     Widget *            widget;
-    renderer_map        renderers;
+    uint                w, h;
+    bool                animated;
+    text                rasterKey;      // Key of the last raster bound
+
+public:
     static QSvgRenderer * defaultImageRenderer();
+    static void           purgeRasters();
+    static ulong          rasterBytes() { return bytes; }
+    static void           evict();
+    static void           use(text key, int drawings);
+
+private:
+    struct Document
+    {
+        Document(): renderer(NULL), checked(0), users(0) {}
+        QSvgRenderer *  renderer;
+        QDateTime       modified;
+        uint            checked;        // Last check of 'modified', in s
+        uint            users;          // Number of rasters using it
+    };
+    struct Raster
+    {
+        Raster(): frame(NULL), document(NULL), rendered(-1), lastUse(0),
+                  drawings(0) {}
+        FrameInfo *     frame;
+        Document *      document;
+        qint64          rendered;       // Time of last render in ms, or -1
+        uint            lastUse;
+        uint            drawings;       // Number of drawings using it
+    };
+    typedef std::map<text, Document>    document_map;
+    typedef std::map<text, Raster>      raster_map;
+
+    static Document *   document(text file);
+    static bool         changed(Document &doc, text file);
+
+    static document_map documents;
+    static raster_map   rasters;
+    static ulong        bytes;
+    static uint         useCount;
+};
+
+
+struct SvgTexture : FillTexture
+// ----------------------------------------------------------------------------
+//    Draw with an SVG raster, which is not evicted while the drawing exists
+// ----------------------------------------------------------------------------
+{
+    SvgTexture(uint glName, text raster)
+        : FillTexture(glName, GL_TEXTURE_2D), raster(raster)
+    {
+        SvgRendererInfo::use(raster, 1);
+    }
+    ~SvgTexture()
+    {
+        SvgRendererInfo::use(raster, -1);
+    }
+    text raster;
 };
 
 TAO_END
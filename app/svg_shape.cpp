@@ -0,0 +1,750 @@
+// *****************************************************************************
+// svg_shape.cpp                                                   Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Import of SVG documents as tessellated vector geometry
+//
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "svg_shape.h"
+#include "svg.h"
+#include "layout.h"
+#include "gl_keepers.h"
+#include "tao_utf8.h"
+#include "tao_glu.h"
+#include "application.h"
+#include <QFileInfo>
+#include <QPainter>
+#include <QPaintDevice>
+#include <QPaintEngine>
+#include <QPainterPath>
+#include <QPainterPathStroker>
+#include <QSvgRenderer>
+#include <deque>
+#include <cmath>
+
+TAO_BEGIN
+
+SvgGeometry::entry_map  SvgGeometry::entries;
+ulong                   SvgGeometry::totalBytes = 0;
+uint                    SvgGeometry::useCount   = 0;
+
+
+
+// ============================================================================
+//
+//   Recording the paths painted by QSvgRenderer
+//
+// ============================================================================
+
+class SvgRecorder : public QPaintEngine
+// ----------------------------------------------------------------------------
+//   A paint engine that records paths in an SvgGeometry
+// ----------------------------------------------------------------------------
+//   We claim all features so that QPainter passes us untransformed paths
+//   and gradients, instead of emulating them.
+{
+public:
+    SvgRecorder(SvgGeometry &geometry)
+        : QPaintEngine(AllFeatures), geometry(geometry), opacity(1.0) {}
+
+    virtual bool begin(QPaintDevice *)  { return true; }
+    virtual bool end()                  { return true; }
+    virtual Type type() const           { return User; }
+
+    virtual void updateState(const QPaintEngineState &state)
+    {
+        QPaintEngine::DirtyFlags flags = state.state();
+        if (flags & DirtyTransform)
+            transform = state.transform();
+        if (flags & DirtyPen)
+            pen = state.pen();
+        if (flags & DirtyBrush)
+            brush = state.brush();
+        if (flags & DirtyOpacity)
+            opacity = state.opacity();
+    }
+
+    virtual void drawPath(const QPainterPath &path)
+    {
+        geometry.addPath(path, brush, pen, transform, opacity);
+    }
+
+    virtual void drawPolygon(const QPointF *points, int count,
+                             PolygonDrawMode mode)
+    {
+        if (count < 2)
+            return;
+        QPainterPath path;
+        path.setFillRule(mode == WindingMode ? Qt::WindingFill
+                                             : Qt::OddEvenFill);
+        path.moveTo(points[0]);
+        for (int i = 1; i < count; i++)
+            path.lineTo(points[i]);
+        if (mode == PolylineMode)
+        {
+            geometry.addPath(path, QBrush(), pen, transform, opacity);
+            return;
+        }
+        path.closeSubpath();
+        drawPath(path);
+    }
+
+    virtual void drawPolygon(const QPoint *points, int count,
+                             PolygonDrawMode mode)
+    {
+        QVector<QPointF> fpoints(count);
+        for (int i = 0; i < count; i++)
+            fpoints[i] = points[i];
+        drawPolygon(fpoints.constData(), count, mode);
+    }
+
+    virtual void drawRects(const QRectF *rects, int count)
+    {
+        QPainterPath path;
+        for (int i = 0; i < count; i++)
+            path.addRect(rects[i]);
+        drawPath(path);
+    }
+
+    virtual void drawEllipse(const QRectF &rect)
+    {
+        QPainterPath path;
+        path.addEllipse(rect);
+        drawPath(path);
+    }
+
+    virtual void drawLines(const QLineF *lines, int count)
+    {
+        QPainterPath path;
+        for (int i = 0; i < count; i++)
+        {
+            path.moveTo(lines[i].p1());
+            path.lineTo(lines[i].p2());
+        }
+        geometry.addPath(path, QBrush(), pen, transform, opacity);
+    }
+
+    virtual void drawPixmap(const QRectF &, const QPixmap &, const QRectF &)
+    {
+        // Embedded images are not converted
+    }
+
+private:
+    SvgGeometry &       geometry;
+    QTransform          transform;
+    QPen                pen;
+    QBrush              brush;
+    qreal               opacity;
+};
+
+
+class SvgRecordingDevice : public QPaintDevice
+// ----------------------------------------------------------------------------
+//   A paint device of the size of the SVG document, using an SvgRecorder
+// ----------------------------------------------------------------------------
+{
+public:
+    SvgRecordingDevice(SvgGeometry &geometry, QSize size)
+        : recorder(geometry), size(size) {}
+    virtual QPaintEngine *paintEngine() const { return &recorder; }
+
+protected:
+    virtual int metric(PaintDeviceMetric metric) const
+    {
+        switch (metric)
+        {
+        case PdmWidth:          return size.width();
+        case PdmHeight:         return size.height();
+        case PdmWidthMM:        return size.width() * 254 / 960;
+        case PdmHeightMM:       return size.height() * 254 / 960;
+        case PdmNumColors:      return 0xffffffff;
+        case PdmDepth:          return 32;
+        case PdmDpiX:
+        case PdmDpiY:
+        case PdmPhysicalDpiX:
+        case PdmPhysicalDpiY:   return 96;
+        default:                return QPaintDevice::metric(metric);
+        }
+    }
+
+private:
+    mutable SvgRecorder recorder;
+    QSize               size;
+};
+
+
+
+// ============================================================================
+//
+//   Tessellation and coloring of recorded paths
+//
+// ============================================================================
+
+struct SvgTessellation
+// ----------------------------------------------------------------------------
+//   Vertices passed to and returned by the GLU tessellator
+// ----------------------------------------------------------------------------
+{
+    std::deque<Point3>  points;         // Stable storage for GLU
+    std::vector<Point3 *> triangles;    // Output, three points per triangle
+};
+
+
+static void CALLBACK svgTessBegin(GLenum, SvgTessellation *)
+// ----------------------------------------------------------------------------
+//   Nothing to do, the edge flag callback forces GL_TRIANGLES
+// ----------------------------------------------------------------------------
+{}
+
+
+static void CALLBACK svgTessEdgeFlag(GLboolean, SvgTessellation *)
+// ----------------------------------------------------------------------------
+//   Having this callback ensures that GLU only emits independent triangles
+// ----------------------------------------------------------------------------
+{}
+
+
+static void CALLBACK svgTessEnd(SvgTessellation *)
+// ----------------------------------------------------------------------------
+//   Nothing to do at end of a primitive
+// ----------------------------------------------------------------------------
+{}
+
+
+static void CALLBACK svgTessVertex(Point3 *point, SvgTessellation *tess)
+// ----------------------------------------------------------------------------
+//   Record a triangle vertex
+// ----------------------------------------------------------------------------
+{
+    tess->triangles.push_back(point);
+}
+
+
+static void CALLBACK svgTessCombine(GLdouble position[3],
+                                    Point3 *[4], GLfloat [4],
+                                    Point3 **dataOut, SvgTessellation *tess)
+// ----------------------------------------------------------------------------
+//   Create a new vertex at an intersection
+// ----------------------------------------------------------------------------
+{
+    tess->points.push_back(Point3(position[0], position[1], position[2]));
+    *dataOut = &tess->points.back();
+}
+
+
+static void tessellate(const QList<QPolygonF> &polygons, Qt::FillRule rule,
+                       SvgTessellation &result)
+// ----------------------------------------------------------------------------
+//   Tessellate flattened polygons into triangles, flipping the Y axis
+// ----------------------------------------------------------------------------
+{
+    static GLUtesselator *tess = 0;
+    if (!tess)
+    {
+        tess = gluNewTess();
+        typedef void CALLBACK (*fn)();
+        gluTessCallback(tess, GLU_TESS_BEGIN_DATA,     fn(svgTessBegin));
+        gluTessCallback(tess, GLU_TESS_EDGE_FLAG_DATA, fn(svgTessEdgeFlag));
+        gluTessCallback(tess, GLU_TESS_END_DATA,       fn(svgTessEnd));
+        gluTessCallback(tess, GLU_TESS_VERTEX_DATA,    fn(svgTessVertex));
+        gluTessCallback(tess, GLU_TESS_COMBINE_DATA,   fn(svgTessCombine));
+        gluTessNormal(tess, 0, 0, 1);
+    }
+
+    gluTessProperty(tess, GLU_TESS_WINDING_RULE,
+                    rule == Qt::WindingFill ? GLU_TESS_WINDING_NONZERO
+                                            : GLU_TESS_WINDING_ODD);
+    gluTessBeginPolygon(tess, &result);
+    foreach (const QPolygonF &polygon, polygons)
+    {
+        uint count = polygon.size();
+        if (count < 3)
+            continue;
+        gluTessBeginContour(tess);
+        for (uint i = 0; i < count; i++)
+        {
+            const QPointF &p = polygon[i];
+            result.points.push_back(Point3(p.x(), -p.y(), 0));
+            Point3 *stored = &result.points.back();
+            gluTessVertex(tess, &stored->x, stored);
+        }
+        gluTessEndContour(tess);
+    }
+    gluTessEndPolygon(tess);
+}
+
+
+static void gradientColor(const QGradient *gradient, const QPointF &p,
+                          GLfloat rgba[4])
+// ----------------------------------------------------------------------------
+//   Evaluate a gradient at a given point in gradient coordinates
+// ----------------------------------------------------------------------------
+{
+    qreal t = 0;
+    switch (gradient->type())
+    {
+    case QGradient::LinearGradient:
+    {
+        const QLinearGradient *lg = (const QLinearGradient *) gradient;
+        QPointF s = lg->start();
+        QPointF d = lg->finalStop() - s;
+        qreal l2 = d.x() * d.x() + d.y() * d.y();
+        if (l2 > 0)
+            t = ((p.x() - s.x()) * d.x() + (p.y() - s.y()) * d.y()) / l2;
+        break;
+    }
+    case QGradient::RadialGradient:
+    {
+        const QRadialGradient *rg = (const QRadialGradient *) gradient;
+        QPointF d = p - rg->center();
+        qreal r = rg->radius();
+        if (r > 0)
+            t = sqrt(d.x() * d.x() + d.y() * d.y()) / r;
+        break;
+    }
+    case QGradient::ConicalGradient:
+    {
+        const QConicalGradient *cg = (const QConicalGradient *) gradient;
+        QPointF d = p - cg->center();
+        t = (atan2(-d.y(), d.x()) * (180 / M_PI) - cg->angle()) / 360;
+        t -= floor(t);
+        break;
+    }
+    default:
+        break;
+    }
+
+    switch (gradient->spread())
+    {
+    case QGradient::RepeatSpread:
+        t -= floor(t);
+        break;
+    case QGradient::ReflectSpread:
+        t = fmod(fabs(t), 2.0);
+        if (t > 1)
+            t = 2 - t;
+        break;
+    default:
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        break;
+    }
+
+    QGradientStops stops = gradient->stops();
+    int count = stops.size();
+    QColor c0, c1;
+    qreal f = 0;
+    if (count == 0)
+    {
+        c0 = c1 = Qt::black;
+    }
+    else if (t <= stops[0].first)
+    {
+        c0 = c1 = stops[0].second;
+    }
+    else
+    {
+        int i = 1;
+        while (i < count && stops[i].first < t)
+            i++;
+        if (i == count)
+        {
+            c0 = c1 = stops[count-1].second;
+        }
+        else
+        {
+            qreal t0 = stops[i-1].first, t1 = stops[i].first;
+            c0 = stops[i-1].second;
+            c1 = stops[i].second;
+            f = t1 > t0 ? (t - t0) / (t1 - t0) : 1;
+        }
+    }
+    rgba[0] = c0.redF()   + f * (c1.redF()   - c0.redF());
+    rgba[1] = c0.greenF() + f * (c1.greenF() - c0.greenF());
+    rgba[2] = c0.blueF()  + f * (c1.blueF()  - c0.blueF());
+    rgba[3] = c0.alphaF() + f * (c1.alphaF() - c0.alphaF());
+}
+
+
+struct SvgPainter
+// ----------------------------------------------------------------------------
+//   Emit colored triangles for a brush, subdividing them for gradients
+// ----------------------------------------------------------------------------
+{
+    SvgPainter(SvgGeometry &geometry, const QBrush &brush,
+               const QTransform &toBrush, qreal opacity, coord maxEdge)
+        : geometry(geometry), gradient(brush.gradient()), toBrush(toBrush),
+          flatness(geometry.flatness), opacity(opacity), maxEdge(maxEdge)
+    {
+        QColor c = brush.color();
+        rgba[0] = c.redF();
+        rgba[1] = c.greenF();
+        rgba[2] = c.blueF();
+        rgba[3] = c.alphaF();
+    }
+
+    void vertex(const Point3 &p)
+    {
+        SvgGeometry::Vertex v;
+        v.x = p.x / flatness;
+        v.y = p.y / flatness;
+        GLfloat *color = &v.r;
+        if (gradient)
+            gradientColor(gradient, toBrush.map(QPointF(p.x, -p.y)), color);
+        else
+            for (uint i = 0; i < 4; i++)
+                color[i] = rgba[i];
+        v.a *= opacity;
+        if (v.a < 1.0)
+            geometry.transparent = true;
+        geometry.vertices.push_back(v);
+    }
+
+    void triangle(const Point3 &a, const Point3 &b, const Point3 &c,
+                  uint depth = 0)
+    {
+        // Subdivide large gradient triangles so that colors follow stops
+        if (gradient && depth < 4 &&
+            ((a-b).Length() > maxEdge ||
+             (b-c).Length() > maxEdge ||
+             (c-a).Length() > maxEdge))
+        {
+            Point3 ab = a + (b-a) / 2, bc = b + (c-b) / 2, ca = c + (a-c) / 2;
+            triangle(a, ab, ca, depth+1);
+            triangle(ab, b, bc, depth+1);
+            triangle(ca, bc, c, depth+1);
+            triangle(ab, bc, ca, depth+1);
+            return;
+        }
+        vertex(a);
+        vertex(b);
+        vertex(c);
+    }
+
+    SvgGeometry &       geometry;
+    const QGradient *   gradient;
+    QTransform          toBrush;
+    coord               flatness;
+    qreal               opacity;
+    coord               maxEdge;
+    GLfloat             rgba[4];
+};
+
+
+
+// ============================================================================
+//
+//   SvgGeometry: import of a document
+//
+// ============================================================================
+
+bool SvgGeometry::import(QSvgRenderer &renderer)
+// ----------------------------------------------------------------------------
+//   Record and tessellate everything the renderer paints
+// ----------------------------------------------------------------------------
+{
+    QSize size = renderer.defaultSize();
+    if (size.width() <= 0 || size.height() <= 0)
+        return false;
+
+    // Flatten curves as if the document was about 2048 pixels large
+    width = size.width();
+    height = size.height();
+    flatness = 2048.0 / (width > height ? width : height);
+    if (flatness < 1.0)
+        flatness = 1.0;
+
+    SvgRecordingDevice device(*this, size);
+    QPainter painter(&device);
+    renderer.render(&painter);
+    painter.end();
+    return true;
+}
+
+
+void SvgGeometry::addPath(const QPainterPath &path,
+                          const QBrush &brush, const QPen &pen,
+                          const QTransform &transform, qreal opacity)
+// ----------------------------------------------------------------------------
+//   Add the fill and the stroke of a path painted with the given attributes
+// ----------------------------------------------------------------------------
+{
+    fill(path, brush, transform, opacity);
+
+    if (pen.style() == Qt::NoPen || pen.brush().style() == Qt::NoBrush)
+        return;
+
+    // Flatten the stroke as finely as fills, in path coordinates
+    qreal pathScale = sqrt(fabs(transform.determinant())) * flatness;
+    QPainterPathStroker stroker;
+    stroker.setWidth(pen.widthF() > 0 ? pen.widthF() : 1.0);
+    stroker.setCapStyle(pen.capStyle());
+    stroker.setJoinStyle(pen.joinStyle());
+    stroker.setMiterLimit(pen.miterLimit());
+    if (pen.style() == Qt::CustomDashLine)
+        stroker.setDashPattern(pen.dashPattern());
+    else
+        stroker.setDashPattern(pen.style());
+    stroker.setDashOffset(pen.dashOffset());
+    if (pathScale > 0)
+        stroker.setCurveThreshold(0.25 / pathScale);
+    QPainterPath stroke = stroker.createStroke(path);
+    stroke.setFillRule(Qt::WindingFill);
+    fill(stroke, pen.brush(), transform, opacity);
+}
+
+
+void SvgGeometry::fill(const QPainterPath &path, const QBrush &brush,
+                       const QTransform &transform, qreal opacity)
+// ----------------------------------------------------------------------------
+//   Tessellate a path and emit triangles colored by the brush
+// ----------------------------------------------------------------------------
+{
+    if (brush.style() == Qt::NoBrush || path.isEmpty())
+        return;
+
+    // Flatten in a scaled-up space so that curves remain smooth when zoomed
+    QTransform toFlat = transform * QTransform::fromScale(flatness, flatness);
+    QList<QPolygonF> polygons = path.toSubpathPolygons(toFlat);
+    SvgTessellation tess;
+    tessellate(polygons, path.fillRule(), tess);
+
+    // Gradients are defined in path coordinates, possibly relative to the
+    // bounding box of the path, and transformed by the brush transform
+    QTransform toBrush = toFlat.inverted();
+    if (const QGradient *gradient = brush.gradient())
+    {
+        if (gradient->coordinateMode() == QGradient::ObjectBoundingMode)
+        {
+            QRectF r = path.boundingRect();
+            toBrush *= QTransform(r.width(), 0, 0, r.height(),
+                                  r.x(), r.y()).inverted();
+        }
+        toBrush *= brush.transform().inverted();
+    }
+
+    QRectF flatBounds = toFlat.mapRect(path.boundingRect());
+    coord maxEdge = (flatBounds.width() + flatBounds.height()) / 16 + 1;
+    SvgPainter painter(*this, brush, toBrush, opacity, maxEdge);
+    std::vector<Point3 *> &triangles = tess.triangles;
+    uint count = triangles.size() / 3 * 3;
+    for (uint i = 0; i < count; i += 3)
+        painter.triangle(*triangles[i], *triangles[i+1], *triangles[i+2]);
+}
+
+
+
+// ============================================================================
+//
+//   SvgGeometry: cache shared by all SVG shapes
+//
+// ============================================================================
+
+SvgGeometry::Ref SvgGeometry::geometry(text file)
+// ----------------------------------------------------------------------------
+//   Return the geometry for a file, importing it if new or changed
+// ----------------------------------------------------------------------------
+{
+    QString svgFile(+file);
+    QFileInfo fi(svgFile);
+    QDateTime modified;
+
+    // Check modification date of files at most once per second
+    uint now = QDateTime::currentDateTime().toTime_t();
+    entry_map::iterator found = entries.find(file);
+    if (found != entries.end())
+    {
+        Entry &entry = (*found).second;
+        entry.lastUse = ++useCount;
+        if (entry.checked == now)
+            return entry.geometry;
+        entry.checked = now;
+        modified = fi.exists() ? fi.lastModified() : QDateTime();
+        if (modified == entry.modified)
+            return entry.geometry;
+        totalBytes -= entry.geometry->bytes();
+        entries.erase(found);
+    }
+    else
+    {
+        modified = fi.exists() ? fi.lastModified() : QDateTime();
+    }
+
+    if (!fi.isReadable())
+        svgFile = "svg:" + svgFile;
+    Ref geometry(new SvgGeometry);
+    QSvgRenderer renderer(svgFile);
+    if (!renderer.isValid() || !geometry->import(renderer))
+    {
+        geometry = Ref(new SvgGeometry);
+        geometry->import(*SvgRendererInfo::defaultImageRenderer());
+    }
+    Vertices(geometry->vertices).swap(geometry->vertices);
+
+    ulong bytes = geometry->bytes();
+    evict(bytes);
+    Entry &entry = entries[file];
+    entry.geometry = geometry;
+    entry.modified = modified;
+    entry.checked = now;
+    entry.lastUse = ++useCount;
+    totalBytes += bytes;
+    return geometry;
+}
+
+
+void SvgGeometry::evict(ulong needed)
+// ----------------------------------------------------------------------------
+//   Evict least recently used geometry until 'needed' bytes fit in budget
+// ----------------------------------------------------------------------------
+{
+    while (totalBytes + needed > MAX_BYTES && !entries.empty())
+    {
+        entry_map::iterator i, lru = entries.begin();
+        for (i = entries.begin(); i != entries.end(); i++)
+            if ((*i).second.lastUse < (*lru).second.lastUse)
+                lru = i;
+        totalBytes -= (*lru).second.geometry->bytes();
+        entries.erase(lru);
+    }
+}
+
+
+
+// ============================================================================
+//
+//   SvgShape: drawing the geometry
+//
+// ============================================================================
+
+QGLShaderProgram *SvgShape::fadeProgram = NULL;
+bool              SvgShape::fadeFailed  = false;
+
+
+QGLShaderProgram *SvgShape::FadeProgram()
+// ----------------------------------------------------------------------------
+//   Return the shader scaling vertex alpha by the layout visibility
+// ----------------------------------------------------------------------------
+{
+    if (!fadeProgram && !fadeFailed)
+    {
+        fadeFailed = true;
+        if (!QGLShaderProgram::hasOpenGLShaderPrograms())
+            return NULL;
+
+        fadeProgram = new QGLShaderProgram();
+        QString path = Application::applicationDirPath();
+        QString vs = path + "/svg_fade.vs";
+        QString fs = path + "/svg_fade.fs";
+        if (fadeProgram->addShaderFromSourceFile(QGLShader::Vertex, vs) &&
+            fadeProgram->addShaderFromSourceFile(QGLShader::Fragment, fs) &&
+            fadeProgram->link())
+        {
+            fadeFailed = false;
+        }
+        else
+        {
+            std::cerr << "Error loading SVG fade shader: "
+                      << +fadeProgram->log();
+            delete fadeProgram;
+            fadeProgram = NULL;
+        }
+    }
+    return fadeProgram;
+}
+
+
+void SvgShape::Draw(Layout *where)
+// ----------------------------------------------------------------------------
+//   Draw the pre-tessellated triangles scaled to the shape bounds
+// ----------------------------------------------------------------------------
+{
+    SvgGeometry::Vertices &data = geometry->vertices;
+    scale v = where->visibility;
+    if (data.empty() || v <= 0.0)
+        return;
+
+    // Draw in the same pass as a shape with the same transparency
+    bool transparent = geometry->transparent || v < 1.0;
+    bool render = where->blendOrShade
+        ? !where->transparency
+        : where->transparency == transparent;
+    if (!render)
+        return;
+
+    GLAllStateKeeper save;
+    Box3 b = Bounds(where);
+    GL.Translate(b.lower.x, b.upper.y, b.lower.z);
+    GL.Scale(b.Width() / geometry->width, b.Height() / geometry->height, 1);
+    GL.LoadMatrix();
+    GL.Disable(GL_TEXTURE_2D);
+    where->PolygonOffset(true);
+    GL.Sync();
+
+    // Fade out colors when the layout is not fully visible
+    SvgGeometry::Vertex *first = &data[0];
+    SvgGeometry::Vertices faded;
+    QGLShaderProgram *fade = NULL;
+    if (v < 1.0)
+    {
+        fade = FadeProgram();
+        if (fade)
+        {
+            GL.UseProgram(fade->programId());
+            GL.Uniform(GL.GetUniformLocation(fade->programId(), "visibility"),
+                       (float) v);
+        }
+        else
+        {
+            // No shader support: fade a copy of the colors
+            faded = data;
+            for (uint i = 0; i < faded.size(); i++)
+                faded[i].a *= v;
+            first = &faded[0];
+        }
+    }
+
+    GLsizei stride = sizeof(SvgGeometry::Vertex);
+    GL.VertexPointer(2, GL_FLOAT, stride, &first->x);
+    GL.ColorPointer(4, GL_FLOAT, stride, &first->r);
+    GL.EnableClientState(GL_VERTEX_ARRAY);
+    GL.EnableClientState(GL_COLOR_ARRAY);
+    GL.DrawArrays(GL_TRIANGLES, 0, data.size());
+    GL.DisableClientState(GL_COLOR_ARRAY);
+    GL.DisableClientState(GL_VERTEX_ARRAY);
+    if (fade)
+        GL.UseProgram(where->programId);
+
+    // The color array left the current color undefined
+    GL.Invalidate(STATE_color);
+}
+
+TAO_END
@@ -0,0 +1,133 @@
+#ifndef SVG_SHAPE_H
+#define SVG_SHAPE_H
+// *****************************************************************************
+// svg_shape.h                                                     Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Import of SVG documents as tessellated vector geometry, so that they
+//     can be drawn crisp at any zoom level without being rasterized.
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "shapes.h"
+#include "tao_gl.h"
+#include <QSharedPointer>
+#include <QDateTime>
+#include <QTransform>
+#include <QGLShaderProgram>
+#include <map>
+#include <vector>
+
+class QPainterPath;
+class QBrush;
+class QPen;
+class QSvgRenderer;
+
+TAO_BEGIN
+
+struct SvgGeometry
+// ----------------------------------------------------------------------------
+//   An SVG document converted to colored triangles, shared by all shapes
+// ----------------------------------------------------------------------------
+//   The document is painted once by QSvgRenderer into a recording paint
+//   device, and each filled or stroked path is tessellated with GLU.
+//   Curves are flattened finely enough for the icon to remain smooth when
+//   zoomed in. Gradients are evaluated at each vertex, large triangles
+//   being subdivided so that the color interpolation stays close.
+//   Images embedded in the SVG and clipping are not converted.
+{
+    struct Vertex
+    {
+        GLfloat         x, y;
+        GLfloat         r, g, b, a;
+    };
+    typedef std::vector<Vertex>                 Vertices;
+    typedef QSharedPointer<SvgGeometry>         Ref;
+    enum { MAX_BYTES = 32 * 1024 * 1024 };
+
+    SvgGeometry(): width(0), height(0), flatness(1), transparent(false) {}
+
+    bool                import(QSvgRenderer &renderer);
+    void                addPath(const QPainterPath &path,
+                                const QBrush &brush, const QPen &pen,
+                                const QTransform &transform, qreal opacity);
+    void                fill(const QPainterPath &path, const QBrush &brush,
+                             const QTransform &transform, qreal opacity);
+    ulong               bytes() { return vertices.size() * sizeof(Vertex); }
+
+public:
+    Vertices            vertices;       // GL_TRIANGLES, y axis pointing up
+    coord               width, height;  // Size of the SVG document
+    coord               flatness;       // Scale applied before flattening
+    bool                transparent;    // Some vertices are not opaque
+
+public:
+    static Ref          geometry(text file);
+    static ulong        cacheBytes()    { return totalBytes; }
+
+private:
+    struct Entry
+    {
+        Entry(): checked(0), lastUse(0) {}
+        Ref             geometry;
+        QDateTime       modified;
+        uint            checked;        // Last check of 'modified', in s
+        uint            lastUse;
+    };
+    typedef std::map<text, Entry>       entry_map;
+
+    static void         evict(ulong needed);
+
+    static entry_map    entries;
+    static ulong        totalBytes;
+    static uint         useCount;
+};
+
+
+struct SvgShape : Rectangle
+// ----------------------------------------------------------------------------
+//    An SVG document drawn as vector geometry in the given rectangle
+// ----------------------------------------------------------------------------
+{
+    SvgShape(SvgGeometry::Ref geometry, const Box &b)
+        : Rectangle(b), geometry(geometry) {}
+    virtual void        Draw(Layout *where);
+
+    SvgGeometry::Ref    geometry;
+
+private:
+    static QGLShaderProgram *FadeProgram();
+    static QGLShaderProgram *fadeProgram;
+    static bool             fadeFailed;
+};
+
+TAO_END
+
+#endif // SVG_SHAPE_H
@@ -51,7 +51,9 @@ Table::Table(Widget *w, Context *ctx, Real_p x, Real_p y, uint r, uint c)
     : Layout(w), context(ctx),
       x(x), y(y), rows(r), columns(c), row(0), column(0),
       margins(0,0,5,5), columnWidth(), rowHeight(),
-      fill(NULL), border(NULL), fills(), borders()
+      fill(NULL), border(NULL), fills(), borders(),
+      totalRows(r), firstRow(0), rowsTop(0), viewHeight(0), fixedRowHeight(0),
+      cache()
 {}
 
 
@@ -95,7 +97,7 @@ void Table::Evaluate(Layout *where)
     coord   x0 = double(x) - bounds.Width()/2;
     coord   y0 = double(y) - bounds.Height()/2;
     coord   px = bounds.lower.x + x0;
-    coord   py = bounds.upper.y + y0;
+    coord   py = bounds.upper.y + y0 - rowsTop;
 
 
     // Loop on all cell items, creating the layouts for the fill and border
@@ -105,6 +107,7 @@ void Table::Evaluate(Layout *where)
         if (row < rowHeight.size())
             py -= rowHeight[row];
         py -= margins.Height();
+        bool visible = RowVisible(py, row);
 
         for (column = 0; column < columns; column++)
         {
@@ -118,12 +121,14 @@ void Table::Evaluate(Layout *where)
             cellBox = Box(cellX-cellW/2, cellY-cellH/2, cellW, cellH);
 
             Layout *fillLayout = NULL;
-            if (Tree_p fill = *fi++)
+            Tree_p fill = *fi++;
+            if (fill && visible)
                 fillLayout = widget->drawTree(this, context, fill);
             fills.push_back(fillLayout);
 
             Layout *borderLayout = NULL;
-            if (Tree_p border = *bi++)
+            Tree_p border = *bi++;
+            if (border && visible)
                 borderLayout = widget->drawTree(this, context, border);
             borders.push_back(borderLayout);
 
@@ -146,7 +151,7 @@ void Table::Draw(Layout *where)
     coord   x0 = double(x) - bounds.Width()/2;
     coord   y0 = double(y) - bounds.Height()/2;
     coord   px = bounds.lower.x + x0;
-    coord   py = bounds.upper.y + y0;
+    coord   py = bounds.upper.y + y0 - rowsTop;
     uint    r, c;
     Widget *widget = where->Display();
     Drawings::iterator i = items.begin();
@@ -166,6 +171,7 @@ void Table::Draw(Layout *where)
             py -= rowHeight[r];
         py -= margins.Height();
         row = r;
+        bool visible = RowVisible(py, r);
         for (c = 0; c < columns; c++)
         {
             bool atEnd = i == items.end();
@@ -193,7 +199,7 @@ void Table::Draw(Layout *where)
                 if (Layout *fillLayout = *fi++)
                     fillLayout->Draw(where);
 
-            if (d)
+            if (d && visible)
             {
                 XL::Save<Point3> saveOffset(offset, pos + where->offset);
                 d->Draw(this);
@@ -222,7 +228,7 @@ void Table::DrawSelection(Layout *where)
     coord   x0 = double(x) - bounds.Width()/2;
     coord   y0 = double(y) - bounds.Height()/2;
     coord   px = bounds.lower.x + x0;
-    coord   py = bounds.upper.y + y0;
+    coord   py = bounds.upper.y + y0 - rowsTop;
     uint    r, c;
     Widget *widget = where->Display();
     Drawings::iterator i = items.begin();
@@ -235,6 +241,7 @@ void Table::DrawSelection(Layout *where)
             py -= rowHeight[r];
         py -= margins.Height();
         row = r;
+        bool visible = RowVisible(py, r);
         for (c = 0; c < columns; c++)
         {
             bool atEnd = i == items.end();
@@ -258,7 +265,7 @@ void Table::DrawSelection(Layout *where)
                 pos.y += (rowHeight[r]-bb.Height()) * cell->alongY.centering;
             }
 
-            if (d)
+            if (d && visible)
             {
                 XL::Save<Point3> saveOffset(offset, where->offset + pos);
                 d->DrawSelection(this);
@@ -283,7 +290,7 @@ void Table::Identify(Layout *where)
     coord   x0 = double(x) - bounds.Width()/2;
     coord   y0 = double(y) - bounds.Height()/2;
     coord   px = bounds.lower.x + x0;
-    coord   py = bounds.upper.y + y0;
+    coord   py = bounds.upper.y + y0 - rowsTop;
     uint    r, c;
     Widget *widget = where->Display();
     Drawings::iterator i = items.begin();
@@ -296,6 +303,7 @@ void Table::Identify(Layout *where)
             py -= rowHeight[r];
         py -= margins.Height();
         row = r;
+        bool visible = RowVisible(py, r);
         for (c = 0; c < columns; c++)
         {
             bool atEnd = i == items.end();
@@ -319,7 +327,7 @@ void Table::Identify(Layout *where)
                 pos.y += (rowHeight[r]-bb.Height()) * cell->alongY.centering;
             }
 
-            if (d)
+            if (d && visible)
             {
                 XL::Save<Point3> saveOffset(offset, where->offset + pos);
                 d->Identify(this);
@@ -437,13 +445,25 @@ void Table::Compute(Layout *where)
     for (c = 0; c < columns; c++)
     {
         columnWidth[c] = colBB[c].Width();
+        if (cache)
+        {
+            // Virtual table: keep the widest column seen so far
+            scale &cached = cache->widths[c];
+            if (cached > columnWidth[c])
+                columnWidth[c] = cached;
+            cached = columnWidth[c];
+        }
         bb.upper.x += columnWidth[c] + margins.Width();
     }
     for (r = 0; r < rows; r++)
     {
-        rowHeight[r] = rowBB[r].Height();
+        rowHeight[r] = fixedRowHeight > 0 ? fixedRowHeight : rowBB[r].Height();
         bb.upper.y += rowHeight[r] + margins.Height();
+        if (cache)
+            cache->SetRowHeight(firstRow + r, rowHeight[r]);
     }
+    if (viewHeight > 0)
+        bb.upper.y = viewHeight;
     bounds = bb;
 
     // Restore original state for the caller
@@ -451,6 +471,19 @@ void Table::Compute(Layout *where)
 }
 
 
+bool Table::RowVisible(coord bottom, uint r)
+// ----------------------------------------------------------------------------
+//   Check if a row intersects the visible region of a virtual table
+// ----------------------------------------------------------------------------
+{
+    if (viewHeight <= 0)
+        return true;
+    coord top = bottom + rowHeight[r] + margins.Height();
+    coord viewTop = bounds.upper.y + double(y) - bounds.Height()/2;
+    return top > viewTop - viewHeight && bottom < viewTop;
+}
+
+
 void Table::NextCell()
 // ----------------------------------------------------------------------------
 //   Increase row and column for the next cell
@@ -466,6 +499,64 @@ void Table::NextCell()
     }
 }
 
+
+
+
+// ============================================================================
+//
+//   Row cache for virtual tables
+//
+// ============================================================================
+
+void TableRowCache::Resize(uint rows, uint columns)
+// ----------------------------------------------------------------------------
+//   Adjust the number of rows and columns, forgetting removed ones
+// ----------------------------------------------------------------------------
+{
+    for (uint r = rows; r < heights.size(); r++)
+    {
+        if (heights[r] > 0)
+        {
+            measured--;
+            measuredSum -= heights[r];
+        }
+    }
+    heights.resize(rows, 0);
+    widths.resize(columns, 0);
+}
+
+
+scale TableRowCache::RowHeight(uint row)
+// ----------------------------------------------------------------------------
+//   Return the fixed, measured or estimated height for a row
+// ----------------------------------------------------------------------------
+{
+    if (fixedRowHeight > 0)
+        return fixedRowHeight;
+    if (row < heights.size() && heights[row] > 0)
+        return heights[row];
+    return measured ? measuredSum / measured : 0;
+}
+
+
+void TableRowCache::SetRowHeight(uint row, scale height)
+// ----------------------------------------------------------------------------
+//   Record the measured height of a row
+// ----------------------------------------------------------------------------
+{
+    if (row >= heights.size() || height <= 0)
+        return;
+    scale &h = heights[row];
+    if (h > 0)
+    {
+        measured--;
+        measuredSum -= h;
+    }
+    h = height;
+    measured++;
+    measuredSum += h;
+}
+
 TAO_END
 
 
@@ -42,9 +42,48 @@
 #include "drawing.h"
 #include "layout.h"
 #include "tao_tree.h"
+#include <QSharedPointer>
 
 TAO_BEGIN
 
+struct TableRowCache
+// ----------------------------------------------------------------------------
+//    Row heights and column widths of a virtual table, kept across refreshes
+// ----------------------------------------------------------------------------
+//    Rows that were never measured are assumed to be of the average height
+//    of the rows measured so far. Column widths only grow, so that columns
+//    do not move while scrolling.
+{
+    TableRowCache()
+        : fixedRowHeight(0), margins(0,0,5,5), measured(0), measuredSum(0) {}
+
+    void                Resize(uint rows, uint columns);
+    scale               RowHeight(uint row);
+    void                SetRowHeight(uint row, scale height);
+
+public:
+    std::vector<scale>  heights;        // 0 if row was never measured
+    std::vector<scale>  widths;
+    scale               fixedRowHeight; // Height of all rows, or 0
+    Box                 margins;        // Cell margins in last evaluation
+    uint                measured;
+    scale               measuredSum;
+};
+typedef QSharedPointer<TableRowCache> TableRowCache_p;
+
+
+struct TableRowCacheInfo : XL::Info
+// ----------------------------------------------------------------------------
+//    Attach the row cache of a virtual table to its source tree
+// ----------------------------------------------------------------------------
+{
+    typedef TableRowCacheInfo *data_t;
+    TableRowCacheInfo(): cache(new TableRowCache) {}
+    operator data_t() { return this; }
+    TableRowCache_p     cache;
+};
+
+
 struct Table : Layout
 // ----------------------------------------------------------------------------
 //    A table-like layout for graphic elements
@@ -55,6 +94,7 @@ struct Table : Layout
 
     virtual void        Draw(Layout *);
     virtual void        DrawSelection(Layout *);
+    virtual bool        CachedBounds(Box3 &)  { return false; }
     virtual void        Evaluate(Layout *);
     virtual void        Identify(Layout *);
     virtual Box3        Bounds(Layout *);
@@ -63,6 +103,7 @@ struct Table : Layout
     virtual void        Add (Drawing *d);
 
     void                NextCell();
+    bool                RowVisible(coord bottom, uint row);
 
 public:
     Context_p              context;
@@ -79,6 +120,14 @@ public:
     Tree_p                 fill, border;
     TreeList               cellFill, cellBorder;
     Layouts                fills, borders;
+
+    // Virtual tables only contain the rows intersecting the visible region
+    uint                   totalRows;      // Including rows not evaluated
+    uint                   firstRow;       // Index of first evaluated row
+    coord                  rowsTop;        // Top of first row below top
+    coord                  viewHeight;     // Height of visible region, or 0
+    scale                  fixedRowHeight; // Height of all rows, or 0
+    TableRowCache_p        cache;
 };
 
 
@@ -135,6 +135,10 @@ void TextSplit::Draw(Layout *where)
     // Check if we activated new texture units
     glyphs.CheckActiveLayout(where);
 
+    // Distance fields look good at any size, but need our own shader
+    if (glyphs.DistanceField())
+        badSize = where->programId != 0;
+
     if (!hasLine && !hasTexture && !badSize && cacheEnabled)
         DrawCached(where);
     else
@@ -159,19 +163,29 @@ void TextSplit::AddGlyph(coord x, coord y, coord z,
 //   Enter a glyph when generating a cached rendering
 // ----------------------------------------------------------------------------
 {
+    // Distance fields extend into the margin around the glyph
+    coord pad = 0, texPad = 0;
+    if (glyphs.DistanceField())
+    {
+        texPad = glyphs.sdfSpread;
+        pad = texPad * glyph.scalingFactor / glyphs.fontScaling;
+    }
+
     // Enter the geometry coordinates
-    coord charX1 = x + glyph.bounds.lower.x;
-    coord charX2 = x + glyph.bounds.upper.x;
-    coord charY1 = y - glyph.bounds.lower.y;
-    coord charY2 = y - glyph.bounds.upper.y;
+    coord charX1 = x + glyph.bounds.lower.x - pad;
+    coord charX2 = x + glyph.bounds.upper.x + pad;
+    coord charY1 = y - glyph.bounds.lower.y + pad;
+    coord charY2 = y - glyph.bounds.upper.y - pad;
     quads.push_back(Point3(charX1, charY1, z));
     quads.push_back(Point3(charX2, charY1, z));
     quads.push_back(Point3(charX2, charY2, z));
     quads.push_back(Point3(charX1, charY2, z));
 
     // Enter the texture coordinates
-    Point &texL = glyph.texture.lower;
-    Point &texU = glyph.texture.upper;
+    Point texL = glyph.texture.lower;
+    Point texU = glyph.texture.upper;
+    texL -= Vector(texPad, texPad);
+    texU += Vector(texPad, texPad);
     int tw = glyphs.Width(), th = glyphs.Height();
     texCoords.push_back(Point(texL.x/tw, texL.y/th));
     texCoords.push_back(Point(texU.x/tw, texL.y/th));
@@ -195,8 +209,11 @@ void TextSplit::DrawGlyphs(Layout *where,
     if (count && setFillColor(where))
     {
         // Bind the glyph texture
+        QGLShaderProgram *sdf = NULL;
+        if (glyphs.DistanceField())
+            sdf = glyphs.DistanceFieldProgram();
         GL.BindTexture(GL_TEXTURE_2D, glyphs.Texture());
-        if (font.pointSizeF() < glyphs.minFontSizeForAntialiasing)
+        if (!sdf && font.pointSizeF() < glyphs.minFontSizeForAntialiasing)
         {
             GL.TexParameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             GL.TexParameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -209,17 +226,18 @@ void TextSplit::DrawGlyphs(Layout *where,
         GL.ClientActiveTexture(GL_TEXTURE0);
 
         // Draw a list of rectangles with the textures
-        GL.VertexPointer(3, GL_DOUBLE, 0, &quads[0].x);
-        GL.TexCoordPointer(2, GL_DOUBLE, 0, &texCoords[0].x);
-        GL.EnableClientState(GL_VERTEX_ARRAY);
-        GL.EnableClientState(GL_TEXTURE_COORD_ARRAY);
+        GL.StreamArrays(count, &quads[0].x, 0, NULL, 0,
+                        &texCoords[0].x, 2, 0, 1);
 
         // Load model view matrix
         GL.LoadMatrix();
+        if (sdf)
+            GL.UseProgram(sdf->programId());
         GL.DrawArrays(GL_QUADS, 0, count);
+        if (sdf)
+            GL.UseProgram(where->programId);
 
-        GL.DisableClientState(GL_VERTEX_ARRAY);
-        GL.DisableClientState(GL_TEXTURE_COORD_ARRAY);
+        GL.StreamDone();
         GL.Disable(GL_TEXTURE_2D);
     }
 }
@@ -490,11 +508,11 @@ void TextSplit::DrawDirect(Layout *where)
                     GL.Translate(0.0, 0.0, -where->extrudeDepth);
                     GL.Scale(1, 1, -1);
                     GL.FrontFace(GL_CCW);
-                    GL.CallList(glyph.interior);
+                    glyph.mesh->Draw(glyph.interior);
                     GL.polycount += glyph.polycount;
                     GL.Restore(save);
                     GL.FrontFace(GL_CW);
-                    GL.CallList(glyph.interior);
+                    glyph.mesh->Draw(glyph.interior);
                     GL.polycount += glyph.polycount;
                     GL.FrontFace(GL_CCW);
                 }
@@ -503,7 +521,7 @@ void TextSplit::DrawDirect(Layout *where)
                 if (hasFill || hasLine)
                 {
                     GL.FrontFace(GL_CW);
-                    GL.CallList(glyph.outline);
+                    glyph.mesh->Draw(glyph.outline);
                     GL.FrontFace(GL_CCW);
                 }
             }
@@ -511,11 +529,11 @@ void TextSplit::DrawDirect(Layout *where)
             {
                 if (setFillColor(where))
                 {
-                    GL.CallList(glyph.interior);
+                    glyph.mesh->Draw(glyph.interior);
                     GL.polycount += glyph.polycount;
                 }
                 if (lw > 0.0 && setLineColor(where))
-                    GL.CallList(glyph.outline);
+                    glyph.mesh->Draw(glyph.outline);
             }
 
             if (!rtl)
@@ -590,11 +608,11 @@ void TextSplitArabic::DrawDirect(Layout *where)
                 GL.Translate(0.0, 0.0, -where->extrudeDepth);
                 GL.Scale(1, 1, -1);
                 GL.FrontFace(GL_CCW);
-                GL.CallList(glyph.interior);
+                glyph.mesh->Draw(glyph.interior);
                 GL.polycount += glyph.polycount;
                 GL.Restore(save);
                 GL.FrontFace(GL_CW);
-                GL.CallList(glyph.interior);
+                glyph.mesh->Draw(glyph.interior);
                 GL.polycount += glyph.polycount;
                 GL.FrontFace(GL_CCW);
             }
@@ -603,7 +621,7 @@ void TextSplitArabic::DrawDirect(Layout *where)
             if (hasFill || hasLine)
             {
                 GL.FrontFace(GL_CW);
-                GL.CallList(glyph.outline);
+                glyph.mesh->Draw(glyph.outline);
                 GL.FrontFace(GL_CCW);
             }
         }
@@ -611,11 +629,11 @@ void TextSplitArabic::DrawDirect(Layout *where)
         {
             if (setFillColor(where))
             {
-                GL.CallList(glyph.interior);
+                glyph.mesh->Draw(glyph.interior);
                 GL.polycount += glyph.polycount;
             }
             if (lw > 0.0 && setLineColor(where))
-                GL.CallList(glyph.outline);
+                glyph.mesh->Draw(glyph.outline);
         }
     }
 
@@ -46,6 +46,7 @@
 #include "widget.h"
 #include "gl_keepers.h"
 #include <QtEndian>
+#include <QImageReader>
 
 namespace Tao {
 
@@ -98,6 +99,7 @@ XL::Name_p TextureCache::fn(bool enable)                                    \
 BOOL_SETTER(textureMipmap, mipmap)
 BOOL_SETTER(textureCompress, compress)
 BOOL_SETTER(textureSaveCompressed, saveCompressed)
+BOOL_SETTER(textureStreaming, streaming)
 
 
 // ----------------------------------------------------------------------------
@@ -152,11 +154,18 @@ TextureCache::TextureCache()
       minFilt(PerformancesPage::texture2DMinFilter()),
       magFilt(PerformancesPage::texture2DMagFilter()),
       network(NULL), texChangedEvent(QEvent::registerEventType()),
-      fileMonitor("tex"), saveCompressed(false)
+      fileMonitor("tex"),
+      streaming(true), inFrame(false),
+      frame(0), decodes(0), maxDecodesPerFrame(2),
+      uploads(0), evictions(0), reloads(0),
+      lastUploads(0), lastEvictions(0), lastReloads(0),
+      saveCompressed(false),
+      store(TextureStore::instance())
 
 {
     statTimer.setSingleShot(true);
     connect(&statTimer, SIGNAL(timeout()), this, SLOT(doPrintStatistics()));
+    statsTime.start();
     IFTRACE2(texturecache, layoutevents)
         debug() << "ID of 'refresh' user event: " << texChangedEvent << "\n";
 
@@ -281,6 +290,7 @@ CachedTexture * TextureCache::load(const QString &img, const QString &docPath)
             printStatistics();
         }
     }
+    touch(cached);
 
     return cached;
 }
@@ -305,6 +315,7 @@ CachedTexture * TextureCache::bind(GLuint id)
     if (!cached)
         return NULL;
 
+    touch(cached);
     if (!cached->transferred())
     {
         if (!cached->loaded())
@@ -341,7 +352,7 @@ CachedTexture * TextureCache::bind(GLuint id)
 }
 
 
-void TextureCache::reload(CachedTexture *tex)
+void TextureCache::reload(CachedTexture *tex, bool streaming)
 // ----------------------------------------------------------------------------
 //   Reload from file or network
 // ----------------------------------------------------------------------------
@@ -349,7 +360,7 @@ void TextureCache::reload(CachedTexture *tex)
     tex->purge();
     if (memSize > maxMemSize)
         purgeMem();
-    if (tex->load())
+    if (tex->load(streaming))
     {
         insert(tex, memLRU);
         printStatistics();
@@ -397,38 +408,202 @@ void TextureCache::setMinFilter(GLuint id, GLenum filter)
 
 void TextureCache::purgeMem()
 // ----------------------------------------------------------------------------
-//   Drop the least recently used textures from main memory
+//   Drop the least valuable textures from main memory
 // ----------------------------------------------------------------------------
 {
     while (memSize > (maxMemSize * purgeRatio))
     {
         printStatistics();
-        XL_ASSERT(memLRU.last);
+        CachedTexture * tex = victim(memLRU);
+        if (!tex)
+            break;      // All remaining textures are used by current frame
 
-        CachedTexture * tex = memLRU.last->tex;
         unlink(tex, memLRU);
         tex->unload();
+        tex->evicted = true;
+        evictions++;
     }
 }
 
 
 void TextureCache::purgeGLMem()
 // ----------------------------------------------------------------------------
-//   Drop the least recently used items from texture memory
+//   Drop the least valuable items from texture memory
 // ----------------------------------------------------------------------------
 {
     while (GLSize > (maxGLSize * purgeRatio))
     {
         printStatistics();
-        XL_ASSERT(GL_LRU.last);
+        CachedTexture * tex = victim(GL_LRU);
+        if (!tex)
+            break;      // All remaining textures are used by current frame
 
-        CachedTexture * tex = GL_LRU.last->tex;
         unlink(tex, GL_LRU);
         tex->purgeGL();
+        tex->evicted = true;
+        evictions++;
     }
 }
 
 
+CachedTexture * TextureCache::victim(LRU &lru)
+// ----------------------------------------------------------------------------
+//   Select the texture to evict: not used for a long time, and large
+// ----------------------------------------------------------------------------
+//   Textures used in the current frame are never selected, since they would
+//   have to be reloaded immediately. Since touch() keeps the lists in order
+//   of use, they are all at the head of the list, and only a few textures at
+//   the tail need to be scored. Among textures with the same score, the least
+//   recently used one wins.
+{
+    CachedTexture *best = NULL;
+    quint64 bestScore = 0;
+    bool gl = (&lru == &GL_LRU);
+    uint candidates = VICTIM_CANDIDATES;
+
+    for (CachedTexture::Links *l = lru.last; l && candidates; l = l->prev)
+    {
+        CachedTexture *tex = l->tex;
+        if (pinned(tex))
+            break;
+        quint64 size = gl ? tex->GLsize : tex->image.byteCount();
+        quint64 score = (quint64) (frame - tex->lastUse + 1) * (size + 1);
+        if (score > bestScore)
+        {
+            best = tex;
+            bestScore = score;
+        }
+        candidates--;
+    }
+    return best;
+}
+
+
+bool TextureCache::pinned(CachedTexture *tex)
+// ----------------------------------------------------------------------------
+//   Check if a texture is used by the frame being drawn
+// ----------------------------------------------------------------------------
+{
+    return inFrame && tex->lastUse == frame;
+}
+
+
+void TextureCache::touch(CachedTexture *tex)
+// ----------------------------------------------------------------------------
+//   Record that a texture is used in the current frame and page
+// ----------------------------------------------------------------------------
+//   The texture moves to the head of the LRU lists it is in.
+{
+    tex->lastUse = frame;
+    if (linked(tex, memLRU))
+        relink(tex, memLRU);
+    if (linked(tex, GL_LRU))
+        relink(tex, GL_LRU);
+    if (inFrame && page != "")
+        pageTextures[page].insert(tex->id);
+}
+
+
+void TextureCache::beginFrame(const QString &pageName)
+// ----------------------------------------------------------------------------
+//   Start drawing a frame: textures used from now on are pinned
+// ----------------------------------------------------------------------------
+{
+    frame++;
+    decodes = 0;
+    inFrame = true;
+    page = pageName;
+}
+
+
+bool TextureCache::endFrame(const QString &nextPage)
+// ----------------------------------------------------------------------------
+//   Refine low-resolution textures and prefetch textures of the next page
+// ----------------------------------------------------------------------------
+//   Returns true if there is more work to do in the following frames.
+//   Textures of the next page are those recorded the last time it was shown.
+{
+    bool refined = false;
+    while (decodes < maxDecodesPerFrame && !refineQueue.isEmpty())
+    {
+        CachedTexture *tex = fromId.value(refineQueue.takeFirst());
+        if (!tex || !tex->lowRes)
+            continue;
+
+        IFTRACE(texturecache)
+            debug() << "Refining '" << +tex->path << "'\n";
+        reload(tex, false);
+        decodes++;
+        refined = true;
+    }
+
+    bool pending = !refineQueue.isEmpty();
+    if (streaming && !refined && nextPage != page &&
+        pageTextures.contains(nextPage))
+    {
+        foreach (GLuint id, pageTextures[nextPage])
+        {
+            CachedTexture *tex = fromId.value(id);
+            if (!tex || tex->networked || tex->transferred())
+                continue;
+            if (decodes >= maxDecodesPerFrame)
+            {
+                pending = true;
+                break;
+            }
+
+            if (!tex->loaded())
+            {
+                if (memSize > maxMemSize)
+                    purgeMem();
+                if (!tex->load(false))
+                    continue;
+                insert(tex, memLRU);
+                decodes++;
+            }
+
+            // Prefetching must not evict textures of the current page
+            if (GLSize + tex->image.byteCount() <= maxGLSize)
+            {
+                tex->transfer();
+                insert(tex, GL_LRU);
+            }
+            tex->lastUse = frame;
+
+            IFTRACE(texturecache)
+                debug() << "Prefetched '" << +tex->path << "' for page '"
+                        << +nextPage << "'\n";
+        }
+    }
+
+    inFrame = false;
+    countFrame();
+    return refined || pending;
+}
+
+
+void TextureCache::countFrame()
+// ----------------------------------------------------------------------------
+//   Update per-second statistics
+// ----------------------------------------------------------------------------
+{
+    if (statsTime.elapsed() < 1000)
+        return;
+
+    lastUploads = uploads;
+    lastEvictions = evictions;
+    lastReloads = reloads;
+    uploads = evictions = reloads = 0;
+    statsTime.restart();
+
+    IFTRACE(texturecache)
+        if (lastUploads || lastEvictions || lastReloads)
+            debug() << "Per second: " << lastUploads << " uploads, "
+                    << lastEvictions << " evictions, "
+                    << lastReloads << " reloads\n";
+}
+
+
 void TextureCache::clear()
 // ----------------------------------------------------------------------------
 //   Empty cache
@@ -447,6 +622,9 @@ void TextureCache::clear()
         unlink(tex, GL_LRU);
         delete tex;
     }
+    refineQueue.clear();
+    pageTextures.clear();
+
     XL_ASSERT(fromId.isEmpty());
     XL_ASSERT(fromName.isEmpty());
     XL_ASSERT(memSize == 0);
@@ -549,6 +727,16 @@ void TextureCache::relink(CachedTexture *tex, LRU &lru)
 }
 
 
+bool TextureCache::linked(CachedTexture *tex, LRU &lru)
+// ----------------------------------------------------------------------------
+//   Check if texture is in the given LRU list
+// ----------------------------------------------------------------------------
+{
+    CachedTexture::Links *t = texLinksForLRU(tex, lru);
+    return t->prev || lru.first == t;
+}
+
+
 void TextureCache::unlink(CachedTexture *tex, LRU &lru)
 // ----------------------------------------------------------------------------
 //   Remove texture from LRU list
@@ -589,10 +777,10 @@ CachedTexture::CachedTexture(TextureCache &cache, const QString &path,
 // ----------------------------------------------------------------------------
     : path(path), width(0), height(0),  mipmap(mipmap),
       compress(compress), isDefaultTexture(false),
-      networked(path.contains("://")),
+      networked(path.contains("://")), lowRes(false), lastUse(cache.frame),
       cache(cache), GLsize(0),
       memLRU(this), GLmemLRU(this), saveCompressed(cache.saveCompressed),
-      networkReply(NULL), inLoad(false)
+      evicted(false), networkReply(NULL), inLoad(false)
 {
     GL.GenTextures(1, &id);
     if (networked)
@@ -629,10 +817,13 @@ CachedTexture::~CachedTexture()
 }
 
 
-bool CachedTexture::load()
+bool CachedTexture::load(bool streaming)
 // ----------------------------------------------------------------------------
 //   Load file into memory and update cached size. Return true if loaded.
 // ----------------------------------------------------------------------------
+//   When streaming and too many images were already decoded in this frame,
+//   a low-resolution version is loaded if the decoder can do it cheaply.
+//   The texture cache then refines it in a later frame.
 {
     XL_ASSERT(!loaded());
 
@@ -642,6 +833,8 @@ bool CachedTexture::load()
 
     int size = 0;
     bool inProgress = false;
+    QSize fullSize;
+    lowRes = false;
     if (networked)
     {
         if (networkReply == NULL)
@@ -666,7 +859,25 @@ bool CachedTexture::load()
             inLoad = false;
         }
         if (canonicalPath != "")
-            image.load(canonicalPath, compress);
+        {
+            // Try the texture store first, then the '.compressed' file
+            if (!compress ||
+                !cache.store->load(canonicalPath, cache.cmpFormats, image))
+            {
+                if (streaming && cache.streaming && cache.inFrame &&
+                    cache.decodes >= cache.maxDecodesPerFrame &&
+                    image.loadScaled(canonicalPath, 256, &fullSize))
+                {
+                    lowRes = true;
+                    cache.refineQueue.append(id);
+                }
+                else
+                {
+                    image.load(canonicalPath, compress);
+                    cache.decodes++;
+                }
+            }
+        }
     }
     if (image.isNull())
     {
@@ -681,8 +892,9 @@ bool CachedTexture::load()
     }
     if (!image.isNull())
     {
-        width = image.width();
-        height = image.height();
+        // Report the full size for low-resolution textures, for layout
+        width = lowRes ? fullSize.width() : image.width();
+        height = lowRes ? fullSize.height() : image.height();
         size = image.byteCount();
     }
 
@@ -770,8 +982,18 @@ void CachedTexture::transfer()
     XL_ASSERT(!transferred());
     XL_ASSERT(id);
 
+    // Use the size of the image data, which is smaller than the size of
+    // the texture as seen by the layout for low-resolution textures
+    int w = image.width(), h = image.height();
     int before = image.byteCount();
 
+    cache.uploads++;
+    if (evicted)
+    {
+        cache.reloads++;
+        evicted = false;
+    }
+
     bool copiedCompressed = false, didNotCompress = false;
     int copiedSize = 0;
 
@@ -787,7 +1009,7 @@ void CachedTexture::transfer()
             if (mipmap)
                 GL.TexParameter(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
             TextureCache::instance()->setMinMagFilters(id);
-            GL.CompressedTexImage2D(GL_TEXTURE_2D, 0, image.fmt, width, height,
+            GL.CompressedTexImage2D(GL_TEXTURE_2D, 0, image.fmt, w, h,
                                     0, image.byteCount(), image.compressed);
             copiedSize = GLsize = image.byteCount();
             copiedCompressed = true;
@@ -805,9 +1027,9 @@ void CachedTexture::transfer()
                 GL.TexParameter(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
             TextureCache::instance()->setMinMagFilters(id);
             GL.TexImage2D(GL_TEXTURE_2D, 0, internalFmt,
-                          width, height, 0, GL_RGBA,
+                          w, h, 0, GL_RGBA,
                           GL_UNSIGNED_BYTE, texture.bits());
-            copiedSize = width * height * 4;
+            copiedSize = w * h * 4;
 
             GLint cmp = GL_FALSE, cmpsz = copiedSize;
             GL.GetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED,
@@ -825,8 +1047,8 @@ void CachedTexture::transfer()
                                           &image.fmt);
                 GL.GetCompressedTexImage(GL_TEXTURE_2D, 0,
                                          image.allocateCompressed(cmpsz));
-                image.w = width;
-                image.h = height;
+                image.w = w;
+                image.h = h;
             }
             else
             {
@@ -834,8 +1056,15 @@ void CachedTexture::transfer()
                 didNotCompress = true;
             }
 
-            if (!networked && saveCompressed && image.compressed &&
+            if (!networked && !lowRes && image.compressed &&
                 !image.loadedFromCompressedFile)
+            {
+                // Let the store write it to disk in the background
+                cache.store->save(canonicalPath, image);
+            }
+
+            if (!networked && !lowRes && saveCompressed &&
+                image.compressed && !image.loadedFromCompressedFile)
             {
                 QString cmpPath = Image::toCompressedPath(canonicalPath);
                 if (image.saveCompressed(cmpPath))
@@ -867,12 +1096,12 @@ void CachedTexture::transfer()
             GL.TexParameter(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
         TextureCache::instance()->setMinMagFilters(id);
         GL.TexImage2D(GL_TEXTURE_2D, 0, internalFmt,
-                     width, height, 0, GL_RGBA,
+                     w, h, 0, GL_RGBA,
                      GL_UNSIGNED_BYTE, texture.bits());
 
         XL_ASSERT(GLsize == 0);
-        GLsize = width * height * bytesPerPixel;
-        copiedSize = width * height * 4;
+        GLsize = w * h * bytesPerPixel;
+        copiedSize = w * h * 4;
         ADJUST_FOR_MIPMAP_OVERHEAD(GLsize);
     }
 
@@ -1174,6 +1403,31 @@ void Image::load(const QString &path, bool trycomp)
 }
 
 
+bool Image::loadScaled(const QString &path, int maxSize, QSize *full)
+// ----------------------------------------------------------------------------
+//   Load a reduced version of a large image, if the decoder does it cheaply
+// ----------------------------------------------------------------------------
+//   This is the case e.g. for JPEG, which can skip most of the decoding.
+//   Other formats would be fully decoded then scaled, which saves nothing.
+{
+    QImageReader reader(path);
+    QSize size = reader.size();
+    if (!size.isValid() ||
+        (size.width() <= maxSize && size.height() <= maxSize) ||
+        !reader.supportsOption(QImageIOHandler::ScaledSize))
+        return false;
+
+    if (compressed)
+        clear();
+    reader.setScaledSize(size.scaled(maxSize, maxSize, Qt::KeepAspectRatio));
+    if (!reader.read(&raw))
+        return false;
+
+    *full = size;
+    return true;
+}
+
+
 void Image::loadFromData(const QByteArray &data)
 // ----------------------------------------------------------------------------
 //   Load uncompressed image from byte array
@@ -1236,7 +1490,17 @@ bool Image::loadCompressed(const QString &path)
     if (!cmpfile.open(QIODevice::ReadOnly))
         return false;
 
-    QByteArray ba = cmpfile.readAll();
+    return loadCompressedData(cmpfile.readAll());
+}
+
+
+bool Image::loadCompressedData(const QByteArray &ba)
+// ----------------------------------------------------------------------------
+//   Load compressed texture data, as written by saveCompressed
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(!compressed);
+
     CompressedFileHeader *hdr = (CompressedFileHeader *)ba.constData();
 
     int len = ba.size() - sizeof(CompressedFileHeader);
@@ -1272,23 +1536,33 @@ bool Image::saveCompressed(const QString &compressedPath)
     QFile cmpfile(compressedPath);
     if (cmpfile.open(QIODevice::WriteOnly))
     {
-        CompressedFileHeader hdr;
-        hdr.signature = hdr.theSignature();
-        hdr.fmt = qToBigEndian((quint32)fmt);
-        hdr.w = qToBigEndian((quint32)w);
-        hdr.h = qToBigEndian((quint32)h);
-
-        if (cmpfile.write((const char*)&hdr, sizeof(hdr)) &&
-            cmpfile.write((const char*)compressed, sz) == sz)
-        {
+        QByteArray data = compressedData();
+        if (cmpfile.write(data) == data.size())
             ok = true;
-        }
         else
-        {
             cmpfile.remove();
-        }
     }
     return ok;
 }
 
+
+QByteArray Image::compressedData()
+// ----------------------------------------------------------------------------
+//   Header and compressed texture data, as stored on disk
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(compressed);
+    XL_ASSERT(sz);
+
+    CompressedFileHeader hdr;
+    hdr.signature = hdr.theSignature();
+    hdr.fmt = qToBigEndian((quint32)fmt);
+    hdr.w = qToBigEndian((quint32)w);
+    hdr.h = qToBigEndian((quint32)h);
+
+    QByteArray data((const char *)&hdr, sizeof(hdr));
+    data.append((const char *)compressed, sz);
+    return data;
+}
+
 }
@@ -41,11 +41,14 @@
 #include "tao_gl.h"
 #include "tao_tree.h"
 #include "file_monitor.h"
+#include "texture_store.h"
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
 #include <QMap>
 #include <QTimer>
+#include <QTime>
+#include <QSize>
 #include <QtNetwork>
 #include <QSet>
 #include <QSharedPointer>
@@ -80,13 +83,16 @@ struct Image
     int       height();
 
     void      load(const QString &path, bool trycomp = false);
+    bool      loadScaled(const QString &path, int maxSize, QSize *full);
     void      loadFromData(const QByteArray &data);
     void *    allocateCompressed(int len);
 
     static
     QString   toCompressedPath(const QString &path);
     bool      loadCompressed(const QString &path);
+    bool      loadCompressedData(const QByteArray &data);
     bool      saveCompressed(const QString &compressedPath);
+    QByteArray compressedData();
 
     struct CompressedFileHeader
     // ------------------------------------------------------------------------
@@ -137,7 +143,7 @@ public:
                   bool mipmap, bool compress);
     ~CachedTexture();
 
-    bool            load();
+    bool            load(bool streaming = true);
     void            unload();
 
     void            transfer();
@@ -177,6 +183,8 @@ public:
     bool            mipmap, compress;
     bool            isDefaultTexture;
     bool            networked;
+    bool            lowRes;     // Loaded at reduced size, to be refined
+    uint            lastUse;    // Frame where texture was last used
 
 private:
     TextureCache &  cache;
@@ -185,6 +193,7 @@ private:
 
     Image           image;
     bool            saveCompressed;
+    bool            evicted;    // Purged from GL to make room for others
     QNetworkReply  *networkReply;
 
     bool            inLoad;
@@ -208,6 +217,7 @@ public:
     static XL::Name_p    textureMipmap(bool enable);
     static XL::Name_p    textureCompress(bool enable);
     static XL::Name_p    textureSaveCompressed(bool enable);
+    static XL::Name_p    textureStreaming(bool enable);
 
     static XL::Integer_p textureCacheMemSize(quint64 bytes);
     static XL::Integer_p textureCacheGLSize(quint64 bytes);
@@ -221,6 +231,10 @@ public:
     CachedTexture * load(const QString &img, const QString &docPath);
     CachedTexture * load(text img);
     CachedTexture * bind(GLuint id);
+
+    void            beginFrame(const QString &page);
+    bool            frameStarted()      { return inFrame; }
+    bool            endFrame(const QString &nextPage);
     void            setMinMagFilters(GLuint id);
     void            setMinFilter(GLuint id, GLenum filter);
     void            setMagFilter(GLuint id, GLenum filter);
@@ -234,6 +248,11 @@ public:
 
     bool            supported(GLuint fmt) { return cmpFormats.contains(fmt); }
 
+    // Number of uploads, evictions and reloads during last second
+    uint            uploadsPerSecond()   { return lastUploads; }
+    uint            evictionsPerSecond() { return lastEvictions; }
+    uint            reloadsPerSecond()   { return lastReloads; }
+
 public slots:
     void            clear();
     void            purge();
@@ -257,10 +276,16 @@ private:
         CachedTexture::Links * first, * last;
     };
 
-    void            reload(CachedTexture * tex);
+    void            reload(CachedTexture * tex, bool streaming = true);
+    enum { VICTIM_CANDIDATES = 8 };     // Textures scored by victim()
+    CachedTexture * victim(LRU &lru);
+    bool            pinned(CachedTexture *tex);
+    void            touch(CachedTexture *tex);
+    void            countFrame();
     void            insert(CachedTexture * tex, LRU &lru);
     void            relink(CachedTexture * tex, LRU &lru);
     void            unlink(CachedTexture * tex, LRU &lru);
+    bool            linked(CachedTexture * tex, LRU &lru);
     CachedTexture::Links *texLinksForLRU(CachedTexture *tex, LRU &lru);
     void            purgeMem();
     void            purgeGLMem();
@@ -291,9 +316,24 @@ private:
     // Enables reloading files as they change
     FileMonitor                      fileMonitor;
 
+    // Texture streaming: textures used in current frame are not evicted,
+    // textures are first loaded at low resolution if too many are decoded
+    // in the same frame, and textures of the next page are prefetched
+    bool                             streaming, inFrame;
+    uint                             frame, decodes, maxDecodesPerFrame;
+    QString                          page;
+    QMap<QString, QSet<GLuint> >     pageTextures;
+    QList<GLuint>                    refineQueue;
+
+    // Statistics, per second
+    QTime                            statsTime;
+    uint                             uploads, evictions, reloads;
+    uint                             lastUploads, lastEvictions, lastReloads;
+
     // Caching compressed textures to disk
     bool                             saveCompressed;
     QSet<GLuint>                     cmpFormats;
+    QSharedPointer<TextureStore>     store;
 
 private:
     static QWeakPointer<TextureCache> textureCache;
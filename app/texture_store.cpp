@@ -0,0 +1,505 @@
+// *****************************************************************************
+// texture_store.cpp                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Persistent on-disk store of GL-compressed textures, keyed by the
+//     content of the source image. The store is shared by all documents
+//     and sessions, populated in the background and limited in size.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "texture_store.h"
+#include "texture_cache.h"
+#include "preferences_pages.h"
+#include "base.h"
+#include "tao_utf8.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+#include <algorithm>
+#include <vector>
+
+namespace Tao {
+
+QWeakPointer<TextureStore> TextureStore::inst;
+
+// Version of the index file, change when the layout of entries changes
+static const quint32 TEXTURE_STORE_VERSION = 1;
+
+
+XL::Integer_p TextureStore::textureStoreSize(quint64 bytes)
+// ----------------------------------------------------------------------------
+//   Primitive to change the maximum size of the store on disk
+// ----------------------------------------------------------------------------
+{
+    QSharedPointer<TextureStore> store = TextureStore::instance();
+    quint64 prev = store->maxSize();
+    store->setMaxSize(bytes);
+    return new XL::Integer(prev);
+}
+
+
+TextureStore::TextureStore()
+// ----------------------------------------------------------------------------
+//   Read the index of the store and start the writer thread
+// ----------------------------------------------------------------------------
+    : storeSize(0), maxStoreSize(PerformancesPage::textureStoreMaxSize()),
+      purgeRatio(0.8), indexDirty(false), quit(false)
+{
+#if QT_VERSION >= 0x050000
+    QString base = QStandardPaths::writableLocation(
+        QStandardPaths::CacheLocation);
+#else
+    QString base = QDesktopServices::storageLocation(
+        QDesktopServices::CacheLocation);
+#endif
+    dir.setPath(base + "/textures");
+    if (!dir.exists())
+        dir.mkpath(".");
+    readIndex();
+    start(QThread::LowPriority);
+}
+
+
+TextureStore::~TextureStore()
+// ----------------------------------------------------------------------------
+//   Finish pending writes, save index
+// ----------------------------------------------------------------------------
+{
+    mutex.lock();
+    quit = true;
+    cond.wakeOne();
+    mutex.unlock();
+    wait();
+    writeIndex();
+}
+
+
+QSharedPointer<TextureStore> TextureStore::instance()
+// ----------------------------------------------------------------------------
+//    Return a pointer to the instance of the texture store.
+// ----------------------------------------------------------------------------
+{
+    QSharedPointer<TextureStore> ptr;
+    if (!inst)
+    {
+        ptr = QSharedPointer<TextureStore>(new TextureStore);
+        inst = ptr.toWeakRef();
+    }
+    else
+    {
+        ptr = inst.toStrongRef();
+        XL_ASSERT(ptr);
+    }
+    return ptr;
+}
+
+
+bool TextureStore::load(const QString &path, const QSet<GLuint> &formats,
+                        Image &image)
+// ----------------------------------------------------------------------------
+//   Load compressed texture for file 'path' if in store, return true if found
+// ----------------------------------------------------------------------------
+{
+    if (!maxStoreSize)
+        return false;
+
+    Source info = sourceInfo(path);
+    QString name;
+    {
+        QMutexLocker locker(&mutex);
+        SourceMap::iterator s = sources.find(path);
+        if (s == sources.end() ||
+            (*s).size != info.size || (*s).modified != info.modified)
+            return false;
+
+        foreach (GLuint fmt, formats)
+        {
+            QString candidate = entryName((*s).hash, 0, fmt);
+            EntryMap::iterator e = entries.find(candidate);
+            if (e != entries.end())
+            {
+                // Saved with the next insertion or eviction, not for each hit
+                (*e).lastUse = now();
+                name = candidate;
+                break;
+            }
+        }
+    }
+    if (name.isEmpty())
+        return false;
+
+    QFile file(dir.filePath(name));
+    if (file.open(QIODevice::ReadOnly) &&
+        image.loadCompressedData(file.readAll()))
+    {
+        IFTRACE(texturecache)
+            debug() << "Hit '" << +path << "' [" << +name << "]\n";
+        return true;
+    }
+
+    // Entry was removed behind our back or is invalid
+    IFTRACE(texturecache)
+        debug() << "Invalid entry '" << +name << "'\n";
+    QMutexLocker locker(&mutex);
+    EntryMap::iterator e = entries.find(name);
+    if (e != entries.end())
+    {
+        storeSize -= (*e).size;
+        entries.erase(e);
+        indexDirty = true;
+    }
+    return false;
+}
+
+
+void TextureStore::save(const QString &path, Image &image)
+// ----------------------------------------------------------------------------
+//   Queue compressed image read back from GL, to be stored by the thread
+// ----------------------------------------------------------------------------
+{
+    if (!maxStoreSize || !image.compressed)
+        return;
+
+    Job job;
+    job.path = path;
+    job.source = sourceInfo(path);
+    job.fmt = image.fmt;
+    job.data = image.compressedData();
+
+    QMutexLocker locker(&mutex);
+    jobs.append(job);
+    cond.wakeOne();
+}
+
+
+void TextureStore::setMaxSize(quint64 bytes)
+// ----------------------------------------------------------------------------
+//   Change the size limit, evicting entries if necessary
+// ----------------------------------------------------------------------------
+{
+    QStringList victims;
+    {
+        QMutexLocker locker(&mutex);
+        maxStoreSize = bytes;
+        if (storeSize > maxStoreSize)
+            victims = evict(maxStoreSize * purgeRatio);
+        cond.wakeOne();
+    }
+    removeFiles(victims);
+}
+
+
+void TextureStore::clear()
+// ----------------------------------------------------------------------------
+//   Remove all entries from the store
+// ----------------------------------------------------------------------------
+{
+    QStringList victims;
+    {
+        QMutexLocker locker(&mutex);
+        victims = evict(0);
+        sources.clear();
+        indexDirty = true;
+        cond.wakeOne();
+    }
+    removeFiles(victims);
+}
+
+
+void TextureStore::run()
+// ----------------------------------------------------------------------------
+//   Write queued textures to disk, save index when idle
+// ----------------------------------------------------------------------------
+{
+    QMutexLocker locker(&mutex);
+    while (!quit || !jobs.isEmpty())
+    {
+        if (jobs.isEmpty())
+        {
+            if (indexDirty)
+            {
+                locker.unlock();
+                writeIndex();
+                locker.relock();
+                continue;
+            }
+            cond.wait(&mutex);
+            continue;
+        }
+
+        Job job = jobs.takeFirst();
+        locker.unlock();
+        write(job);
+        locker.relock();
+    }
+}
+
+
+void TextureStore::write(Job &job)
+// ----------------------------------------------------------------------------
+//   Hash the source file and write compressed data if not already in store
+// ----------------------------------------------------------------------------
+//   Called from the thread with mutex unlocked
+{
+    QFile src(job.path);
+    if (!src.open(QIODevice::ReadOnly))
+        return;
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    while (!src.atEnd())
+        sha1.addData(src.read(1 << 20));
+    src.close();
+
+    // Source may have changed since it was loaded, forget it in that case
+    Source info = sourceInfo(job.path);
+    if (info.size != job.source.size || info.modified != job.source.modified)
+        return;
+    info.hash = sha1.result();
+
+    QString name = entryName(info.hash, 0, job.fmt);
+    mutex.lock();
+    sources[job.path] = info;
+    indexDirty = true;
+    bool exists = entries.contains(name);
+    mutex.unlock();
+    if (exists)
+        return;
+
+    // Write to temporary file, then rename, so that readers never see
+    // partial files (including other instances of the application)
+    QString tmpName = name + ".tmp";
+    QFile tmp(dir.filePath(tmpName));
+    if (!tmp.open(QIODevice::WriteOnly))
+        return;
+    qint64 written = tmp.write(job.data);
+    tmp.close();
+    dir.remove(name);
+    if (written != job.data.size() || !dir.rename(tmpName, name))
+    {
+        dir.remove(tmpName);
+        return;
+    }
+
+    IFTRACE(texturecache)
+        debug() << "Stored '" << +job.path << "' [" << +name << "] "
+                << job.data.size() << " bytes\n";
+
+    QStringList victims;
+    mutex.lock();
+    entries[name] = Entry(job.data.size(), now());
+    storeSize += job.data.size();
+    indexDirty = true;
+    if (storeSize > maxStoreSize)
+        victims = evict(maxStoreSize * purgeRatio);
+    mutex.unlock();
+    removeFiles(victims);
+}
+
+
+QStringList TextureStore::evict(quint64 target)
+// ----------------------------------------------------------------------------
+//   Remove least recently used entries until size is below target
+// ----------------------------------------------------------------------------
+//   Must be called with mutex locked. Returns the names of the evicted
+//   entries, whose files the caller deletes with removeFiles once unlocked.
+{
+    typedef std::pair<uint, QString> Use;
+    std::vector<Use> uses;
+    uses.reserve(entries.size());
+    for (EntryMap::iterator e = entries.begin(); e != entries.end(); e++)
+        uses.push_back(Use((*e).lastUse, e.key()));
+    std::sort(uses.begin(), uses.end());
+
+    QStringList victims;
+    std::vector<Use>::iterator u = uses.begin();
+    while (storeSize > target && u != uses.end())
+    {
+        const QString &name = (*u++).second;
+        storeSize -= entries[name].size;
+        entries.remove(name);
+        victims.append(name);
+    }
+    if (!victims.isEmpty())
+        indexDirty = true;
+    return victims;
+}
+
+
+void TextureStore::removeFiles(const QStringList &names)
+// ----------------------------------------------------------------------------
+//   Delete the files of evicted entries
+// ----------------------------------------------------------------------------
+//   Called with mutex unlocked
+{
+    foreach (const QString &name, names)
+    {
+        dir.remove(name);
+        IFTRACE(texturecache)
+            debug() << "Evicted [" << +name << "]\n";
+    }
+}
+
+
+QString TextureStore::entryName(const QByteArray &hash, uint level,
+                                GLuint fmt)
+// ----------------------------------------------------------------------------
+//   Name of the file holding a given level of a texture in a given format
+// ----------------------------------------------------------------------------
+{
+    return QString("%1-%2-%3.tex")
+        .arg(QString(hash.toHex()))
+        .arg(level)
+        .arg(fmt, 0, 16);
+}
+
+
+TextureStore::Source TextureStore::sourceInfo(const QString &path)
+// ----------------------------------------------------------------------------
+//   Size and modification date of a source file (hash not computed)
+// ----------------------------------------------------------------------------
+{
+    QFileInfo fi(path);
+    Source info;
+    info.size = fi.size();
+    info.modified = fi.lastModified().toTime_t();
+    return info;
+}
+
+
+uint TextureStore::now()
+// ----------------------------------------------------------------------------
+//   Current time, used for LRU
+// ----------------------------------------------------------------------------
+{
+    return QDateTime::currentDateTime().toTime_t();
+}
+
+
+void TextureStore::readIndex()
+// ----------------------------------------------------------------------------
+//   Read index file, ignoring entries whose file no longer exists
+// ----------------------------------------------------------------------------
+{
+    QFile file(dir.filePath("index"));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    quint32 version = 0, count = 0;
+    in >> version;
+    if (version != TEXTURE_STORE_VERSION)
+        return;
+
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        QString name;
+        Entry entry;
+        in >> name >> entry.size >> entry.lastUse;
+        if (dir.exists(name))
+        {
+            entries[name] = entry;
+            storeSize += entry.size;
+        }
+    }
+
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        QString path;
+        Source source;
+        in >> path >> source.hash >> source.size >> source.modified;
+        sources[path] = source;
+    }
+
+    IFTRACE(texturecache)
+        debug() << "Index has " << entries.size() << " entries for "
+                << sources.size() << " files, " << storeSize << " bytes\n";
+}
+
+
+void TextureStore::writeIndex()
+// ----------------------------------------------------------------------------
+//   Save a snapshot of the index
+// ----------------------------------------------------------------------------
+{
+    mutex.lock();
+    EntryMap  e = entries;
+    SourceMap s = sources;
+    indexDirty = false;
+    mutex.unlock();
+
+    QFile file(dir.filePath("index.tmp"));
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out << TEXTURE_STORE_VERSION;
+    out << (quint32) e.size();
+    for (EntryMap::iterator i = e.begin(); i != e.end(); i++)
+        out << i.key() << (*i).size << (*i).lastUse;
+
+    // Only keep source files for which there is at least one entry
+    QSet<QString> hashes;
+    for (EntryMap::iterator i = e.begin(); i != e.end(); i++)
+        hashes.insert(i.key().section('-', 0, 0));
+    for (SourceMap::iterator i = s.begin(); i != s.end(); )
+        if (hashes.contains(QString((*i).hash.toHex())))
+            i++;
+        else
+            i = s.erase(i);
+
+    out << (quint32) s.size();
+    for (SourceMap::iterator i = s.begin(); i != s.end(); i++)
+        out << i.key() << (*i).hash << (*i).size << (*i).modified;
+    file.close();
+
+    dir.remove("index");
+    dir.rename("index.tmp", "index");
+}
+
+
+std::ostream & TextureStore::debug()
+// ----------------------------------------------------------------------------
+//   Convenience method to log with a common prefix
+// ----------------------------------------------------------------------------
+{
+    std::cerr << "[TextureStore] ";
+    return std::cerr;
+}
+
+}
@@ -0,0 +1,154 @@
+#ifndef TEXTURE_STORE_H
+#define TEXTURE_STORE_H
+// *****************************************************************************
+// texture_store.h                                                 Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Persistent on-disk store of GL-compressed textures, keyed by the
+//     content of the source image. The store is shared by all documents
+//     and sessions, populated in the background and limited in size.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "tao.h"
+#include "tao_gl.h"
+#include "tao_tree.h"
+#include <QDir>
+#include <QMap>
+#include <QList>
+#include <QStringList>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <iostream>
+
+namespace Tao {
+
+struct Image;
+
+
+class TextureStore : public QThread
+// ----------------------------------------------------------------------------
+//    Singleton. Keeps compressed textures on disk, writes them in a thread
+// ----------------------------------------------------------------------------
+//    Entries are named after the SHA-1 of the source file, the mip level and
+//    the GL compressed format, so that identical images share one entry and
+//    several GL implementations can use the same store.
+//    An index remembers the hash of each source file (by path, size and
+//    modification date), so that a hit does not even read the source.
+//    Files that are not in the index yet are hashed by the thread, after
+//    the first (slow) load of the image.
+{
+    Q_OBJECT
+
+public:
+    static QSharedPointer<TextureStore> instance();
+
+public:
+    // Primitives
+    static XL::Integer_p textureStoreSize(quint64 bytes);
+
+public:
+    virtual ~TextureStore();
+
+    bool            load(const QString &path, const QSet<GLuint> &formats,
+                         Image &image);
+    void            save(const QString &path, Image &image);
+
+    quint64         maxSize()  { return maxStoreSize; }
+    quint64         size()     { return storeSize; }
+
+public slots:
+    void            setMaxSize(quint64 bytes);
+    void            clear();
+
+protected:
+    TextureStore();
+    virtual void    run();
+
+private:
+    struct Entry
+    {
+        Entry(quint64 size = 0, uint lastUse = 0)
+            : size(size), lastUse(lastUse) {}
+        quint64     size;
+        uint        lastUse;            // For LRU eviction, in seconds
+    };
+
+    struct Source
+    {
+        Source() : size(0), modified(0) {}
+        QByteArray  hash;               // SHA-1 of the file contents
+        qint64      size;
+        uint        modified;
+    };
+
+    struct Job
+    {
+        QString     path;
+        Source      source;
+        GLuint      fmt;
+        QByteArray  data;
+    };
+
+    typedef QMap<QString, Entry>        EntryMap;
+    typedef QMap<QString, Source>       SourceMap;
+
+    static QString  entryName(const QByteArray &hash, uint level, GLuint fmt);
+    static Source   sourceInfo(const QString &path);
+    static uint     now();
+
+    void            write(Job &job);
+    QStringList     evict(quint64 target);
+    void            removeFiles(const QStringList &names);
+    void            readIndex();
+    void            writeIndex();
+    std::ostream &  debug();
+
+private:
+    QDir            dir;
+    QMutex          mutex;
+    QWaitCondition  cond;
+    EntryMap        entries;
+    SourceMap       sources;
+    QList<Job>      jobs;
+    quint64         storeSize, maxStoreSize;
+    float           purgeRatio;
+    bool            indexDirty, quit;
+
+private:
+    static QWeakPointer<TextureStore> inst;
+};
+
+}
+
+#endif // TEXTURE_STORE_H
@@ -0,0 +1,320 @@
+// *****************************************************************************
+// triangle_mesh.cpp                                               Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Indexed triangles kept in vertex buffers and drawn by ranges, e.g.
+//     for the interior, outline and extrusion of cached glyphs.
+//
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "triangle_mesh.h"
+#include <cstddef>
+#include <iostream>
+
+TAO_BEGIN
+
+TriangleMesh *TriangleMesh::recording = NULL;
+
+
+TriangleMesh::TriangleMesh()
+// ----------------------------------------------------------------------------
+//   Create an empty mesh, buffers are created on first upload
+// ----------------------------------------------------------------------------
+    : vertices(), indices(), current(), garbage(0),
+      vbo(0), ibo(0), dirty(false)
+{}
+
+
+TriangleMesh::~TriangleMesh()
+// ----------------------------------------------------------------------------
+//   Release the buffer objects
+// ----------------------------------------------------------------------------
+{
+    if (recording == this)
+        recording = NULL;
+    if (vbo)
+        GL.DeleteBuffers(1, &vbo);
+    if (ibo)
+        GL.DeleteBuffers(1, &ibo);
+}
+
+
+void TriangleMesh::Begin()
+// ----------------------------------------------------------------------------
+//   Record the triangles of the paths drawn until End is called
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(!recording);
+    current.first = indices.size();
+    current.base = vertices.size();
+    recording = this;
+}
+
+
+TriangleMesh::Range TriangleMesh::End()
+// ----------------------------------------------------------------------------
+//   Stop recording, and return the range of what was recorded
+// ----------------------------------------------------------------------------
+{
+    XL_ASSERT(recording == this);
+    recording = NULL;
+    current.count = indices.size() - current.first;
+    current.vertices = vertices.size() - current.base;
+    dirty = true;
+
+    Range result = current;
+    current = Range();
+    return result;
+}
+
+
+void TriangleMesh::AddTriangle(uint a, uint b, uint c, bool back)
+// ----------------------------------------------------------------------------
+//   Add a triangle, reversing its winding for back faces
+// ----------------------------------------------------------------------------
+{
+    indices.push_back(a);
+    indices.push_back(back ? c : b);
+    indices.push_back(back ? b : c);
+}
+
+
+void TriangleMesh::Add(GLenum mode, Path &path, bool back, scale depth)
+// ----------------------------------------------------------------------------
+//   Add the vertices drawn by a path with the given mode as triangles
+// ----------------------------------------------------------------------------
+//   The back of extruded shapes is drawn mirrored at the given depth,
+//   i.e. what GraphicPath otherwise does with a transform and GL_CW
+{
+    uint size = path.size();
+    if (size < 3)
+        return;
+
+    uint first = vertices.size();
+    vertices.reserve(first + size);
+    for (uint i = 0; i < size; i++)
+    {
+        GraphicPath::VertexData &d = path[i];
+        Vertex v;
+        v.position[0] = d.vertex.x;
+        v.position[1] = d.vertex.y;
+        v.position[2] = back ? -depth - d.vertex.z : d.vertex.z;
+        v.normal[0] = d.normal.x;
+        v.normal[1] = d.normal.y;
+        v.normal[2] = back ? -d.normal.z : d.normal.z;
+        v.texture[0] = d.texture.x;
+        v.texture[1] = d.texture.y;
+        v.texture[2] = d.texture.z;
+        vertices.push_back(v);
+    }
+
+    switch (mode)
+    {
+    case GL_TRIANGLES:
+        for (uint i = 0; i + 2 < size; i += 3)
+            AddTriangle(first + i, first + i + 1, first + i + 2, back);
+        break;
+    case GL_TRIANGLE_STRIP:
+        // Every other triangle in a strip has its winding inverted
+        for (uint i = 2; i < size; i++)
+            AddTriangle(first + i - 2, first + i - 1, first + i,
+                        back != bool(i & 1));
+        break;
+    case GL_TRIANGLE_FAN:
+    case GL_POLYGON:
+        for (uint i = 2; i < size; i++)
+            AddTriangle(first, first + i - 1, first + i, back);
+        break;
+    default:
+        std::cerr << "TriangleMesh: Unexpected mode " << mode << "\n";
+        vertices.resize(first);
+        break;
+    }
+}
+
+
+void TriangleMesh::Free(Range &range)
+// ----------------------------------------------------------------------------
+//   Mark a range as unused, it will be reclaimed on the next Compact
+// ----------------------------------------------------------------------------
+{
+    if (range.Recorded())
+        garbage += range.count;
+    range = Range();
+}
+
+
+void TriangleMesh::Compact(Ranges &live)
+// ----------------------------------------------------------------------------
+//   Copy the live ranges into new arrays, updating them as we go
+// ----------------------------------------------------------------------------
+{
+    Vertices newVertices;
+    Indices newIndices;
+    newVertices.reserve(vertices.size());
+    newIndices.reserve(indices.size() - garbage);
+
+    for (Ranges::iterator r = live.begin(); r != live.end(); r++)
+    {
+        Range &range = **r;
+        if (!range.Recorded())
+            continue;
+
+        uint first = newIndices.size();
+        uint base = newVertices.size();
+        newVertices.insert(newVertices.end(),
+                           vertices.begin() + range.base,
+                           vertices.begin() + range.base + range.vertices);
+        for (uint i = 0; i < range.count; i++)
+            newIndices.push_back(indices[range.first+i] - range.base + base);
+        range.first = first;
+        range.base = base;
+    }
+
+    vertices.swap(newVertices);
+    indices.swap(newIndices);
+    garbage = 0;
+    dirty = true;
+}
+
+
+void TriangleMesh::Clear()
+// ----------------------------------------------------------------------------
+//   Forget all ranges, keeping the buffer objects for later use
+// ----------------------------------------------------------------------------
+{
+    vertices.clear();
+    indices.clear();
+    garbage = 0;
+    dirty = true;
+}
+
+
+ulong TriangleMesh::Bytes()
+// ----------------------------------------------------------------------------
+//   Memory used by the vertices and indices, including freed ranges
+// ----------------------------------------------------------------------------
+{
+    return vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint);
+}
+
+
+void TriangleMesh::Upload()
+// ----------------------------------------------------------------------------
+//   Copy the arrays into the buffer objects if we have them
+// ----------------------------------------------------------------------------
+{
+    dirty = false;
+    if (!GL.HasBuffers())
+        return;
+
+    if (!vbo)
+        GL.GenBuffers(1, &vbo);
+    if (!ibo)
+        GL.GenBuffers(1, &ibo);
+    GL.BindBuffer(GL_ARRAY_BUFFER, vbo);
+    GL.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+                  vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+    GL.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    GL.BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                  indices.empty() ? NULL : &indices[0], GL_STATIC_DRAW);
+    GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+void TriangleMesh::Draw(const Range &range)
+// ----------------------------------------------------------------------------
+//   Draw a range of triangles with a single call
+// ----------------------------------------------------------------------------
+{
+    if (!range.count)
+        return;
+    if (dirty)
+        Upload();
+
+    // With buffer objects, pointers are offsets in the buffers
+    const char *base = NULL;
+    const GLuint *first = NULL;
+    if (vbo)
+    {
+        GL.BindBuffer(GL_ARRAY_BUFFER, vbo);
+        GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+        first = (const GLuint *) (range.first * sizeof(GLuint));
+    }
+    else
+    {
+        base = (const char *) &vertices[0];
+        first = &indices[range.first];
+    }
+
+    GL.VertexPointer(3, GL_FLOAT, sizeof(Vertex),
+                     base + offsetof(Vertex, position));
+    GL.NormalPointer(GL_FLOAT, sizeof(Vertex),
+                     base + offsetof(Vertex, normal));
+    GL.EnableClientState(GL_VERTEX_ARRAY);
+    GL.EnableClientState(GL_NORMAL_ARRAY);
+
+    // Activate texture coordinates for all used units
+    uint64 textureUnits = GL.ActiveTextureUnits();
+    for (uint i = 0; i < GL.MaxTextureCoords(); i++)
+    {
+        if (textureUnits & (1 << i))
+        {
+            GL.ClientActiveTexture(GL_TEXTURE0 + i);
+            GL.EnableClientState(GL_TEXTURE_COORD_ARRAY);
+            GL.TexCoordPointer(3, GL_FLOAT, sizeof(Vertex),
+                               base + offsetof(Vertex, texture));
+        }
+    }
+
+    GL.DrawElements(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, first);
+
+    GL.DisableClientState(GL_VERTEX_ARRAY);
+    GL.DisableClientState(GL_NORMAL_ARRAY);
+    for (uint i = 0; i < GL.MaxTextureCoords(); i++)
+    {
+        if (textureUnits & (1 << i))
+        {
+            GL.ClientActiveTexture(GL_TEXTURE0 + i);
+            GL.DisableClientState(GL_TEXTURE_COORD_ARRAY);
+        }
+    }
+    GL.ClientActiveTexture(GL_TEXTURE0);
+
+    if (vbo)
+    {
+        GL.BindBuffer(GL_ARRAY_BUFFER, 0);
+        GL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+}
+
+TAO_END
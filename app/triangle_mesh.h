@@ -0,0 +1,114 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+// *****************************************************************************
+// triangle_mesh.h                                                 Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Indexed triangles kept in vertex buffers and drawn by ranges, e.g.
+//     for the interior, outline and extrusion of cached glyphs.
+//
+//
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+#include "tao.h"
+#include "tao_gl.h"
+#include "path3d.h"
+#include <vector>
+
+TAO_BEGIN
+
+struct TriangleMesh
+// ----------------------------------------------------------------------------
+//   Triangles recorded from graphic paths, stored in shared vertex buffers
+// ----------------------------------------------------------------------------
+//   While a mesh is recording, graphic paths add their triangles, strips
+//   and fans to it as indexed triangles instead of drawing them. Each
+//   recording returns a range that can then be drawn with a single call.
+//   The buffers are uploaded again after new ranges were recorded. When
+//   buffer objects are not available, the same arrays are drawn from
+//   client memory. Ranges that are freed are only reclaimed by Compact.
+{
+    struct Vertex
+    {
+        GLfloat         position[3];
+        GLfloat         normal[3];
+        GLfloat         texture[3];
+    };
+    struct Range
+    {
+        Range(): first(~0U), count(0), base(0), vertices(0) {}
+        bool            Recorded() const        { return first != ~0U; }
+        uint            first, count;           // In indices
+        uint            base, vertices;         // In vertices
+    };
+    typedef GraphicPath::Vertices       Path;
+    typedef std::vector<Vertex>         Vertices;
+    typedef std::vector<GLuint>         Indices;
+    typedef std::vector<Range *>        Ranges;
+
+    TriangleMesh();
+    ~TriangleMesh();
+
+    void                Begin();
+    Range               End();
+    void                Add(GLenum mode, Path &path,
+                            bool back = false, scale depth = 0);
+    void                Free(Range &range);
+    void                Compact(Ranges &live);
+    void                Clear();
+
+    void                Draw(const Range &range);
+    void                Upload();
+
+    uint                Triangles()     { return indices.size() / 3; }
+    ulong               Bytes();
+    uint                Garbage()       { return garbage / 3; }
+
+public:
+    static TriangleMesh *recording;     // Paths are recorded there if set
+
+private:
+    void                AddTriangle(uint a, uint b, uint c, bool back);
+
+private:
+    Vertices            vertices;
+    Indices             indices;
+    Range               current;
+    uint                garbage;        // Indices in freed ranges
+    GLuint              vbo, ibo;
+    bool                dirty;
+
+    TriangleMesh(const TriangleMesh &);
+    TriangleMesh &operator=(const TriangleMesh &);
+};
+
+TAO_END
+
+#endif // TRIANGLE_MESH_H
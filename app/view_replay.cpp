@@ -0,0 +1,149 @@
+// *****************************************************************************
+// view_replay.cpp                                                 Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Recording of the OpenGL commands drawing the scene for one viewpoint,
+//     so that they can be replayed for the other viewpoints of a stereo or
+//     multi-view display without traversing the layouts again.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "view_replay.h"
+#include "opengl_state.h"
+#include <cstring>
+
+TAO_BEGIN
+
+ViewReplay::ViewReplay()
+// ----------------------------------------------------------------------------
+//   Start enabled, with nothing recorded
+// ----------------------------------------------------------------------------
+    : drawn(0), replayed(0),
+      enabled(true), recording(false), recorded(false), usable(false),
+      list(0), save(NULL)
+{
+    memset(modelview, 0, sizeof(modelview));
+}
+
+
+ViewReplay::~ViewReplay()
+// ----------------------------------------------------------------------------
+//   Release the display list
+// ----------------------------------------------------------------------------
+{
+    if (list)
+        GL.DeleteLists(list, 1);
+}
+
+
+void ViewReplay::Begin()
+// ----------------------------------------------------------------------------
+//   Forget the scene recorded for the previous frame
+// ----------------------------------------------------------------------------
+{
+    recorded = false;
+    usable = false;
+}
+
+
+bool ViewReplay::Record()
+// ----------------------------------------------------------------------------
+//   Start recording the scene, if it was not recorded yet for this frame
+// ----------------------------------------------------------------------------
+//   Pending state changes are sent first, so that the list starts from the
+//   state that GL really has. The state is saved, and the list ends with the
+//   GL calls that restore it, see Recorded. Otherwise, replaying the list
+//   would start from the state where the previous replay left GL, and the
+//   state cache would not match the state of GL after a replay.
+{
+    if (!enabled || recording || recorded)
+        return false;
+    if (!list)
+        list = GL.GenLists(1);
+    memcpy(modelview, GL.ModelViewMatrix(), sizeof(modelview));
+    recording = usable = true;
+    GL.Sync();
+    GL.NewList(list, GL_COMPILE_AND_EXECUTE);
+    save = GL.Save();
+    return true;
+}
+
+
+void ViewReplay::Recorded()
+// ----------------------------------------------------------------------------
+//   Finish recording the scene
+// ----------------------------------------------------------------------------
+//   Restoring the save only changes the state cache. The following Sync
+//   compiles the GL calls that bring GL back to the saved state in the list.
+{
+    if (!recording)
+        return;
+    GL.Restore(save);
+    save = NULL;
+    GL.Sync();
+    GL.EndList();
+    recording = false;
+    recorded = true;
+}
+
+
+bool ViewReplay::Replay()
+// ----------------------------------------------------------------------------
+//   Draw the recorded scene with the current camera, if possible
+// ----------------------------------------------------------------------------
+//   The model-view matrices loaded by the list all include the recorded
+//   camera V0, so we replay it with V0 and a projection P.V.V0^-1, where
+//   P and V are the current projection and model-view matrices. Lighting
+//   and fog are computed in the eye space of the recorded viewpoint, which
+//   only differs by a translation for the parallel cameras of stereoscopy.
+{
+    if (!recorded || !usable)
+        return false;
+
+    coord inverse[16], view[16], projection[16];
+    if (!GL.InvertMatrix(modelview, inverse))
+        return false;
+    GL.MultMatrices(inverse, GL.ModelViewMatrix(), view);
+    GL.MultMatrices(view, GL.ProjectionMatrix(), projection);
+
+    // Load the matrices directly, then let GL load the current ones again
+    GL.Sync();
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixd(projection);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixd(modelview);
+    glCallList(list);
+    GL.Invalidate(STATE_mvMatrix | STATE_projMatrix | STATE_matrixMode);
+
+    replayed++;
+    return true;
+}
+
+TAO_END
@@ -0,0 +1,93 @@
+#ifndef VIEW_REPLAY_H
+#define VIEW_REPLAY_H
+// *****************************************************************************
+// view_replay.h                                                   Tao3D project
+// *****************************************************************************
+//
+// File description:
+//
+//     Recording of the OpenGL commands drawing the scene for one viewpoint,
+//     so that they can be replayed for the other viewpoints of a stereo or
+//     multi-view display without traversing the layouts again.
+//
+//
+//
+//
+//
+//
+// *****************************************************************************
+// This software is licensed under the GNU General Public License v3
+// (C) 2019, Christophe de Dinechin <christophe@dinechin.org>
+// *****************************************************************************
+// This file is part of Tao3D
+//
+// Tao3D is free software: you can r redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tao3D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Tao3D, in a file named COPYING.
+// If not, see <https://www.gnu.org/licenses/>.
+// *****************************************************************************
+
+
+#include "tao.h"
+#include "tao_gl.h"
+#include "coords.h"
+
+TAO_BEGIN
+
+struct GraphicSave;
+
+
+struct ViewReplay
+// ----------------------------------------------------------------------------
+//   Draw the scene once, and replay it for the other viewpoints of a frame
+// ----------------------------------------------------------------------------
+//   The viewpoints of a multi-view display only differ by their model-view
+//   and projection matrices. The commands drawing the first viewpoint are
+//   compiled in a display list while they execute, starting and ending in
+//   the same graphic state. For the other viewpoints, the list is called
+//   with the recorded model-view matrix, and a projection matrix that maps
+//   the recorded camera onto the current one.
+//   Drawings that depend on the viewpoint (stereo layouts, module renderers,
+//   offscreen frames) make the recording unusable, and the other viewpoints
+//   are then drawn by traversing the layouts as usual.
+{
+    ViewReplay();
+    ~ViewReplay();
+
+    void        Enable(bool enable)     { enabled = enable; }
+    bool        Enabled()               { return enabled; }
+
+    // Drawing the viewpoints of a frame
+    void        Begin();
+    bool        Record();
+    void        Recorded();
+    bool        Replay();
+    void        ViewDependent()         { if (recording) usable = false; }
+    bool        Recording()             { return recording; }
+
+public:
+    ulong       drawn;          // Viewpoints drawn from the layouts
+    ulong       replayed;       // Viewpoints drawn from the recording
+
+private:
+    bool        enabled;
+    bool        recording;      // Commands are being compiled
+    bool        recorded;       // The list holds this frame's scene
+    bool        usable;         // Nothing depends on the viewpoint
+    GLuint      list;
+    GraphicSave *save;          // State when recording started
+    coord       modelview[16];  // Camera of the recorded viewpoint
+};
+
+TAO_END
+
+#endif // VIEW_REPLAY_H
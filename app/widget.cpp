@@ -50,6 +50,7 @@
 #include "frame.h"
 #include "texture.h"
 #include "svg.h"
+#include "svg_shape.h"
 #include "widget_surface.h"
 #include "window.h"
 #include "apply_changes.h"
@@ -66,6 +67,7 @@
 #include "tao_glu.h"
 #include "layout.h"
 #include "page_layout.h"
+#include "page_thumbnails.h"
 #include "space_layout.h"
 #include "shapes.h"
 #include "text_drawing.h"
@@ -95,6 +97,7 @@
 #include "display_driver.h"
 #include "license.h"
 #include "gc_thread.h"
+#include "job_pool.h"
 #include "info_trash_can.h"
 #include "tao_info.h"
 #include "preferences_pages.h"
@@ -135,6 +138,10 @@
 #endif
 #include <QRunnable>
 #include <QThreadPool>
+#include <QElapsedTimer>
+#if QT_VERSION >= 0x050000
+#include <QScreen>
+#endif
 
 #ifdef MACOSX_DISPLAYLINK
 #include <CoreVideo/CoreVideo.h>
@@ -251,6 +258,7 @@ Widget::Widget(QWidget *parent, SourceFile *sf)
 #ifdef Q_OS_MACX
       bFrameBufferReady(false),
 #endif
+      thumbnails(NULL),
 #ifdef Q_OS_LINUX
       vsyncState(false),
 #endif
@@ -272,8 +280,9 @@ Widget::Widget(QWidget *parent, SourceFile *sf)
       stereoBuffersEnabled(TaoGLFormat().testOption(QGL::StereoBuffers)),
       stereoSkip(0), holdOff(false), droppedFrames(0),
 #else
-      timer(),
+      timer(), frameTimer(), timerStart(DBL_MAX), framePacer(),
 #endif
+      damage(), frameInvalid(true), culling(true), replay(), batch(),
       dfltRefresh(0.0), idleTimer(this),
       pageStartTime(DBL_MAX), frozenTime(DBL_MAX), startTime(DBL_MAX),
       currentTime(DBL_MAX), stats(), frameCounter(0),
@@ -333,6 +342,10 @@ Widget::Widget(QWidget *parent, SourceFile *sf)
 
     // Sync to VBlank if configured to do so
     enableVSync(NULL, PerformancesPage::VSync());
+    damageRegions(NULL, XL::MAIN->options.damage_regions);
+    frustumCulling(NULL, XL::MAIN->options.frustum_culling);
+    multiViewReplay(NULL, XL::MAIN->options.multiview_replay);
+    drawBatching(NULL, XL::MAIN->options.draw_batching);
 
     // Create the main page we draw on
     space = new SpaceLayout(this);
@@ -465,6 +478,7 @@ Widget::Widget(Widget &o, const QGLFormat &format)
       gotoPageName(o.gotoPageName), transitionPageName(o.transitionPageName),
       pageLinks(o.pageLinks), pageNames(o.pageNames),
       newPageNames(o.newPageNames),
+      pageSources(o.pageSources), newPageSources(o.newPageSources),
       pageId(o.pageId), pageFound(o.pageFound), prevPageShown(o.prevPageShown),
       pageShown(o.pageFound),
       pageTotal(o.pageTotal), pageToPrint(o.pageToPrint),
@@ -490,7 +504,7 @@ Widget::Widget(Widget &o, const QGLFormat &format)
       bFrameBufferReady(false),
 #endif
       screenShotPath(o.screenShotPath), screenShotScale(1.0),
-      screenShotWithAlpha(o.screenShotWithAlpha),
+      screenShotWithAlpha(o.screenShotWithAlpha), thumbnails(NULL),
 #ifdef Q_OS_LINUX
       vsyncState(false),
 #endif
@@ -520,8 +534,9 @@ Widget::Widget(Widget &o, const QGLFormat &format)
       stereoSkip(o.stereoSkip), holdOff(o.holdOff),
       droppedFrames(o.droppedFrames),
 #else
-      timer(),
+      timer(), frameTimer(), timerStart(DBL_MAX), framePacer(),
 #endif
+      damage(), frameInvalid(true), culling(true), replay(), batch(),
       dfltRefresh(o.dfltRefresh),
       pageStartTime(o.pageStartTime), frozenTime(o.frozenTime),
       startTime(o.startTime),
@@ -550,6 +565,7 @@ Widget::Widget(Widget &o, const QGLFormat &format)
       offlineRenderingHeight(o.offlineRenderingHeight),
       toDialogLabel(o.toDialogLabel),
       pendingEvents(), // Nothing transferred from o's event queue
+      moduleEvents(o.moduleEvents),
       inDraw(o.inDraw), inRunPageExitHandlers(o.inRunPageExitHandlers),
       pageHasExitHandler(o.pageHasExitHandler), changeReason(o.changeReason),
       isInvalid(false)
@@ -578,6 +594,11 @@ Widget::Widget(Widget &o, const QGLFormat &format)
 
     // Do not change VSync mode
     enableVSync(NULL, o.VSyncEnabled());
+    damageRegions(NULL, o.damage.Enabled());
+    showDamageRegions(NULL, o.damage.Overlay());
+    frustumCulling(NULL, o.culling);
+    multiViewReplay(NULL, o.replay.Enabled());
+    drawBatching(NULL, o.batch.Enabled());
 
     // Create new layout to draw into
     space = new SpaceLayout(this);
@@ -617,7 +638,9 @@ Widget::Widget(Widget &o, const QGLFormat &format)
     // Texture and glyph cache do not support multiple GL contexts. So,
     // clear them here so that textures or GL lists created with the
     // previous context are not re-used with the new.
-    TextureCache::instance()->clear();
+    textureCache = TextureCache::instance();
+    textureCache->clear();
+    SvgRendererInfo::purgeRasters();
     if (o.watermark)
         GL.DeleteTextures(1, &o.watermark);
 
@@ -662,6 +685,7 @@ Widget::~Widget()
     delete space;
     delete path;
     delete mouseFocusTracker;
+    delete thumbnails;
     // REVISIT: delete activities?
 
 #ifdef MACOSX_DISPLAYLINK
@@ -680,6 +704,7 @@ Widget::~Widget()
     // Or make sure you set the correct GL context. See #1686.
 
     TextureCache::instance()->clear();
+    SvgRendererInfo::purgeRasters();
 }
 
 
@@ -816,6 +841,7 @@ void Widget::setupPage()
     pageTree = NULL;
     lastPageName = "";
     newPageNames.clear();
+    newPageSources.clear();
 }
 
 
@@ -827,6 +853,7 @@ void Widget::drawStereoIdent()
     if (stereoIdentPatterns.size() < (size_t)stereoPlanes)
         updateStereoIdentPatterns(stereoPlanes);
     StereoIdentTexture pattern = stereoIdentPatterns[stereoPlane];
+    replay.ViewDependent();
     GLAllStateKeeper save;
     GL.Color(1.0, 1.0, 1.0, 1.0);
     drawFullScreenTexture(pattern.w, pattern.h, pattern.tex, true);
@@ -838,13 +865,6 @@ void Widget::drawScene()
 //   Draw all objects in the scene
 // ----------------------------------------------------------------------------
 {
-    if (XL::MAIN->options.threaded_gc)
-    {
-        // Start asynchronous garbage collection
-        TaoApp->gcThread->clearCollectDone();
-        emit runGC();
-    }
-
     id = idDepth = 0;
     space->ClearPolygonOffset();
     space->ClearAttributes();
@@ -868,19 +888,39 @@ void Widget::drawScene()
 
     if (showingEvaluationWatermark)
         drawWatermark();
+}
 
-    if (XL::MAIN->options.threaded_gc)
-    {
-        // Record wait time till asynchronous garbage collection completes
-        stats.end(Statistics::DRAW);
-        stats.begin(Statistics::GC_WAIT);
-        TaoApp->gcThread->waitCollectDone();
-        stats.end(Statistics::GC_WAIT);
-        stats.begin(Statistics::DRAW);
-    }
 
-    // Delete objects that have GL resources, pushed by GC
-    InfoTrashCan::Empty();
+void Widget::startCollect()
+// ----------------------------------------------------------------------------
+//   Start garbage collection if enough was allocated and time permits
+// ----------------------------------------------------------------------------
+{
+    double budget = DBL_MAX;
+    bool animating = animated || transitionTree;
+    double next = space->NextRefresh();
+    if (animating && next != DBL_MAX)
+        budget = next - trueCurrentTime();
+
+    GCThread *gc = TaoApp->gcThread;
+    if (gc->startCollect(budget, animating, XL::MAIN->options.gc_pacing))
+        emit runGC();
+}
+
+
+void Widget::waitCollectDone()
+// ----------------------------------------------------------------------------
+//   Wait for a garbage collection started at the end of a frame
+// ----------------------------------------------------------------------------
+//   The collector must not run while the program is evaluated or drawn.
+{
+    GCThread *gc = TaoApp->gcThread;
+    if (!gc || !gc->collecting())
+        return;
+
+    stats.begin(Statistics::GC_WAIT);
+    gc->waitCollectDone();
+    stats.end(Statistics::GC_WAIT);
 }
 
 
@@ -977,6 +1017,55 @@ void Widget::drawActivities()
 }
 
 
+bool Widget::damageBegin(int w, int h, const void *target)
+// ----------------------------------------------------------------------------
+//   Compute the area to draw for this frame, return false if it is all
+// ----------------------------------------------------------------------------
+//   The target is the offscreen buffer the scene is drawn into, or NULL
+//   for the back buffer. Things that are not drawn in the layouts of the
+//   page, like the selection or the chooser, cause a full redraw, except
+//   for the statistics overlay that only changes its own area.
+{
+    if (!damage.Enabled())
+    {
+        stats.count(Statistics::DAMAGE_PIXELS, ulong(w) * h);
+        return false;
+    }
+
+    if (selection.size() || activities || blanked || stereoIdent)
+        damage.All();
+    if (stats.isEnabled(Statistics::TO_SCREEN))
+    {
+        int height = statisticsHeight();
+        damage.Add(Box(0, h - height, w, height));
+    }
+
+    bool partial = damage.Begin(frameCounter, target, w, h,
+                                GL.ModelViewMatrix(), GL.ProjectionMatrix());
+    stats.count(Statistics::DAMAGE_PIXELS,
+                DamageRegion::Pixels(damage.Scene()));
+    return partial;
+}
+
+
+bool Widget::damageOverflow()
+// ----------------------------------------------------------------------------
+//   Check if refreshed layouts were drawn outside of the damaged area
+// ----------------------------------------------------------------------------
+//   When this happens, the whole frame has to be drawn again.
+{
+    if (damage.Contained())
+        return false;
+
+    IFTRACE(damage)
+        std::cerr << "Damage overflow, drawing the whole frame\n";
+    damage.Overflow();
+    stats.count(Statistics::DAMAGE_PIXELS,
+                DamageRegion::Pixels(damage.Scene()));
+    return true;
+}
+
+
 void Widget::setGlClearColor()
 // ----------------------------------------------------------------------------
 //   Clear color with the color specified in the widget
@@ -1030,6 +1119,14 @@ void Widget::draw()
     XL::Save<bool> drawing(inDraw, true);
     TaoSave saveCurrent(current, this);
 
+    // Delete objects that have GL resources, pushed by the last collection.
+    // glDraw waits for it after presenting the frame, so it is done by now
+    waitCollectDone();
+    InfoTrashCan::Empty();
+
+    // Invalidations made while drawing this frame apply to the next one
+    frameInvalid = false;
+
     // Clean text selection
     TextSelect *sel = textSelection();
     if (sel)
@@ -1046,7 +1143,7 @@ void Widget::draw()
     }
 
     if (!XL::MAIN->options.threaded_gc)
-        emit runGC();
+        startCollect();
 
     // Run current display algorithm
     stats.begin(Statistics::FRAME);
@@ -1054,8 +1151,51 @@ void Widget::draw()
 #if QT_VERSION >= 0x050000
     devicePixelRatio = windowHandle()->devicePixelRatio();
 #endif
+    // refreshNow starts the frame before evaluating the program
+    if (!textureCache->frameStarted())
+        textureCache->beginFrame(+pageName);
     displayDriver->display();
+
+    // Let the texture cache refine textures and prefetch the next page.
+    // Refined textures may be drawn anywhere, outside of any damage.
+    text nextPage = pageShown < pageNames.size() ? pageNames[pageShown] : "";
+    if (textureCache->endFrame(+nextPage))
+    {
+        invalidateFrame();
+        QTimer::singleShot(0, this, SLOT(updateGL()));
+    }
+    SvgRendererInfo::evict();
     stats.end(Statistics::DRAW);
+
+    // Record how much state saving and restoring we did for this frame
+    OpenGLUndoLog &undo = OpenGLSave::log;
+    stats.count(Statistics::STATE_LEVELS, undo.levels);
+    stats.count(Statistics::STATE_SAVES, undo.saved);
+    stats.count(Statistics::STATE_RESTORES, undo.restored);
+    stats.count(Statistics::STATE_BYTES, undo.bytes);
+    undo.ResetCounters();
+
+    // Record how many drawings were allocated since the last frame
+    stats.count(Statistics::DRAWING_ALLOCS, DrawingArena::allocations);
+    stats.count(Statistics::DRAWING_BYTES, DrawingArena::bytes);
+    DrawingArena::ResetCounters();
+    stats.count(Statistics::LAYOUT_STATE_COPIES, LayoutState::copies);
+    LayoutState::ResetCounters();
+    stats.count(Statistics::GLYPHS_RASTERIZED, glyphCache.rasterized);
+    stats.count(Statistics::GLYPH_RASTER_TIME, glyphCache.rasterTime);
+    glyphCache.rasterized = glyphCache.rasterTime = 0;
+    stats.count(Statistics::VIEWS_DRAWN, replay.drawn);
+    stats.count(Statistics::VIEWS_REPLAYED, replay.replayed);
+    replay.drawn = replay.replayed = 0;
+    ulong jobs = 0, jobTime = 0;
+    TaoApp->jobPool->EndFrame(jobs, jobTime);
+    stats.count(Statistics::JOBS_DONE, jobs);
+    stats.count(Statistics::JOB_TIME, jobTime);
+    stats.count(Statistics::DRAW_CALLS, GL.drawCalls);
+    stats.count(Statistics::STREAMED_BYTES, GL.streamedBytes);
+    stats.count(Statistics::DRAW_CALLS_MERGED, batch.merged);
+    GL.drawCalls = GL.streamedBytes = batch.merged = 0;
+    GL.StreamEndFrame();
     stats.end(Statistics::FRAME);
     frameCounter++;
 
@@ -1085,6 +1225,10 @@ void Widget::draw()
             updateProgramSource();
     }
 
+    // Collect garbage while the frame is presented, once for all views.
+    // glDraw waits for the collection after swapping buffers.
+    if (XL::MAIN->options.threaded_gc)
+        startCollect();
 }
 
 
@@ -1221,6 +1365,58 @@ bool Widget::refreshNow(QEvent *event)
         return false;
 
     record(tao_widget, "Refresh %p", this);
+    stats.begin(Statistics::IDLE);
+    bool changed = evaluateFrame(event);
+
+    if (!inOfflineRendering && !frameNeedsDrawing(changed))
+    {
+        // Nothing visible changed, the frame on screen is still valid
+        IFTRACE(layoutevents)
+            std::cerr << "Nothing changed, frame not drawn\n";
+        stats.end(Statistics::IDLE);
+    }
+    else if (!inOfflineRendering)
+    {
+        // Redraw all
+        TaoSave saveCurrent(current, NULL); // draw() assumes current == NULL
+#ifndef MACOSX_DISPLAYLINK
+        // If the last frame was drawn during this refresh interval, draw
+        // this one in time for the next refresh, folding later requests in
+        double wall = trueCurrentTime();
+        if (framePacer.DrawLater(wall))
+        {
+            if (!frameTimer.isActive())
+            {
+                int ms = (framePacer.DrawStart(wall) - wall) * 1000;
+                frameTimer.start(ms, this);
+            }
+        }
+        else
+        {
+            frameTimer.stop();
+            updateGL();
+        }
+#else
+        updateGL();
+#endif
+
+        if (changed)
+            processProgramEvents();
+    }
+
+    return changed;
+}
+
+
+bool Widget::evaluateFrame(QEvent *event)
+// ----------------------------------------------------------------------------
+//    Evaluation stage of a frame: update layouts, return true if changed
+// ----------------------------------------------------------------------------
+{
+    waitCollectDone();
+
+    // Let modules use the results of their background jobs
+    TaoApp->jobPool->Deliver();
 
     // Update times
     setCurrentTime();
@@ -1276,7 +1472,10 @@ bool Widget::refreshNow(QEvent *event)
         // for instance: from Window::loadFile()
         TaoSave saveCurrent(current, this);
 
+        // Textures loaded by the program count as loaded for next frame
+        textureCache->beginFrame(+pageName);
         runProgram();
+        damage.All();
 
         changed = true;
     }
@@ -1288,6 +1487,7 @@ bool Widget::refreshNow(QEvent *event)
         // Layout::Refresh needs current != NULL
         TaoSave saveCurrent(current, this);
         stats.begin(Statistics::EXEC);
+        damage.PartialRefresh();
         changed = space->Refresh(event, now);
         if (changed)
             checkErrors();
@@ -1300,16 +1500,6 @@ bool Widget::refreshNow(QEvent *event)
         space->CheckRefreshDeps();
     }
 
-    if (!inOfflineRendering)
-    {
-        // Redraw all
-        TaoSave saveCurrent(current, NULL); // draw() assumes current == NULL
-        updateGL();
-
-        if (changed)
-            processProgramEvents();
-    }
-
     return changed;
 }
 
@@ -1358,10 +1548,15 @@ bool Widget::refreshOnAPI(int event_type, double next_refresh)
 // ----------------------------------------------------------------------------
 //   Module interface to refreshOn
 // ----------------------------------------------------------------------------
+//   Modules written before invalidateFrame may update what they draw, e.g. a
+//   texture, when they are refreshed, without any change to their layout.
+//   The frame is invalidated so that they are still drawn.
 {
     if (next_refresh == -1.0)
         next_refresh = DBL_MAX;
-    findTaoWidget()->refreshOn(event_type, next_refresh);
+    Widget *widget = findTaoWidget();
+    widget->refreshOn(event_type, next_refresh);
+    widget->invalidateFrame();
     return true;
 }
 
@@ -1446,6 +1641,7 @@ void Widget::runProgramOnce()
 //   (and only twice to avoid infinite loops). For example, if the page
 //   title is translated, it may not match on the next draw. See #2060.
 {
+    waitCollectDone();
     setupPage();
     setCurrentTime();
 
@@ -1542,6 +1738,7 @@ void Widget::runProgram()
                   << " shown=" << pageShown
                   << "\n";
     pageNames = newPageNames;
+    pageSources = newPageSources;
     pageTotal = pageId;
     if (pageFound)
     {
@@ -1564,6 +1761,8 @@ Tree_p Widget::saveAndEvaluate(Context* context, Tree_p code)
 //   Save GL states before evaluate a XL context
 // ----------------------------------------------------------------------------
 {
+    waitCollectDone();
+
     IFTRACE(lfps)
         PerLayoutStatistics::beginExec(code);
 
@@ -2084,6 +2283,104 @@ XL::Name_p Widget::saveThumbnail(Context *, Tree_p, int w, int h, int page,
 }
 
 
+Text_p Widget::pageThumbnailFile(Tree_p self, int w, int h, text page,
+                                 double pageTime, int priority)
+// ----------------------------------------------------------------------------
+//   Return the path of a cached page thumbnail, or "" while it is generated
+// ----------------------------------------------------------------------------
+//   The current layout is refreshed when requested thumbnails are ready.
+//   Unlike saveThumbnail, this does not evaluate the page immediately.
+{
+    text path = "";
+    page_source_map::iterator found = pageSources.find(page);
+    if (w > 0 && h > 0 && found != pageSources.end())
+    {
+        if (!thumbnails)
+            thumbnails = new PageThumbnails(this);
+        text context = xlProgram ? xlProgram->name : "";
+        path = +thumbnails->request(context, page, (*found).second,
+                                    w, h, pageTime, priority);
+        if (path == "")
+            refreshOn(thumbnails->readyEvent());
+    }
+    return new Text(path, "\"", "\"", self->Position());
+}
+
+
+bool Widget::renderPage(text page, double pageTime, QImage &image)
+// ----------------------------------------------------------------------------
+//   Render a page in a layout and frame of its own, return false if busy
+// ----------------------------------------------------------------------------
+//   The state of the page being displayed is saved, so that the page can be
+//   rendered between two frames without disturbing the presentation.
+{
+    if (!xlProgram || !xlProgram->tree || inError || inDraw || printer ||
+        inOfflineRendering || runningTransitionCode || !frameBufferReady())
+        return false;
+
+    makeCurrent();
+    TaoSave saveCurrent(current, this);
+    Tree *prog = xlProgram->tree;
+    Context *context = xlProgram->context;
+    int w = renderWidth();
+    int h = renderHeight();
+    FrameInfo frame(w, h);
+    frame.layout = new SpaceLayout(this);
+
+    // Need to synchronize GL states just before glPushAttrib (see thumbnail)
+    GL.Sync();
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    do
+    {
+        GLAllStateKeeper saveGL;
+        XL::Save<Layout *> saveLayout(layout, frame.layout);
+        XL::Save<bool> saveDrawing(inDraw, true);
+        XL::Save<bool> saveOffline(inOfflineRendering, true);
+        XL::Save<int> saveOfflineWidth(offlineRenderingWidth, w);
+        XL::Save<int> saveOfflineHeight(offlineRenderingHeight, h);
+        XL::Save<scale> savePixelRatio(devicePixelRatio, 1);
+        XL::Save<double> saveScaling(scaling, scaling);
+
+        // Freeze animations at the requested page time
+        XL::Save<double> savePageTime(pageStartTime, 0);
+        XL::Save<double> saveFrozenTime(frozenTime, pageTime);
+        XL::Save<double> saveStartTime(startTime, 0);
+        XL::Save<double> saveCurrentTime(currentTime, pageTime);
+
+        // Save page information
+        XL::Save<text> savePage(pageName, page);
+        XL::Save<text> saveLastPage(lastPageName, page);
+        XL::Save<page_map> saveLinks(pageLinks, pageLinks);
+        XL::Save<page_list> saveList(pageNames, pageNames);
+        XL::Save<page_list> saveNewList(newPageNames, newPageNames);
+        XL::Save<page_source_map> saveNewSources(newPageSources,
+                                                 newPageSources);
+        XL::Save<uint> savePageId(pageId, 0);
+        XL::Save<uint> savePageFound(pageFound, 0);
+        XL::Save<uint> savePageShown(pageShown, pageShown);
+        XL::Save<uint> savePageTotal(pageTotal, pageTotal);
+        XL::Save<uint> savePageEntry(pageEntry, pageEntry);
+        XL::Save<Tree_p> savePageTree(pageTree, pageTree);
+        XL::Save<bool> saveDAP(drawAllPages, false);
+
+        // Evaluate the program, not the context files (bug #1054)
+        setup(w, h);
+        saveAndEvaluate(context, prog);
+
+        frame.begin();
+        layout->Draw(NULL);
+        frame.end();
+    } while (0);
+    glPopAttrib();
+
+    // Resync our GL state with the real GL state. Refs #2970
+    GL.Sync();
+
+    image = frame.toImage();
+    return true;
+}
+
+
 void Widget::identifySelection()
 // ----------------------------------------------------------------------------
 //   Draw the elements in global space for selection purpose
@@ -2776,14 +3073,69 @@ void Widget::resizeGL(int width, int height)
     displayLinkMutex.lock();
     droppedFrames = 0;
     displayLinkMutex.unlock();
+#else
+    framePacer.ResetMissedDeadlines();
 #endif
 
     TaoSave saveCurrent(current, this);
     QEvent r(QEvent::Resize);
+    invalidateFrame();
     refreshNow(&r);
 }
 
 
+void Widget::glDraw()
+// ----------------------------------------------------------------------------
+//    Draw and swap buffers, then record when the frame was presented
+// ----------------------------------------------------------------------------
+//    The garbage collection started by draw() runs during the buffer swap.
+//    It is complete when we return, so events never see it running.
+{
+    QGLWidget::glDraw();
+#ifndef MACOSX_DISPLAYLINK
+    framePacer.FramePresented(trueCurrentTime());
+#endif
+    waitCollectDone();
+}
+
+
+bool Widget::frameNeedsDrawing(bool changed)
+// ----------------------------------------------------------------------------
+//    Check if the frame on screen is out of date after an evaluation
+// ----------------------------------------------------------------------------
+//    Selection handles and activities (e.g. rubber band, drag) follow the
+//    mouse without any layout change, so we keep drawing while they exist.
+//    Once the selection changes, one more frame erases the old handles.
+{
+    return (changed || frameInvalid || selectionChanged ||
+            hadSelection || !selection.empty() || activities);
+}
+
+
+void Widget::invalidateFrame()
+// ----------------------------------------------------------------------------
+//    Force the next refresh to draw, even if no layout changed
+// ----------------------------------------------------------------------------
+//    What changed is not known, e.g. a texture updated in place, so the
+//    next frame is drawn entirely even with damage regions.
+{
+    IFTRACE(layoutevents)
+        std::cerr << "Frame invalidated" << (inDraw ? " while drawing" : "")
+                  << "\n";
+    frameInvalid = true;
+    damage.All();
+}
+
+
+void Widget::invalidateFrameAPI()
+// ----------------------------------------------------------------------------
+//   Module interface to invalidateFrame
+// ----------------------------------------------------------------------------
+{
+    findTaoWidget()->invalidateFrame();
+}
+
+
 void Widget::paintGL()
 // ----------------------------------------------------------------------------
 //    Repaint the contents of the window
@@ -3982,6 +4334,12 @@ bool Widget::event(QEvent *event)
         // Unblock postEventOnceAPI for this event type
         pendingEvents.erase(type);
 
+        // Textures are updated in place, show them even without a refresh.
+        // Modules may also change what they draw before posting an event.
+        if (type == textureCache->textureChangedEvent() ||
+            moduleEvents.count(type))
+            invalidateFrame();
+
         refreshNow(event);
         return true;
     }
@@ -4139,18 +4497,24 @@ void Widget::startRefreshTimer(bool on)
     double next = space->NextRefresh();
     if (next != DBL_MAX)
     {
+        // Start the frame early enough to be ready for the display refresh
+        // that shows time 'next'. Keep an earlier start if one is pending.
         double now = trueCurrentTime();
-        double remaining = next - now;
+        double start = framePacer.FrameStart(next, now);
+        if (timer.isActive() && timerStart <= start && timerStart > now)
+            return;
+        double remaining = start - now;
         if (remaining <= 0)
             remaining = 0.001;
         int ms = remaining * 1000;
         IFTRACE(layoutevents)
             std::cerr << "Starting refresh timer: " << ms << " ms (current "
                          "time " << now << " next refresh " << next
-                      << ")\n";
+                      << " frame start " << start << ")\n";
         if (timer.isActive())
             timer.stop();
         timer.start(ms, this);
+        timerStart = start;
     }
 #endif
 }
@@ -4169,6 +4533,15 @@ void Widget::timerEvent(QTimerEvent *event)
     if (CurrentTime() < space->NextRefresh())
         return;
 #else
+    if (event->timerId() == frameTimer.timerId())
+    {
+        // Deferred draw of a frame already evaluated by refreshNow
+        frameTimer.stop();
+        TaoSave saveCurrent(current, NULL);
+        updateGL();
+        return;
+    }
+
     bool is_refresh_timer = (event->timerId() == timer.timerId());
     if (is_refresh_timer)
     {
@@ -4223,11 +4596,27 @@ double Widget::CurrentTime()
 
 double Widget::trueCurrentTime()
 // ----------------------------------------------------------------------------
-//    Query and return the current time (seconds since epoch, ~ms resolution)
+//    Query and return the current time (seconds since epoch, ~us resolution)
 // ----------------------------------------------------------------------------
+//    A monotonic clock gives the resolution required for frame pacing.
+//    It is anchored to the wall clock, and re-anchored every few seconds
+//    only if the two have drifted apart noticeably (e.g. clock was set).
 {
-    QDateTime dt = QDateTime::currentDateTime();
-    return toSecsSinceEpoch(dt);
+    static QElapsedTimer clock;
+    static double origin = 0;
+    static qint64 synced = 0;
+
+    if (!clock.isValid() || clock.elapsed() - synced > 10000)
+    {
+        if (!clock.isValid())
+            clock.start();
+        double wall = toSecsSinceEpoch(QDateTime::currentDateTime());
+        double mono = clock.nsecsElapsed() * 1e-9;
+        if (origin == 0 || fabs(origin + mono - wall) > 0.5)
+            origin = wall - mono;
+        synced = clock.elapsed();
+    }
+    return origin + clock.nsecsElapsed() * 1e-9;
 }
 
 
@@ -4238,7 +4627,12 @@ void Widget::setCurrentTime()
 {
     if (inOfflineRendering)
         return;
+#ifdef MACOSX_DISPLAYLINK
     currentTime = trueCurrentTime();
+#else
+    // Evaluate animations for the time the frame will be displayed at
+    currentTime = framePacer.DisplayTime(trueCurrentTime());
+#endif
 }
 
 
@@ -4420,7 +4814,9 @@ void Widget::updateProgramSource(bool notWhenHidden)
     if ((window->src->isHidden() && notWhenHidden) ||
         !xlProgram || sourceChanged())
         return;
+    stats.begin(Statistics::SOURCE);
     window->srcEdit->render(xlProgram->tree, &selectionTrees);
+    stats.end(Statistics::SOURCE);
 #else
     Q_UNUSED(notWhenHidden);
 #endif
@@ -4933,20 +5329,14 @@ bool Widget::writeIfChanged(XL::SourceFile &sf)
         if (!repo)
             return false;
 
+        // The repository records the change once the file is written
         if (repo->write(fname, sf.tree))
         {
-            // Mark the tree as no longer changed
+            // Mark the tree as no longer changed. If the write fails,
+            // the repository marks it changed again (see fileWritten)
             sf.changed = false;
-
-            // Record that we need to commit it sometime soon
-            repo->change(fname);
             IFTRACE(filesync)
-                std::cerr << "Changed " << fname << "\n";
-
-            // Record time when file was changed
-            QDateTime modified = QFileInfo(+fname).lastModified();
-            sf.modified = modified.toTime_t();
-
+                std::cerr << "Saving " << fname << "\n";
             return true;
         }
 
@@ -5314,18 +5704,44 @@ ulonglong Widget::now()
 }
 
 
+int Widget::statisticsHeight()
+// ----------------------------------------------------------------------------
+//    Height of the statistics overlay at the top of the window, in pixels
+// ----------------------------------------------------------------------------
+//    printStatistics prints each line at a fixed position, the optional ones
+//    at the end being the viewpoints and the background jobs of modules.
+{
+    uint lines = 14;
+    if (stereoPlanes > 1)
+        lines = 15;
+    uint modules = TaoApp->jobPool->LastFrame().size();
+    if (modules)
+        lines = 16 + modules;
+    return 20 + 10 + 17 * lines;
+}
+
+
 void Widget::printStatistics()
 // ----------------------------------------------------------------------------
 //    Print current rendering statistics as text overlay
 // ----------------------------------------------------------------------------
 {
     char fps[6] = "---.-";
+    char skipped[8] = "---.-";
     double n = stats.fps();
     if (n >= 0)
+    {
         snprintf(fps, sizeof(fps), "%5.1f", n);
+        snprintf(skipped, sizeof(skipped), "%5.1f",
+                 stats.rate(Statistics::IDLE));
+    }
     char dropped[20] = "";
 #ifdef MACOSX_DISPLAYLINK
     snprintf(dropped, sizeof(dropped), " (dropped %d)", droppedFramesLocked());
+#else
+    if (framePacer.Enabled())
+        snprintf(dropped, sizeof(dropped), " (missed %u)",
+                 framePacer.MissedDeadlines());
 #endif
     GLint vp[4] = {0,0,0,0};
     GLint vx, vy, vw, vh;
@@ -5333,8 +5749,8 @@ void Widget::printStatistics()
     glGetIntegerv(GL_VIEWPORT, vp);
     vx = vp[0]; vy = vp[1]; vw = vp[2]; vh = vp[3];
     RasterText::moveTo(vx + 20, vy + vh - 20 - 10);
-    RasterText::printf("%dx%dx%d %s fps%s", vw, vh, stereoPlanes, fps,
-                       dropped);
+    RasterText::printf("%dx%dx%d %s fps%s %s skipped", vw, vh, stereoPlanes,
+                       fps, dropped, skipped);
 
     RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17);
     if (n >= 0)
@@ -5386,10 +5802,143 @@ void Widget::printStatistics()
     XL::GarbageCollector *gc = XL::GarbageCollector::Singleton();
     uint tot  = 0, alloc = 0, freed = 0;
     gc->Statistics(tot, alloc, freed);
+    ulong gcRun = 0, gcSkipped = 0;
+    double gcSaved = 0.0;
+    TaoApp->gcThread->statistics(gcRun, gcSkipped, gcSaved);
 
     RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 - 17);
-    RasterText::printf("Program memory %5dK reserved %5dK used %5dK freed",
-                       tot>>10, alloc>>10, freed>>10);
+    RasterText::printf("Program memory %5dK reserved %5dK used %5dK freed, "
+                       "GC %6lu run %6lu skipped %7lums saved",
+                       tot>>10, alloc>>10, freed>>10,
+                       gcRun, gcSkipped, ulong(gcSaved * 1000));
+
+    // Display graphic state save/restore statistics for last frame
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 - 17 - 17);
+    RasterText::printf("GL state per frame: %5lu levels %5lu saved "
+                       "%5lu restored %5luK copied (peak %5luK)",
+                       stats.lastFrameCount(Statistics::STATE_LEVELS),
+                       stats.lastFrameCount(Statistics::STATE_SAVES),
+                       stats.lastFrameCount(Statistics::STATE_RESTORES),
+                       stats.lastFrameCount(Statistics::STATE_BYTES) >> 10,
+                       stats.maxCount(Statistics::STATE_BYTES) >> 10);
+
+    // Display texture streaming statistics for last second
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 - 17 - 17 - 17);
+    RasterText::printf("Textures per second: %4u uploads %4u evictions "
+                       "%4u reloads",
+                       textureCache->uploadsPerSecond(),
+                       textureCache->evictionsPerSecond(),
+                       textureCache->reloadsPerSecond());
+
+    // Display memory used by SVG rasters and SVG vector geometry
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 - 17 - 17 - 17 - 17);
+    RasterText::printf("SVG memory: %5luK rasters %5luK geometry",
+                       SvgRendererInfo::rasterBytes() >> 10,
+                       SvgGeometry::cacheBytes() >> 10);
+
+    // Display time spent updating the source view
+    RasterText::moveTo(vx + 20,
+                       vy + vh - 20 - 10 - 17 - 17 - 17 - 17 - 17 - 17);
+    if (n >= 0)
+        RasterText::printf("Source view avg/peak ms: %3d/%3d",
+                           stats.averageTimePerFrame(Statistics::SOURCE),
+                           stats.maxTime(Statistics::SOURCE));
+    else
+        RasterText::printf("Source view avg/peak ms: ---/---");
+
+    // Display the number of pixels drawn with damage regions
+    if (damage.Enabled())
+    {
+        RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 7);
+        RasterText::printf("Damage regions: %6luK pixels per frame "
+                           "(peak %6luK) of %6luK",
+                           stats.lastFrameCount(Statistics::DAMAGE_PIXELS)>>10,
+                           stats.maxCount(Statistics::DAMAGE_PIXELS) >> 10,
+                           (ulong(vw) * vh) >> 10);
+    }
+
+    // Display the number of drawings skipped by frustum culling
+    if (culling)
+    {
+        RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 8);
+        RasterText::printf("Frustum culling: %6lu drawn %6lu culled "
+                           "per frame",
+                           stats.lastFrameCount(Statistics::DRAWINGS_DRAWN),
+                           stats.lastFrameCount(Statistics::DRAWINGS_CULLED));
+    }
+
+    // Display allocation of drawings for last frame
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 9);
+    RasterText::printf("Drawings per frame: %6lu allocated %6luK "
+                       "(peak %6luK), %6luK in arenas",
+                       stats.lastFrameCount(Statistics::DRAWING_ALLOCS),
+                       stats.lastFrameCount(Statistics::DRAWING_BYTES) >> 10,
+                       stats.maxCount(Statistics::DRAWING_BYTES) >> 10,
+                       DrawingArena::reserved >> 10);
+
+    // Display how often layout state was copied for last frame
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 10);
+    RasterText::printf("Layout state copies per frame: %6lu (peak %6lu)",
+                       stats.lastFrameCount(Statistics::LAYOUT_STATE_COPIES),
+                       stats.maxCount(Statistics::LAYOUT_STATE_COPIES));
+
+    // Display glyph rasterization for last frame and glyph atlas size
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 11);
+    RasterText::printf("Glyphs per frame: %6lu rasterized in %6lu us "
+                       "(peak %6lu us), %4ux%4u %s atlas",
+                       stats.lastFrameCount(Statistics::GLYPHS_RASTERIZED),
+                       stats.lastFrameCount(Statistics::GLYPH_RASTER_TIME),
+                       stats.maxCount(Statistics::GLYPH_RASTER_TIME),
+                       glyphCache.Width(), glyphCache.Height(),
+                       glyphCache.DistanceField() ? "SDF" : "bitmap");
+
+    // Display the size of the triangles for 3D glyphs
+    ulong glyphTriangles = 0, glyphBytes = 0;
+    glyphCache.MeshStatistics(glyphTriangles, glyphBytes);
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 12);
+    RasterText::printf("Glyph meshes: %8lu triangles, "
+                       "%6luK in vertex buffers",
+                       glyphTriangles, glyphBytes >> 10);
+
+    // Display draw calls with and without batching, and vertex data streamed
+    RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 13);
+    ulong drawCalls = stats.lastFrameCount(Statistics::DRAW_CALLS);
+    RasterText::printf("Draw calls per frame: %6lu (peak %6lu), "
+                       "%6lu before batching, %6luK vertices streamed",
+                       drawCalls, stats.maxCount(Statistics::DRAW_CALLS),
+                       drawCalls +
+                       stats.lastFrameCount(Statistics::DRAW_CALLS_MERGED),
+                       stats.lastFrameCount(Statistics::STREAMED_BYTES) >> 10);
+
+    // Display how viewpoints were drawn for multi-view display modes
+    if (stereoPlanes > 1)
+    {
+        RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 14);
+        RasterText::printf("Viewpoints per frame: %2lu drawn %2lu replayed",
+                           stats.lastFrameCount(Statistics::VIEWS_DRAWN),
+                           stats.lastFrameCount(Statistics::VIEWS_REPLAYED));
+    }
+
+    // Display the CPU time of background jobs for each module
+    const JobPool::ModuleLoads &loads = TaoApp->jobPool->LastFrame();
+    if (!loads.empty())
+    {
+        RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * 15);
+        RasterText::printf("Module jobs per frame: %4lu done in %6lu us CPU "
+                           "(peak %6lu us)",
+                           stats.lastFrameCount(Statistics::JOBS_DONE),
+                           stats.lastFrameCount(Statistics::JOB_TIME),
+                           stats.maxCount(Statistics::JOB_TIME));
+        int line = 16;
+        JobPool::ModuleLoads::const_iterator m;
+        for (m = loads.begin(); m != loads.end(); m++, line++)
+        {
+            RasterText::moveTo(vx + 20, vy + vh - 20 - 10 - 17 * line);
+            RasterText::printf("  %-24s %4lu done in %6lu us CPU",
+                               (*m).first.c_str(),
+                               (*m).second.jobs, (*m).second.cpuTime);
+        }
+    }
 }
 
 
@@ -5512,7 +6061,14 @@ void Widget::logStatistics()
                 std::cout << ";GCWait;MaxGCWait";
 #ifdef MACOSX_DISPLAYLINK
             std::cout << ";Dropped";
+#else
+            std::cout << ";Missed";
 #endif
+            std::cout << ";Pixels;MaxPixels;Skipped;Drawn;Culled"
+                         ";GCRun;GCSkipped;GCSaved;Allocs;AllocBytes;StateCopies"
+                         ";Glyphs;GlyphTime;Atlas;GlyphTriangles;GlyphBytes"
+                         ";Views;Replayed;Jobs;JobTime;DrawCalls;Streamed"
+                         ";Merged;ModuleJobTime";
             std::cout << "\n";
             printHeader = false;
         }
@@ -5536,7 +6092,43 @@ void Widget::logStatistics()
         }
 #ifdef MACOSX_DISPLAYLINK
         std::cout << ";" << droppedFramesLocked();
+#else
+        std::cout << ";" << framePacer.MissedDeadlines();
 #endif
+        std::cout << ";" << stats.lastFrameCount(Statistics::DAMAGE_PIXELS)
+                  << ";" << stats.maxCount(Statistics::DAMAGE_PIXELS)
+                  << ";" << stats.rate(Statistics::IDLE)
+                  << ";" << stats.lastFrameCount(Statistics::DRAWINGS_DRAWN)
+                  << ";" << stats.lastFrameCount(Statistics::DRAWINGS_CULLED);
+        ulong gcRun = 0, gcSkipped = 0;
+        double gcSaved = 0.0;
+        TaoApp->gcThread->statistics(gcRun, gcSkipped, gcSaved);
+        std::cout << ";" << gcRun << ";" << gcSkipped << ";" << gcSaved
+                  << ";" << stats.lastFrameCount(Statistics::DRAWING_ALLOCS)
+                  << ";" << stats.lastFrameCount(Statistics::DRAWING_BYTES)
+                  << ";"
+                  << stats.lastFrameCount(Statistics::LAYOUT_STATE_COPIES)
+                  << ";" << stats.lastFrameCount(Statistics::GLYPHS_RASTERIZED)
+                  << ";" << stats.lastFrameCount(Statistics::GLYPH_RASTER_TIME)
+                  << ";" << glyphCache.Width() * glyphCache.Height();
+        ulong glyphTriangles = 0, glyphBytes = 0;
+        glyphCache.MeshStatistics(glyphTriangles, glyphBytes);
+        std::cout << ";" << glyphTriangles << ";" << glyphBytes
+                  << ";" << stats.lastFrameCount(Statistics::VIEWS_DRAWN)
+                  << ";" << stats.lastFrameCount(Statistics::VIEWS_REPLAYED)
+                  << ";" << stats.lastFrameCount(Statistics::JOBS_DONE)
+                  << ";" << stats.lastFrameCount(Statistics::JOB_TIME)
+                  << ";" << stats.lastFrameCount(Statistics::DRAW_CALLS)
+                  << ";" << stats.lastFrameCount(Statistics::STREAMED_BYTES)
+                  << ";" << stats.lastFrameCount(Statistics::DRAW_CALLS_MERGED);
+
+        // CPU time of background jobs as module=us pairs
+        const JobPool::ModuleLoads &loads = TaoApp->jobPool->LastFrame();
+        JobPool::ModuleLoads::const_iterator m;
+        std::cout << ";";
+        for (m = loads.begin(); m != loads.end(); m++)
+            std::cout << (m == loads.begin() ? "" : ",")
+                      << (*m).first << "=" << (*m).second.cpuTime;
         std::cout << "\n" << std::flush;
     }
 }
@@ -6121,6 +6713,7 @@ XL::Text_p Widget::page(Context *context, Text_p namePtr, Tree_p body)
     // Increment pageId and build page list
     pageId++;
     newPageNames.push_back(name);
+    newPageSources[name] = body;
 
     // If the page is set, then we display it
     if (printer && pageToPrint == pageId)
@@ -6411,6 +7004,8 @@ Tree_p Widget::transitionNextPage(Context *context, Tree_p self)
         XL::Save<page_map> saveLinks(pageLinks, pageLinks);
         XL::Save<page_list> saveList(pageNames, pageNames);
         XL::Save<page_list> saveNewList(newPageNames, newPageNames);
+        XL::Save<page_source_map> saveNewSources(newPageSources,
+                                                 newPageSources);
         XL::Save<uint> savePageId(pageId, 0);
         XL::Save<uint> savePageFound(pageFound, 0);
         XL::Save<uint> savePageShown(pageShown, pageShown);
@@ -7143,7 +7738,7 @@ Tree_p Widget::rotate(Tree_p self, Real_p ra, Real_p rx, Real_p ry, Real_p rz)
 {
     // Check that matrix mode is modelview
     if (GL.matrixMode == GL_MODELVIEW)
-        layout->model.Rotate(ra, rx, ry, rz);
+        layout->ChangeModel().Rotate(ra, rx, ry, rz);
 
     layout->Add(new Rotation(ra, rx, ry, rz));
     return XL::xl_true;
@@ -7184,7 +7779,7 @@ Tree_p Widget::translate(Tree_p self, Real_p tx, Real_p ty, Real_p tz)
 {
     // Check that matrix mode is modelview
     if (GL.matrixMode == GL_MODELVIEW)
-        layout->model.Translate(tx, ty, tz);
+        layout->ChangeModel().Translate(tx, ty, tz);
 
     layout->Add(new Translation(tx, ty, tz));
     return XL::xl_true;
@@ -7225,7 +7820,7 @@ Tree_p Widget::rescale(Tree_p self, Real_p sx, Real_p sy, Real_p sz)
 {
     // Check that matrix mode is modelview
     if (GL.matrixMode == GL_MODELVIEW)
-        layout->model.Scale(sx, sy, sz);
+        layout->ChangeModel().Scale(sx, sy, sz);
 
     layout->Add(new Scale(sx, sy, sz));
     return XL::xl_true;
@@ -7561,8 +8156,12 @@ void Widget::postEventAPI(int eventType)
 // ----------------------------------------------------------------------------
 //    Export postEvent to the module API
 // ----------------------------------------------------------------------------
+//    Modules written before invalidateFrame post events after changing what
+//    they draw, so the frame is invalidated when these events are received.
 {
-    findTaoWidget()->postEvent(eventType);
+    Widget *widget = findTaoWidget();
+    widget->moduleEvents.insert(eventType);
+    widget->postEvent(eventType);
 }
 
 
@@ -7571,7 +8170,9 @@ bool Widget::postEventOnceAPI(int eventType)
 //    Export postEvent to the module API. Return true if event was accepted.
 // ----------------------------------------------------------------------------
 {
-    Tree_p posted = findTaoWidget()->postEvent(eventType, true);
+    Widget *widget = findTaoWidget();
+    widget->moduleEvents.insert(eventType);
+    Tree_p posted = widget->postEvent(eventType, true);
     return (posted == XL::xl_true);
 }
 
@@ -8164,7 +8765,8 @@ Infix_p Widget::currentModelMatrix(Tree_p self)
 //   Return the current model matrix converting from object to world space
 // ----------------------------------------------------------------------------
 {
-    Tree *result = xl_real_list(self, 16, layout->model.Data(false));
+    Matrix4 model = layout->Model();
+    Tree *result = xl_real_list(self, 16, model.Data(false));
     return result->AsInfix();
 }
 
@@ -8331,6 +8933,70 @@ Name_p Widget::enableVSync(Tree_p self, bool enable)
     // Command not supported, but do it silently
 #endif
 
+#ifndef MACOSX_DISPLAYLINK
+    // Pace frames on the display refresh when swaps wait for it
+    framePacer.Enable(VSyncEnabled());
+#if QT_VERSION >= 0x050000
+    if (QScreen *screen = QGuiApplication::primaryScreen())
+        framePacer.SetRefreshRate(screen->refreshRate());
+#endif
+#endif
+
+    return prev ? XL::xl_true : XL::xl_false;
+}
+
+
+Name_p Widget::damageRegions(Tree_p self, bool enable)
+// ----------------------------------------------------------------------------
+//   Only draw the area changed by refreshed layouts, return previous state
+// ----------------------------------------------------------------------------
+{
+    bool prev = damage.Enabled();
+    damage.Enable(enable);
+    return prev ? XL::xl_true : XL::xl_false;
+}
+
+
+Name_p Widget::showDamageRegions(Tree_p self, bool show)
+// ----------------------------------------------------------------------------
+//   Outline the area drawn for each frame, return previous state
+// ----------------------------------------------------------------------------
+{
+    bool prev = damage.Overlay();
+    damage.ShowOverlay(show);
+    return prev ? XL::xl_true : XL::xl_false;
+}
+
+
+Name_p Widget::frustumCulling(Tree_p self, bool enable)
+// ----------------------------------------------------------------------------
+//   Skip drawings outside of the view, return previous state
+// ----------------------------------------------------------------------------
+{
+    bool prev = culling;
+    culling = enable;
+    return prev ? XL::xl_true : XL::xl_false;
+}
+
+
+Name_p Widget::multiViewReplay(Tree_p self, bool enable)
+// ----------------------------------------------------------------------------
+//   Replay the scene for the other viewpoints, return previous state
+// ----------------------------------------------------------------------------
+{
+    bool prev = replay.Enabled();
+    replay.Enable(enable);
+    return prev ? XL::xl_true : XL::xl_false;
+}
+
+
+Name_p Widget::drawBatching(Tree_p self, bool enable)
+// ----------------------------------------------------------------------------
+//   Merge the draw calls of sibling shapes, return previous state
+// ----------------------------------------------------------------------------
+{
+    bool prev = batch.Enabled();
+    batch.Enable(enable);
     return prev ? XL::xl_true : XL::xl_false;
 }
 
@@ -8701,18 +9367,18 @@ Integer* Widget::fillAnimatedTexture(Context *context, Tree_p self, text img)
 }
 
 
-Integer* Widget::fillTextureFromSVG(Context *context, Tree_p self, text img)
+Integer* Widget::fillTextureFromSVG(Context *context, Tree_p self, text img,
+                                    uint w, uint h)
 // ----------------------------------------------------------------------------
-//    Draw an image in SVG format
+//    Draw an image in SVG format, rasterized at the given size in pixels
 // ----------------------------------------------------------------------------
 //    The image may be animated, in which case we will get repaintNeeded()
 //    signals that we send to our 'draw()' so that we redraw as needed.
+//    Only animated images need to be re-evaluated on timer events.
 {
     uint texId = 0;
 
-    refreshOn(QEvent::Timer);
-
-    if (img != "")
+    if (img != "" && w > 0 && h > 0)
     {
         ADJUST_CONTEXT_FOR_INTERPRETER(context);
         img = context->ResolvePrefixedPath(img);
@@ -8724,8 +9390,11 @@ Integer* Widget::fillTextureFromSVG(Context *context, Tree_p self, text img)
             self->SetInfo<SvgRendererInfo>(rinfo);
         }
 
-        layout->Add(new FillTexture(rinfo->bind(img), GL_TEXTURE_2D));
+        GLuint glName = rinfo->bind(img, w, h);
+        layout->Add(new SvgTexture(glName, rinfo->rasterKey));
         GL.TextureSize(rinfo->w, rinfo->h);
+        if (rinfo->animated)
+            refreshOn(QEvent::Timer);
     }
     else
     {
@@ -9916,6 +10585,25 @@ Tree_p Widget::rectangle(Tree_p self, Real_p x, Real_p y, Real_p w, Real_p h)
 }
 
 
+Tree_p Widget::svgShape(Context *context, Tree_p self,
+                        Real_p x, Real_p y, Real_p w, Real_p h, text img)
+// ----------------------------------------------------------------------------
+//    Draw an SVG file as tessellated vector shapes
+// ----------------------------------------------------------------------------
+{
+    ADJUST_CONTEXT_FOR_INTERPRETER(context);
+    img = context->ResolvePrefixedPath(img);
+
+    SvgGeometry::Ref geometry = SvgGeometry::geometry(img);
+    layout->Add(new SvgShape(geometry, Box(x-w/2, y-h/2, w, h)));
+
+    if (currentShape)
+        layout->Add(new ControlRectangle(currentShape, x, y, w, h));
+
+    return XL::xl_true;
+}
+
+
 Tree_p Widget::plane(Tree_p tree, Real_p x, Real_p y, Real_p w,
              Real_p h, Integer_p lines_nb, Integer_p columns_nb)
 // ----------------------------------------------------------------------------
@@ -11126,6 +11814,16 @@ Tree_p Widget::glyphCacheScaling(Tree_p self, double scaling, double minAASize)
 }
 
 
+Name_p Widget::glyphCacheDistanceField(Tree_p self, bool enable)
+// ----------------------------------------------------------------------------
+//   Cache glyphs as signed distance fields or as bitmaps
+// ----------------------------------------------------------------------------
+{
+    bool old = glyphCache.DistanceField(enable);
+    return old ? XL::xl_true : XL::xl_false;
+}
+
+
 Integer_p Widget::glyphCacheTexture(Tree_p self)
 // ----------------------------------------------------------------------------
 //   Return a texture corresponding to the glyph cache contents
@@ -11197,6 +11895,127 @@ Tree_p Widget::newTable(Context *context, Tree_p self,
     XL::Save<Table *> saveTable(table, tbl);
 
     // Patch the symbol table with short versions of table_xyz functions
+    if (tableShortNames(self))
+    {
+        delete tbl;
+        return XL::xl_false;
+    }
+
+    Tree_p result = context->Evaluate(body);
+
+    // After we evaluated the body, add element to the layout
+    layout->Add(tbl);
+    if (currentShape)
+        layout->Add(new TableManipulator(currentShape, x, y, tbl));
+
+    return result;
+}
+
+
+Tree_p Widget::virtualTable(Context *context, Tree_p self,
+                            Real_p x, Real_p y, Integer_p r, Integer_p c,
+                            Real_p height, Real_p scroll, Tree_p body)
+// ----------------------------------------------------------------------------
+//   Create a table evaluating only the rows in the visible region
+// ----------------------------------------------------------------------------
+//   The body is evaluated once for each visible cell, with 'row' and
+//   'column' giving the cell index. The table is 'height' high, and shows
+//   rows starting 'scroll' units below the top of the first row.
+//   A few rows above and below are evaluated as well, to measure them.
+{
+    const uint MARGIN_ROWS = 2;
+
+    if (tableShortNames(self))
+        return XL::xl_false;
+    if (!body->Symbols())
+        body->SetSymbols(self->Symbols());
+
+    // Cached row heights and column widths, kept with the source tree
+    TableRowCacheInfo *info = self->GetInfo<TableRowCacheInfo>();
+    if (!info)
+    {
+        info = new TableRowCacheInfo;
+        self->SetInfo<TableRowCacheInfo>(info);
+    }
+    TableRowCache_p cache = info->cache;
+    uint rows = r->value > 0 ? r->value : 0;
+    uint columns = c->value > 0 ? c->value : 0;
+    cache->Resize(rows, columns);
+
+    // Find rows intersecting the visible region
+    coord view = height;
+    coord top = scroll;
+    coord rowTop = 0, firstTop = 0;
+    coord marginH = cache->margins.Height();
+    uint first = rows, last = rows;
+    for (uint row = 0; row < rows; row++)
+    {
+        coord rowBottom = rowTop + cache->RowHeight(row) + marginH;
+        if (first == rows && rowBottom > top)
+        {
+            first = row;
+            firstTop = rowTop;
+        }
+        rowTop = rowBottom;
+        if (rowTop >= top + view)
+        {
+            last = row + 1;
+            break;
+        }
+    }
+
+    // Add margin rows, so that their height is known when they show up
+    for (uint m = 0; m < MARGIN_ROWS && first > 0 && first < rows; m++)
+    {
+        first--;
+        firstTop -= cache->RowHeight(first) + marginH;
+    }
+    last = last + MARGIN_ROWS < rows ? last + MARGIN_ROWS : rows;
+    if (first > last)
+        first = last;
+
+    Table *tbl = new Table(this, context, x, y, last - first, columns);
+    XL::Save<Table *> saveTable(table, tbl);
+    tbl->totalRows = rows;
+    tbl->firstRow = first;
+    tbl->rowsTop = firstTop - top;
+    tbl->viewHeight = view;
+    tbl->fixedRowHeight = cache->fixedRowHeight;
+    tbl->margins = cache->margins;
+    tbl->cache = cache;
+
+    // Evaluate the cells in the visible rows
+    Tree_p result = XL::xl_true;
+    for (uint row = first; row < last; row++)
+    {
+        for (uint column = 0; column < columns; column++)
+        {
+            tbl->row = row - first;
+            tbl->column = column;
+
+            Layout *tbox = new Layout(this);
+            XL::Save<Layout *> save(layout, tbox);
+            result = saveAndEvaluate(context, body);
+            tbl->Add(tbox);
+        }
+    }
+    cache->margins = tbl->margins;
+
+    // After we evaluated the body, add element to the layout
+    layout->Add(tbl);
+    if (currentShape)
+        layout->Add(new TableManipulator(currentShape, x, y, tbl));
+
+    return result;
+}
+
+
+bool Widget::tableShortNames(Tree_p self)
+// ----------------------------------------------------------------------------
+//   Patch a table body with short versions of table_xyz functions
+// ----------------------------------------------------------------------------
+//   Return true if the program was changed, and will be reloaded
+{
     if (Prefix *prefix = self->AsPrefix())
     {
         NameToNameReplacement replacer;
@@ -11212,6 +12031,7 @@ Tree_p Widget::newTable(Context *context, Tree_p self,
         replacer["column"]  = "table_cell_column";
         replacer["rows"]    = "table_rows";
         replacer["columns"] = "table_columns";
+        replacer["row_height"] = "table_row_height";
         if (!prefix->right->Symbols())
             prefix->right->SetSymbols(self->Symbols());
         Tree *tablified = replacer.Replace(prefix->right);
@@ -11219,18 +12039,10 @@ Tree_p Widget::newTable(Context *context, Tree_p self,
         {
             prefix->right = tablified;
             reloadProgram();
-            return XL::xl_false;
+            return true;
         }
     }
-
-    Tree_p result = context->Evaluate(body);
-
-    // After we evaluated the body, add element to the layout
-    layout->Add(tbl);
-    if (currentShape)
-        layout->Add(new TableManipulator(currentShape, x, y, tbl));
-
-    return result;
+    return false;
 }
 
 
@@ -11351,6 +12163,23 @@ Tree_p Widget::tableBorder(Tree_p self, Tree_p code)
 }
 
 
+Tree_p Widget::tableRowHeight(Tree_p self, Real_p h)
+// ----------------------------------------------------------------------------
+//   Give all rows of the table the same height instead of measuring them
+// ----------------------------------------------------------------------------
+{
+    if (!table)
+    {
+        Ooops("Table row height $1 outside of any table", self);
+        return XL::xl_false;
+    }
+    table->fixedRowHeight = h;
+    if (table->cache)
+        table->cache->fixedRowHeight = h;
+    return XL::xl_true;
+}
+
+
 Real_p Widget::tableCellX(Tree_p self)
 // ----------------------------------------------------------------------------
 //   Get the horizontal center of the current table cell
@@ -11417,7 +12246,7 @@ Integer_p Widget::tableRow(Tree_p self)
         Ooops("Table cell attribute $1 without a table", self);
         return new Integer(0, self->Position());
     }
-    return new Integer(table->row, self->Position());
+    return new Integer(table->firstRow + table->row, self->Position());
 }
 
 
@@ -11445,7 +12274,7 @@ Integer_p Widget::tableRows(Tree_p self)
         Ooops("Table attribute $1 without a table", self);
         return new Integer(0, self->Position());
     }
-    return new Integer(table->rows, self->Position());
+    return new Integer(table->totalRows, self->Position());
 }
 
 
@@ -12835,17 +13664,17 @@ bool Widget::blink(double on, double off, double after)
     double runtime = Application::runTime();
     if (runtime <= after)
     {
-        refreshOnAPI((int)QEvent::Timer, after - runtime);
+        findTaoWidget()->refreshOn((int)QEvent::Timer, after - runtime);
         return true;
     }
     double time = Widget::currentTimeAPI();
     double mod = fmod(time, on + off);
     if (mod <= on)
     {
-        refreshOnAPI((int)QEvent::Timer, time + on - mod);
+        findTaoWidget()->refreshOn((int)QEvent::Timer, time + on - mod);
         return true;
     }
-    refreshOnAPI((int)QEvent::Timer, time + on + off - mod);
+    findTaoWidget()->refreshOn((int)QEvent::Timer, time + on + off - mod);
     return false;
 }
 
@@ -60,6 +60,10 @@
 #include "page_layout.h"
 #include "tao_gl.h"
 #include "statistics.h"
+#include "frame_pacer.h"
+#include "damage_region.h"
+#include "view_replay.h"
+#include "draw_batch.h"
 #include "file_monitor.h"
 #include "preview.h"
 #include "tao_process.h"
@@ -108,6 +112,7 @@ struct DisplayDriver;
 struct OpenGLState;
 struct ShaderProgramInfo;
 struct XLSourceEdit;
+class PageThumbnails;
 
 // ----------------------------------------------------------------------------
 // Name of fixed menu.
@@ -206,6 +211,7 @@ public:
     void        initializeGL();
     void        resizeGL(int width, int height);
     void        paintGL();
+    void        glDraw();
     void        setup(double w, double h, const Box *picking = NULL);
     void        reset();
     void        resetModelviewMatrix();
@@ -223,6 +229,8 @@ public:
     void        legacyDraw();
     void        drawStereoIdent();
     void        drawScene();
+    void        startCollect();
+    void        waitCollectDone();
     void        drawSelection();
     void        drawActivities();
     void        setGlClearColor();
@@ -231,6 +239,13 @@ public:
     bool        stereoIdentEnabled(void) { return stereoIdent; }
     int         renderWidth()  { return width()  * devicePixelRatio; }
     int         renderHeight() { return height() * devicePixelRatio; }
+    DamageRegion &damageRegion() { return damage; }
+    bool        damageBegin(int w, int h, const void *target);
+    bool        damageOverflow();
+    ViewReplay &viewReplay()    { return replay; }
+    DrawBatch  &drawBatch()     { return batch; }
+    void        invalidateFrame();
+    bool        renderPage(text page, double pageTime, QImage &image);
 
     // Events
     bool        forwardEvent(QEvent *event);
@@ -296,6 +311,7 @@ public:
     // Timing
     ulonglong   now();
     void        printStatistics();
+    int         statisticsHeight();
     void        printPerLayoutStatistics();
     void        logStatistics();
     bool        hasAnimations(void)     { return animated; }
@@ -548,6 +564,11 @@ public:
     Integer_p   polygonOffset(Tree_p self,
                               double f0, double f1, double u0, double u1);
     Name_p      enableVSync(Tree_p self, bool enable);
+    Name_p      damageRegions(Tree_p self, bool enable);
+    Name_p      showDamageRegions(Tree_p self, bool show);
+    Name_p      frustumCulling(Tree_p self, bool enable);
+    Name_p      multiViewReplay(Tree_p self, bool enable);
+    Name_p      drawBatching(Tree_p self, bool enable);
     double      optimalDefaultRefresh();
     bool        VSyncEnabled();
     bool        VSyncSupported();
@@ -572,7 +593,8 @@ public:
     Integer*    fillTextureId(Tree_p self, GLuint texId);
     Integer*    fillTexture(Context *, Tree_p self, text fileName);
     Integer*    fillAnimatedTexture(Context *, Tree_p self, text fileName);
-    Integer*    fillTextureFromSVG(Context *, Tree_p self, text svg);
+    Integer*    fillTextureFromSVG(Context *, Tree_p self, text svg,
+                                   uint w = 512, uint h = 512);
     Tree_p      textureWrap(Tree_p self, bool s, bool t);
     Tree_p      textureMode(Tree_p self, text mode);
     Tree_p      textureMinFilter(Tree_p self, text filter);
@@ -667,6 +689,8 @@ public:
     // 2D primitive that can be in a path or standalone
     Tree_p      fixedSizePoint(Tree_p self, coord x,coord y,coord z, coord s);
     Tree_p      rectangle(Tree_p self, Real_p x, Real_p y, Real_p w, Real_p h);
+    Tree_p      svgShape(Context *context, Tree_p self,
+                         Real_p x, Real_p y, Real_p w, Real_p h, text img);
     Tree_p      plane(Tree_p tree, Real_p x, Real_p y, Real_p w,
                       Real_p h, Integer_p lines_nb, Integer_p columns_nb);
     Tree_p      isoscelesTriangle(Tree_p self,
@@ -769,6 +793,7 @@ public:
     Name_p      enableGlyphCache(Tree_p self, bool enable);
     Tree_p      glyphCacheSizeRange(Tree_p self, double min, double max);
     Tree_p      glyphCacheScaling(Tree_p self, double scaling, double minSize);
+    Name_p      glyphCacheDistanceField(Tree_p self, bool enable);
     Integer_p   glyphCacheTexture(Tree_p self);
     Text_p      unicodeChar(Tree_p self, int code);
     Text_p      unicodeCharText(Tree_p self, text code);
@@ -779,6 +804,10 @@ public:
                          Integer_p r, Integer_p c, Tree_p body);
     Tree_p      newTable(Context *context, Tree_p self,
                          Integer_p r, Integer_p c, Tree_p body);
+    Tree_p      virtualTable(Context *context, Tree_p self,
+                             Real_p x, Real_p y, Integer_p r, Integer_p c,
+                             Real_p height, Real_p scroll, Tree_p body);
+    bool        tableShortNames(Tree_p self);
     Tree_p      tableCell(Context *, Tree_p self,
                           Real_p w, Real_p h, Tree_p body);
     Tree_p      tableCell(Context *, Tree_p self, Tree_p body);
@@ -788,6 +817,7 @@ public:
                              Real_p w, Real_p h);
     Tree_p      tableFill(Tree_p self, Tree_p code);
     Tree_p	tableBorder(Tree_p self, Tree_p code);
+    Tree_p      tableRowHeight(Tree_p self, Real_p h);
     Real_p      tableCellX(Tree_p self);
     Real_p      tableCellY(Tree_p self);
     Real_p      tableCellW(Tree_p self);
@@ -813,6 +843,8 @@ public:
     Integer*    thumbnail(Context *, Tree_p self, scale s, double i, text page);
     Name_p      saveThumbnail(Context *context, Tree_p self, int w, int h,
                               int page, text file, double pageTime = 0.0);
+    Text_p      pageThumbnailFile(Tree_p self, int w, int h, text page,
+                                  double pageTime = 0.0, int priority = 0);
     Integer*    linearGradient(Context *context, Tree_p self,
                                Real_p start_x, Real_p start_y, Real_p end_x, Real_p end_y,
                                double w, double h, Tree_p prog);
@@ -1020,6 +1052,7 @@ private:
     typedef std::map<text, TextFlow*>        flow_map;
     typedef std::map<text, text>             page_map;
     typedef std::vector<text>                page_list;
+    typedef std::map<text, Tree_p>           page_source_map;
     typedef std::map<GLuint, Tree_p>         perId_action_map;
     typedef std::map<text, perId_action_map> action_map;
     typedef std::map<Tree_p, ContextAndCode> page_action_map;
@@ -1061,6 +1094,7 @@ private:
     text                  gotoPageName, transitionPageName;
     page_map              pageLinks;
     page_list             pageNames, newPageNames;
+    page_source_map       pageSources, newPageSources;
     uint                  pageId, pageFound, prevPageShown, pageShown, pageTotal, pageToPrint;
     uint                  pageEntry, pageExit;
     Tree_p                pageTree, transitionTree;
@@ -1098,6 +1132,7 @@ private:
     QString               screenShotPath;
     scale                 screenShotScale;
     bool                  screenShotWithAlpha;
+    PageThumbnails *      thumbnails;
 #ifdef Q_OS_LINUX
     bool                  vsyncState;
 #endif
@@ -1154,7 +1189,15 @@ private:
     unsigned int          droppedFrames;
 #else
     QBasicTimer           timer;
+    QBasicTimer           frameTimer;
+    double                timerStart;
+    FramePacer            framePacer;
 #endif
+    DamageRegion          damage;
+    bool                  frameInvalid;
+    bool                  culling;
+    ViewReplay            replay;
+    DrawBatch             batch;
     double                dfltRefresh;
     QTimer                idleTimer;
     double                pageStartTime, frozenTime, startTime, currentTime;
@@ -1191,6 +1234,7 @@ private:
     int                   offlineRenderingHeight;
     std::map<text, QFileDialog::DialogLabel> toDialogLabel;
     std::set<int>         pendingEvents;
+    std::set<int>         moduleEvents; // Posted by modules, see postEventAPI
 
     // Processes
     QMap<QString,Process*>processMap;
@@ -1231,10 +1275,13 @@ public:
     static double         trueCurrentTime();
     static void           postEventAPI(int eventType);
     static bool           postEventOnceAPI(int eventType);
+    static void           invalidateFrameAPI();
     static bool           offlineRenderingAPI();
 
 private:
     void                  processProgramEvents();
+    bool                  evaluateFrame(QEvent *event);
+    bool                  frameNeedsDrawing(bool changed);
     void                  startRefreshTimer(bool on = true);
     double                CurrentTime();
     void                  setCurrentTime();
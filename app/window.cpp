@@ -2586,6 +2586,17 @@ void Window::showMessage(QString message, int timeout)
 }
 
 
+void Window::fileWriteFailed(QString path)
+// ----------------------------------------------------------------------------
+//   Report that the repository could not save a source file of the document
+// ----------------------------------------------------------------------------
+{
+    QString msg = tr("Cannot write file %1.").arg(path);
+    addError(msg);
+    showMessage(msg, 5000);
+}
+
+
 void Window::setReadOnly(bool ro)
 // ----------------------------------------------------------------------------
 //    Switch document to read-only or read-write mode
@@ -2974,6 +2985,9 @@ bool Window::openProject(QString path, QString fileName, bool confirm)
             // REVISIT: should slot be in Window rather than Widget?
             connect(repo.data(),SIGNAL(commitSuccess(QString,QString)),
                     taoWidget,  SLOT(commitSuccess(QString, QString)));
+            // Report source files that could not be saved
+            connect(repo.data(), SIGNAL(writeFailed(QString)),
+                    this, SLOT(fileWriteFailed(QString)));
 #if !defined(CFG_NOGIT) && !defined(CFG_NOEDIT)
             // Also be notified when changes come from remote sync (pull)
             connect(repo.data(), SIGNAL(asyncPullComplete()),
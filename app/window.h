@@ -178,6 +178,7 @@ private slots:
 #endif
     void        newFile();
     void        openRecentFile();
+    void        fileWriteFailed(QString path);
     void        clearRecentFileList();
 #ifndef CFG_NOEDIT
     bool        save();
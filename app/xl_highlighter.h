@@ -64,6 +64,7 @@ public:
 
     void   highlightNames(int index, std::set<text> &set);
     void   setSelectedRanges(const XL::stream_ranges &selected);
+    const XL::stream_ranges &selectedRanges()   { return selected; }
     bool   hasSelectedObjects()    { return !selected.empty(); }
     void   clearSelectedRanges();
 
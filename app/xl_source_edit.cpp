@@ -42,11 +42,14 @@
 #include "tao_utf8.h"
 #include "assistant.h"
 #include "context.h"
+#include "save.h"
 #include <QScrollBar>
 #include <QEvent>
 #include <QKeyEvent>
 #include <QFileInfo>
 #include <QTextDocumentFragment>
+#include <QTextBlock>
+#include <QElapsedTimer>
 
 namespace Tao {
 
@@ -54,7 +57,7 @@ XLSourceEdit::XLSourceEdit(QWidget *parent)
 // ----------------------------------------------------------------------------
 //   Create a source editor
 // ----------------------------------------------------------------------------
-    : QTextEdit(parent)
+    : QTextEdit(parent), rendering(false)
 {
     QFont font("unifont");
     font.setPixelSize(16);
@@ -68,6 +71,9 @@ XLSourceEdit::XLSourceEdit(QWidget *parent)
     QString sspath(stylesheet.absoluteFilePath());
     QString sypath(syntax.absoluteFilePath());
     renderer->SelectStyleSheet(+sspath, +sypath);
+
+    connect(document(), SIGNAL(contentsChanged()),
+            this, SLOT(documentChanged()));
 }
 
 
@@ -125,14 +131,110 @@ void XLSourceEdit::setSelectedRanges(const XL::stream_ranges &ranges)
 }
 
 
+void XLSourceEdit::updateText(const QString &txt, XL::stream_ranges &ranges)
+// ----------------------------------------------------------------------------
+//   Replace only the part of the document that differs from the new text
+// ----------------------------------------------------------------------------
+//   The document is edited in place, so that the syntax highlighter only
+//   processes the blocks that changed, and the cursor and scroll bars stay
+//   where they are. Like setPlainText, this does not record undo steps and
+//   leaves the modified state of the document unchanged.
+//   Ranges of the previous text that follow the change are moved with it.
+{
+    QTextDocument *doc = document();
+    XL::Save<bool> saveRendering(rendering, true);
+    if (shown.isEmpty())
+    {
+        // First rendering, or the text was changed by someone else
+        setPlainTextKeepCursor(txt);
+        shown = txt;
+        return;
+    }
+
+    int oldLen = shown.length();
+    int newLen = txt.length();
+    int max = oldLen < newLen ? oldLen : newLen;
+    int prefix = 0;
+    while (prefix < max && shown[prefix] == txt[prefix])
+        prefix++;
+    int suffix = 0;
+    while (suffix < max - prefix &&
+           shown[oldLen - 1 - suffix] == txt[newLen - 1 - suffix])
+        suffix++;
+
+    bool modified = doc->isModified();
+    bool undo = doc->isUndoRedoEnabled();
+    doc->setUndoRedoEnabled(false);
+
+    QTextCursor cursor(doc);
+    cursor.setPosition(prefix);
+    cursor.setPosition(oldLen - suffix, QTextCursor::KeepAnchor);
+    cursor.insertText(txt.mid(prefix, newLen - prefix - suffix));
+
+    doc->setUndoRedoEnabled(undo);
+    doc->setModified(modified);
+    shown = txt;
+
+    int delta = newLen - oldLen;
+    XL::stream_ranges::iterator r;
+    for (r = ranges.begin(); r != ranges.end(); r++)
+    {
+        if ((int) (*r).first >= oldLen - suffix)
+            (*r).first += delta;
+        if ((int) (*r).second >= oldLen - suffix)
+            (*r).second += delta;
+    }
+
+    IFTRACE(srcview)
+        std::cerr << "Source view: replaced " << oldLen - prefix - suffix
+                  << " characters at " << prefix << " with "
+                  << newLen - prefix - suffix << "\n";
+}
+
+
+void XLSourceEdit::documentChanged()
+// ----------------------------------------------------------------------------
+//   Forget the rendered text if the document was changed by someone else
+// ----------------------------------------------------------------------------
+{
+    if (!rendering)
+        shown.clear();
+}
+
+
+void XLSourceEdit::rehighlightRanges(const XL::stream_ranges &ranges)
+// ----------------------------------------------------------------------------
+//   Highlight again the text blocks that intersect the given ranges
+// ----------------------------------------------------------------------------
+{
+    QTextDocument *doc = document();
+    XL::stream_ranges::const_iterator r;
+    for (r = ranges.begin(); r != ranges.end(); r++)
+    {
+        QTextBlock block = doc->findBlock((*r).first);
+        while (block.isValid() && block.position() <= (int) (*r).second)
+        {
+            highlighter->rehighlightBlock(block);
+            block = block.next();
+        }
+    }
+}
+
+
 void XLSourceEdit::render(XL::Tree_p prog, std::set<XL::Tree_p> *selected)
 // ----------------------------------------------------------------------------
 //   Show prog source
 // ----------------------------------------------------------------------------
+//   The program is rendered as a whole, because the text of a statement
+//   depends on its context. But the document and its highlighting are
+//   only updated where the text or the selection actually changed.
 {
     if (!prog)
         return clear();
 
+    QElapsedTimer timer;
+    timer.start();
+
     text txt = "";
     rendererOut.str(txt);
 
@@ -143,14 +245,33 @@ void XLSourceEdit::render(XL::Tree_p prog, std::set<XL::Tree_p> *selected)
         for (i = selected->begin(); i != selected->end(); i++)
             renderer->highlights[*i] = "selected";
     renderer->RenderFile(prog);
+    qint64 rendered = timer.elapsed();
 
     XL::stream_ranges sel;
     if (renderer->highlighted.count("selected"))
         sel = renderer->highlighted["selected"];
+    XL::stream_ranges old = highlighter->selectedRanges();
+
+    QString next = +rendererOut.str();
+    bool same = (next == shown);
     setSelectedRanges(sel);
 
-    txt = rendererOut.str();
-    setPlainTextKeepCursor(+txt);
+    // Rehighlighting changes the document too, it must not reset 'shown'
+    XL::Save<bool> saveRendering(rendering, true);
+    if (!same)
+        updateText(next, old);
+
+    // Blocks that were or are now selected must be highlighted again
+    if (!same || old != sel)
+    {
+        rehighlightRanges(old);
+        rehighlightRanges(sel);
+    }
+
+    IFTRACE(srcview)
+        std::cerr << "Source view: rendered in " << rendered << " ms, "
+                  << (same ? "text unchanged" : "text updated") << ", total "
+                  << timer.elapsed() << " ms\n";
 }
 
 
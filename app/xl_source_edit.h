@@ -73,11 +73,18 @@ protected:
     bool           handleF1Key(QKeyEvent *e);
     void           setPlainTextKeepCursor(const QString &txt);
     void           setSelectedRanges(const XL::stream_ranges &ranges);
+    void           updateText(const QString &txt, XL::stream_ranges &ranges);
+    void           rehighlightRanges(const XL::stream_ranges &ranges);
+
+private slots:
+    void           documentChanged();
 
 private:
     XLHighlighter *    highlighter;
     XL::Renderer *     renderer;
     std::ostringstream rendererOut;
+    QString            shown;           // Text last rendered
+    bool               rendering;       // Document is being updated by us
 };
 
 }
@@ -65,6 +65,10 @@
 #   DEFINES+=XLR_GC_LIFO
 #     (Debug) Tell the libxlr memory allocator to use a LIFO policy, i.e., do not
 #     reuse freed objects immediately. May help valgrind detect more errors.
+#   DEFINES+=TAO_NO_SIMD
+#     Use the scalar versions of the matrix and bounding box operations instead
+#     of the SSE2 ones (or AVX ones when building with QMAKE_CXXFLAGS+=-mavx).
+#     Useful to check or benchmark the vectorized code in tao_simd.h.
 #   DEFINES+=CFG_NODISPLAYLINK
 #     (MacOSX) Do not use a Core Video display link to refresh the display, but
 #     a QBasicTimer (like other platforms).
@@ -74,5 +74,13 @@ OTHER_FILES += \
     shapes/shapes_4.png \
     shapes/shapes_5.png \
     shapes/shapes_test.xl \
-    shapes/tortue.jpg
+    shapes/tortue.jpg \
+    benchmarks/benchmark.xl \
+    benchmarks/icon.svg \
+    benchmarks/multiview.ddd \
+    benchmarks/rectangles.ddd \
+    benchmarks/streaming.ddd \
+    benchmarks/svg_icons.ddd \
+    benchmarks/tables.ddd \
+    benchmarks/transforms.ddd
 